@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+
+namespace cpplib {
+    namespace detail {
+        struct ArenaBlock {
+            ArenaBlock* next;
+            std::size_t size;  // usable bytes following the header
+        };
+
+        // Per-thread free list of arena blocks so that arenas created and torn down on the
+        // same thread (one per message, one per connection) stop hitting the global heap.
+        class ArenaBlockCache {
+        public:
+            static constexpr std::size_t max_cached = 16;
+
+            ~ArenaBlockCache() {
+                while (head_) {
+                    ArenaBlock* next = head_->next;
+                    ::operator delete(head_);
+                    head_ = next;
+                }
+            }
+
+            static ArenaBlockCache& local() {
+                thread_local ArenaBlockCache cache;
+                return cache;
+            }
+
+            ArenaBlock* take(std::size_t size) {
+                ArenaBlock** link = &head_;
+                while (*link) {
+                    if ((*link)->size >= size) {
+                        ArenaBlock* block = *link;
+                        *link = block->next;
+                        block->next = nullptr;
+                        --count_;
+                        return block;
+                    }
+                    link = &(*link)->next;
+                }
+                auto* block = static_cast<ArenaBlock*>(::operator new(sizeof(ArenaBlock) + size));
+                block->next = nullptr;
+                block->size = size;
+                return block;
+            }
+
+            void give(ArenaBlock* block) noexcept {
+                if (count_ >= max_cached) {
+                    ::operator delete(block);
+                    return;
+                }
+                block->next = head_;
+                head_ = block;
+                ++count_;
+            }
+
+            std::size_t cached() const noexcept { return count_; }
+
+        private:
+            ArenaBlock* head_ = nullptr;
+            std::size_t count_ = 0;
+        };
+    }
+
+    // Bump allocator: allocate() advances a pointer, deallocate() is a no-op and everything
+    // is returned at once by reset()/release(). Not thread-safe; use one arena per thread.
+    class MonotonicArena : public std::pmr::memory_resource {
+    public:
+        explicit MonotonicArena(std::size_t block_size = 64 * 1024)
+            : block_size_(std::max<std::size_t>(block_size, 256)) {}
+
+        ~MonotonicArena() override { release(); }
+
+        MonotonicArena(const MonotonicArena&) = delete;
+        MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+        // Rewinds to the active block and hands the rest back to the thread cache.
+        void reset() noexcept {
+            if (!head_) {
+                return;
+            }
+            ArenaBlock* keep = head_;
+            while (keep->next) {
+                ArenaBlock* next = keep->next;
+                keep->next = next->next;
+                detail::ArenaBlockCache::local().give(next);
+            }
+            // The active bump block is always at the front; if there is none (only an
+            // oversized one-off was ever allocated) nothing is worth keeping.
+            if (!end_) {
+                detail::ArenaBlockCache::local().give(keep);
+                head_ = nullptr;
+            } else {
+                cur_ = data(keep);
+                end_ = cur_ + keep->size;
+            }
+            used_ = 0;
+        }
+
+        void release() noexcept {
+            while (head_) {
+                ArenaBlock* next = head_->next;
+                detail::ArenaBlockCache::local().give(head_);
+                head_ = next;
+            }
+            cur_ = end_ = nullptr;
+            used_ = 0;
+        }
+
+        std::size_t bytesAllocated() const noexcept { return used_; }
+        std::size_t blockSize() const noexcept { return block_size_; }
+
+    protected:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            if (void* p = bump(bytes, alignment)) {
+                return p;
+            }
+            const std::size_t need = bytes + alignment;
+            if (need > block_size_) {
+                // Oversized request: give it a dedicated block behind the current one so the
+                // remainder of the current block stays usable.
+                ArenaBlock* big = detail::ArenaBlockCache::local().take(need);
+                if (head_) {
+                    big->next = head_->next;
+                    head_->next = big;
+                } else {
+                    head_ = big;
+                }
+                used_ += bytes;
+                return align(data(big), alignment);
+            }
+            ArenaBlock* block = detail::ArenaBlockCache::local().take(block_size_);
+            block->next = head_;
+            head_ = block;
+            cur_ = data(block);
+            end_ = cur_ + block->size;
+            return bump(bytes, alignment);
+        }
+
+        void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+    private:
+        using ArenaBlock = detail::ArenaBlock;
+
+        static unsigned char* data(ArenaBlock* block) noexcept {
+            return reinterpret_cast<unsigned char*>(block + 1);
+        }
+
+        static unsigned char* align(unsigned char* p, std::size_t alignment) noexcept {
+            auto addr = reinterpret_cast<std::uintptr_t>(p);
+            addr = (addr + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+            return reinterpret_cast<unsigned char*>(addr);
+        }
+
+        void* bump(std::size_t bytes, std::size_t alignment) noexcept {
+            if (!cur_) {
+                return nullptr;
+            }
+            unsigned char* p = align(cur_, alignment);
+            if (p > end_ || static_cast<std::size_t>(end_ - p) < bytes) {
+                return nullptr;
+            }
+            cur_ = p + bytes;
+            used_ += bytes;
+            return p;
+        }
+
+        std::size_t block_size_;
+        ArenaBlock* head_ = nullptr;
+        unsigned char* cur_ = nullptr;
+        unsigned char* end_ = nullptr;
+        std::size_t used_ = 0;
+    };
+}
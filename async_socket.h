@@ -0,0 +1,371 @@
+#pragma once
+
+#include "event_loop.h"
+#include "socket.h"
+
+#if defined(CPPLIB_HAS_EVENT_LOOP) && defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include <sys/socket.h>
+
+#define CPPLIB_HAS_ASYNC_SOCKET 1
+
+namespace cpplib {
+    // Lazily started coroutine result. Awaiting a Task starts it and resumes the awaiter
+    // through symmetric transfer when it finishes; use spawn() to run one detached.
+    template <typename T = void>
+    class Task;
+
+    namespace detail {
+        struct TaskPromiseBase {
+            std::coroutine_handle<> continuation = std::noop_coroutine();
+            std::exception_ptr error;
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct FinalAwaiter {
+                bool await_ready() noexcept { return false; }
+                template <typename P>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept {
+                    return h.promise().continuation;
+                }
+                void await_resume() noexcept {}
+            };
+            FinalAwaiter final_suspend() noexcept { return {}; }
+
+            void unhandled_exception() noexcept { error = std::current_exception(); }
+        };
+
+        template <typename T>
+        struct TaskPromise : TaskPromiseBase {
+            std::optional<T> value;
+            Task<T> get_return_object() noexcept;
+            template <typename U>
+            void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+            T result() {
+                if (error) std::rethrow_exception(error);
+                return std::move(*value);
+            }
+        };
+
+        template <>
+        struct TaskPromise<void> : TaskPromiseBase {
+            Task<void> get_return_object() noexcept;
+            void return_void() noexcept {}
+            void result() {
+                if (error) std::rethrow_exception(error);
+            }
+        };
+    }
+
+    template <typename T>
+    class Task {
+    public:
+        using promise_type = detail::TaskPromise<T>;
+        using handle_type  = std::coroutine_handle<promise_type>;
+
+        explicit Task(handle_type h) noexcept : h_(h) {}
+        Task(Task&& other) noexcept : h_(std::exchange(other.h_, {})) {}
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                if (h_) h_.destroy();
+                h_ = std::exchange(other.h_, {});
+            }
+            return *this;
+        }
+        ~Task() { if (h_) h_.destroy(); }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        bool await_ready() const noexcept { return !h_ || h_.done(); }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+            h_.promise().continuation = awaiter;
+            return h_;
+        }
+        T await_resume() { return h_.promise().result(); }
+
+        bool done() const noexcept { return !h_ || h_.done(); }
+
+    private:
+        handle_type h_;
+    };
+
+    namespace detail {
+        template <typename T>
+        Task<T> TaskPromise<T>::get_return_object() noexcept {
+            return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+            return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+        }
+
+        struct DetachedTask {
+            struct promise_type {
+                DetachedTask get_return_object() noexcept { return {}; }
+                std::suspend_never initial_suspend() noexcept { return {}; }
+                std::suspend_never final_suspend() noexcept { return {}; }
+                void return_void() noexcept {}
+                void unhandled_exception() noexcept { std::terminate(); }
+            };
+        };
+
+        inline DetachedTask runDetached(Task<void> task) {
+            co_await task;
+        }
+    }
+
+    // Starts the task on the calling thread; it frees itself when it completes.
+    inline void spawn(Task<void> task) {
+        detail::runDetached(std::move(task));
+    }
+
+    // Socket driven by an EventLoop. Each operation first tries the syscall directly and
+    // only suspends when it would block; readiness is delivered edge-triggered and the
+    // coroutine is resumed inline on the loop thread. At most one read-side operation
+    // (read/accept) and one write-side operation (write/connect) may be pending at a time.
+    // All operations must be started on the loop thread, and the socket must outlive any
+    // operation pending on it.
+    class AsyncSocket {
+    public:
+        AsyncSocket(EventLoop& loop, Socket socket) : loop_(loop), socket_(std::move(socket)) {
+            socket_.set_nonblocking(true);
+        }
+
+        explicit AsyncSocket(EventLoop& loop) : loop_(loop) {}
+
+        ~AsyncSocket() { close(); }
+
+        AsyncSocket(const AsyncSocket&) = delete;
+        AsyncSocket& operator=(const AsyncSocket&) = delete;
+
+        bool bind(int port) { return socket_.bind(port); }
+        bool listen(int backlog = 128) { return socket_.listen(backlog) && socket_.set_nonblocking(true); }
+        std::uint16_t localPort() const { return socket_.localPort(); }
+        bool valid() const noexcept { return socket_.valid(); }
+        Socket& socket() noexcept { return socket_; }
+        EventLoop& loop() noexcept { return loop_; }
+
+        void close() {
+            if (registered_fd_ >= 0) {
+                loop_.remove(registered_fd_);
+                registered_fd_ = -1;
+            }
+            socket_.close();
+        }
+
+    private:
+        struct Op {
+            virtual ~Op() = default;
+            // Retries the syscall; true once the operation has a final result.
+            virtual bool attempt() = 0;
+            std::coroutine_handle<> waiter;
+        };
+
+        template <typename Derived>
+        struct OpAwaiter : Op {
+            bool await_ready() { return static_cast<Derived*>(this)->attempt(); }
+            bool await_suspend(std::coroutine_handle<> h) {
+                this->waiter = h;
+                Derived& self = *static_cast<Derived*>(this);
+                if (!self.owner.ensureRegistered()) {
+                    self.fail(EBADF);
+                    return false;
+                }
+                (Derived::write_side ? self.owner.writer_ : self.owner.reader_) = this;
+                return true;
+            }
+        };
+
+    public:
+        struct ReadAwaiter : OpAwaiter<ReadAwaiter> {
+            static constexpr bool write_side = false;
+            ReadAwaiter(AsyncSocket& s, void* b, std::size_t n, bool whole) : owner(s), buf(static_cast<char*>(b)), len(n), exact(whole) {}
+            bool attempt() override {
+                while (done < len) {
+                    const auto r = ::recv(owner.socket_.native_handle(), buf + done, len - done, MSG_DONTWAIT);
+                    if (r > 0) {
+                        done += static_cast<std::size_t>(r);
+                        if (!exact) return true;
+                        continue;
+                    }
+                    if (r == 0) { eof = true; return true; }
+                    if (errno == EINTR) continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
+                    fail(errno);
+                    return true;
+                }
+                return true;
+            }
+            void fail(int e) { error = e; }
+            // Bytes read; 0 on orderly close before any data, -1 on error. In exact mode a
+            // short count means the peer closed mid-message.
+            std::ptrdiff_t await_resume() const noexcept {
+                if (error) return -1;
+                return static_cast<std::ptrdiff_t>(done);
+            }
+            AsyncSocket& owner;
+            char* buf;
+            std::size_t len;
+            bool exact;
+            std::size_t done = 0;
+            bool eof = false;
+            int error = 0;
+        };
+
+        struct WriteAwaiter : OpAwaiter<WriteAwaiter> {
+            static constexpr bool write_side = true;
+            WriteAwaiter(AsyncSocket& s, const void* b, std::size_t n) : owner(s), buf(static_cast<const char*>(b)), len(n) {}
+            bool attempt() override {
+                while (done < len) {
+                    const auto r = ::send(owner.socket_.native_handle(), buf + done, len - done, MSG_DONTWAIT | MSG_NOSIGNAL);
+                    if (r >= 0) {
+                        done += static_cast<std::size_t>(r);
+                        continue;
+                    }
+                    if (errno == EINTR) continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
+                    fail(errno);
+                    return true;
+                }
+                return true;
+            }
+            void fail(int e) { error = e; }
+            // Bytes written (all of them) or -1.
+            std::ptrdiff_t await_resume() const noexcept {
+                return error ? -1 : static_cast<std::ptrdiff_t>(done);
+            }
+            AsyncSocket& owner;
+            const char* buf;
+            std::size_t len;
+            std::size_t done = 0;
+            int error = 0;
+        };
+
+        struct AcceptAwaiter : OpAwaiter<AcceptAwaiter> {
+            static constexpr bool write_side = false;
+            explicit AcceptAwaiter(AsyncSocket& s) : owner(s) {}
+            bool attempt() override {
+                // accept() on a closed listener fails without touching errno.
+                if (!owner.socket_.valid()) return true;
+                for (;;) {
+                    auto client = owner.socket_.accept();
+                    if (client) {
+                        result = std::make_unique<AsyncSocket>(owner.loop_, std::move(*client));
+                        return true;
+                    }
+                    if (errno == EINTR || errno == ECONNABORTED) continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) return false;
+                    return true;  // hard error: result stays null
+                }
+            }
+            void fail(int) {}
+            std::unique_ptr<AsyncSocket> await_resume() noexcept { return std::move(result); }
+            AsyncSocket& owner;
+            std::unique_ptr<AsyncSocket> result;
+        };
+
+        struct ConnectAwaiter : OpAwaiter<ConnectAwaiter> {
+            static constexpr bool write_side = true;
+            ConnectAwaiter(AsyncSocket& s, std::string h, int p) : owner(s), host(std::move(h)), port(p) {}
+            bool attempt() override {
+                if (!started) {
+                    started = true;
+                    if (!owner.socket_.open() || !owner.socket_.set_nonblocking(true)) {
+                        fail(errno);
+                        return true;
+                    }
+                    errno = 0;
+                    if (owner.socket_.connect(host, port)) {
+                        return true;
+                    }
+                    if (errno != EINPROGRESS) {
+                        fail(errno ? errno : EINVAL);
+                        return true;
+                    }
+                    return false;
+                }
+                const int err = owner.socket_.pending_error();
+                if (err == EINPROGRESS || err == EALREADY) return false;
+                if (err != 0) fail(err);
+                return true;
+            }
+            void fail(int e) { error = e; }
+            bool await_resume() const noexcept { return error == 0; }
+            AsyncSocket& owner;
+            std::string host;
+            int port;
+            bool started = false;
+            int error = 0;
+        };
+
+        // Reads whatever is available (at least one byte) into buf.
+        ReadAwaiter async_read(void* buf, std::size_t len) { return ReadAwaiter(*this, buf, len, false); }
+        template <typename Buffer>
+        ReadAwaiter async_read(Buffer& buf) { return async_read(buf.data(), buf.size()); }
+
+        // Reads exactly len bytes unless the peer closes or an error occurs.
+        ReadAwaiter async_read_exact(void* buf, std::size_t len) { return ReadAwaiter(*this, buf, len, true); }
+        template <typename Buffer>
+        ReadAwaiter async_read_exact(Buffer& buf) { return async_read_exact(buf.data(), buf.size()); }
+
+        WriteAwaiter async_write(const void* buf, std::size_t len) { return WriteAwaiter(*this, buf, len); }
+        template <typename Buffer>
+        WriteAwaiter async_write(const Buffer& buf) { return async_write(buf.data(), buf.size()); }
+
+        AcceptAwaiter async_accept() { return AcceptAwaiter(*this); }
+        ConnectAwaiter async_connect(std::string host, int port) { return ConnectAwaiter(*this, std::move(host), port); }
+
+    private:
+        bool ensureRegistered() {
+            if (registered_fd_ >= 0) {
+                return true;
+            }
+            const int fd = socket_.native_handle();
+            if (fd < 0) {
+                return false;
+            }
+            const std::uint32_t events = EventLoop::READABLE | EventLoop::WRITABLE | EventLoop::HANGUP |
+                                         EventLoop::ERROR | EventLoop::EDGE;
+            if (!loop_.add(fd, events, [this](std::uint32_t ev) { onReady(ev); })) {
+                return false;
+            }
+            registered_fd_ = fd;
+            return true;
+        }
+
+        void onReady(std::uint32_t ev) {
+            // Settle both sides before resuming anything: a resumed coroutine may destroy
+            // this socket.
+            const bool failed = ev & (EventLoop::HANGUP | EventLoop::ERROR);
+            Op* w = nullptr;
+            Op* r = nullptr;
+            if (writer_ && (ev & EventLoop::WRITABLE || failed) && writer_->attempt()) {
+                w = std::exchange(writer_, nullptr);
+            }
+            if (reader_ && (ev & EventLoop::READABLE || failed) && reader_->attempt()) {
+                r = std::exchange(reader_, nullptr);
+            }
+            if (w) w->waiter.resume();
+            if (r) r->waiter.resume();
+        }
+
+        EventLoop& loop_;
+        Socket socket_;
+        int registered_fd_ = -1;
+        Op* reader_ = nullptr;
+        Op* writer_ = nullptr;
+    };
+}
+
+#endif
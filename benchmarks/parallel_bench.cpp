@@ -0,0 +1,86 @@
+// Scaling of the parallel algorithms from one thread to every core, against the
+// sequential standard library.
+//
+//   g++ -std=c++17 -O2 -pthread benchmarks/parallel_bench.cpp -o parallel_bench
+//   ./parallel_bench [elements] [max_threads]
+//
+// "threads" counts the caller, so 1 is a pool with no workers.
+#include "../parallel.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace {
+    using clock_type = std::chrono::steady_clock;
+
+    template <typename Fn>
+    double bestOf(int reps, Fn&& fn) {
+        double best = 1e300;
+        for (int r = 0; r < reps; ++r) {
+            const auto start = clock_type::now();
+            fn();
+            best = std::min(best, std::chrono::duration<double, std::milli>(clock_type::now() - start).count());
+        }
+        return best;
+    }
+
+    std::vector<std::uint64_t> randomData(std::size_t n) {
+        std::vector<std::uint64_t> v(n);
+        std::uint64_t s = 0x9E3779B97F4A7C15ull;
+        for (auto& x : v) {
+            s ^= s << 13;
+            s ^= s >> 7;
+            s ^= s << 17;
+            x = s;
+        }
+        return v;
+    }
+}
+
+int main(int argc, char** argv) {
+    const std::size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000000;
+    const std::size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t max_threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : hw;
+    const auto data = randomData(n);
+    const int reps = 3;
+
+    std::vector<std::uint64_t> work;
+    std::vector<std::uint64_t> out(n);
+    const double std_sort = bestOf(reps, [&] { work = data; std::sort(work.begin(), work.end()); });
+    const double std_scan = bestOf(reps, [&] { std::inclusive_scan(data.begin(), data.end(), out.begin()); });
+    const double copy = bestOf(reps, [&] { work = data; });
+
+    std::printf("%zu elements, %zu hardware threads\n", n, hw);
+    std::printf("std::sort %.1f ms, std::inclusive_scan %.1f ms (sort times below include a %.1f ms copy)\n\n",
+                std_sort, std_scan, copy);
+    std::printf("%7s %10s %8s %10s %8s %10s %10s %10s\n", "threads", "sort ms", "vs std", "scan ms", "vs std",
+                "partition", "xform_red", "find_first");
+
+    for (std::size_t t = 1; t <= max_threads; t = t < 4 ? t + 1 : t * 2) {
+        cpplib::ThreadPool pool(t - 1);
+        const double sort_ms = bestOf(reps, [&] { work = data; cpplib::parallel::sort(pool, work.begin(), work.end()); });
+        const double scan_ms = bestOf(reps, [&] { cpplib::parallel::inclusive_scan(pool, data.begin(), data.end(), out.begin()); });
+        const double part_ms = bestOf(reps, [&] {
+            work = data;
+            cpplib::parallel::partition(pool, work.begin(), work.end(), [](std::uint64_t x) { return (x & 1) != 0; });
+        });
+        volatile std::uint64_t sink = 0;
+        const double tr_ms = bestOf(reps, [&] {
+            sink = cpplib::parallel::transform_reduce(pool, data.begin(), data.end(), std::uint64_t{0}, std::plus<>{},
+                                                      [](std::uint64_t x) { return x >> 32; });
+        });
+        const double find_ms = bestOf(reps, [&] {
+            auto it = cpplib::parallel::find_first(pool, data.begin(), data.end(), [](std::uint64_t x) { return x == 0; });
+            sink = static_cast<std::uint64_t>(it - data.begin());
+        });
+        (void)sink;
+        std::printf("%7zu %10.1f %7.2fx %10.1f %7.2fx %10.1f %10.1f %10.1f\n", t, sort_ms, std_sort / sort_ms, scan_ms,
+                    std_scan / scan_ms, part_ms, tr_ms, find_ms);
+    }
+    return 0;
+}
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "socket.h"
+
+namespace cpplib {
+    // Growable byte buffer with separate read and write cursors. Integers are written and
+    // read in an explicit byte order or as LEB128 varints. Getters throw std::out_of_range
+    // when fewer bytes are readable than requested.
+    class ByteBuffer {
+    public:
+        // Position of bytes set aside by skip(), for filling in later (e.g. a length
+        // prefix). Stays valid across growth until the bytes in front of it are read.
+        using Mark = std::size_t;
+
+        explicit ByteBuffer(std::size_t capacity = 256) { grow(capacity); }
+
+        ByteBuffer(ByteBuffer&& other) noexcept
+            : storage_(std::move(other.storage_)), capacity_(std::exchange(other.capacity_, 0)),
+              read_(std::exchange(other.read_, 0)), write_(std::exchange(other.write_, 0)) {}
+
+        ByteBuffer& operator=(ByteBuffer&& other) noexcept {
+            storage_ = std::move(other.storage_);
+            capacity_ = std::exchange(other.capacity_, 0);
+            read_ = std::exchange(other.read_, 0);
+            write_ = std::exchange(other.write_, 0);
+            return *this;
+        }
+
+        const char* data() const noexcept { return storage_.get() + read_; }
+        std::size_t size() const noexcept { return write_ - read_; }
+        bool empty() const noexcept { return write_ == read_; }
+        std::size_t capacity() const noexcept { return capacity_; }
+        void clear() noexcept { read_ = write_ = 0; }
+
+        // Makes room for n more bytes and returns where they go; commit() publishes them.
+        char* prepare(std::size_t n) {
+            if (capacity_ - write_ < n) {
+                if (read_ > 0 && capacity_ - size() >= n) {
+                    std::memmove(storage_.get(), data(), size());  // reuse consumed space
+                    write_ -= read_;
+                    read_ = 0;
+                } else {
+                    grow(std::max(capacity_ * 2, size() + n));
+                }
+            }
+            return storage_.get() + write_;
+        }
+
+        void commit(std::size_t n) noexcept { write_ += n; }
+
+        void write(const void* src, std::size_t n) {
+            if (n == 0) return;
+            std::memcpy(prepare(n), src, n);
+            write_ += n;
+        }
+
+        void write(const std::string& s) { write(s.data(), s.size()); }
+
+        template <typename T>
+        void putBe(T v) {
+            char b[sizeof(T)];
+            encode<T>(b, v, true);
+            write(b, sizeof(T));
+        }
+
+        template <typename T>
+        void putLe(T v) {
+            char b[sizeof(T)];
+            encode<T>(b, v, false);
+            write(b, sizeof(T));
+        }
+
+        void putVarint(std::uint64_t v) {
+            char* p = prepare(10);
+            std::size_t n = 0;
+            while (v >= 0x80) {
+                p[n++] = static_cast<char>(v | 0x80);
+                v >>= 7;
+            }
+            p[n++] = static_cast<char>(v);
+            write_ += n;
+        }
+
+        // Zigzag-encoded so small negative numbers stay short.
+        void putVarintSigned(std::int64_t v) {
+            putVarint((static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63));
+        }
+
+        Mark skip(std::size_t n) {
+            std::memset(prepare(n), 0, n);
+            const Mark at = size();
+            write_ += n;
+            return at;
+        }
+
+        template <typename T>
+        Mark skip() { return skip(sizeof(T)); }
+
+        void backfill(Mark at, const void* src, std::size_t n) {
+            if (at + n > size()) throw std::out_of_range("ByteBuffer backfill past end");
+            std::memcpy(storage_.get() + read_ + at, src, n);
+        }
+
+        template <typename T>
+        void backfillBe(Mark at, T v) {
+            char b[sizeof(T)];
+            encode<T>(b, v, true);
+            backfill(at, b, sizeof(T));
+        }
+
+        template <typename T>
+        void backfillLe(Mark at, T v) {
+            char b[sizeof(T)];
+            encode<T>(b, v, false);
+            backfill(at, b, sizeof(T));
+        }
+
+        void read(void* dst, std::size_t n) {
+            need(n);
+            std::memcpy(dst, data(), n);
+            consume(n);
+        }
+
+        std::string readString(std::size_t n) {
+            need(n);
+            std::string out(data(), n);
+            consume(n);
+            return out;
+        }
+
+        void consume(std::size_t n) {
+            need(n);
+            read_ += n;
+            if (read_ == write_) read_ = write_ = 0;
+        }
+
+        template <typename T>
+        T getBe() {
+            need(sizeof(T));
+            const T v = decode<T>(data(), true);
+            consume(sizeof(T));
+            return v;
+        }
+
+        template <typename T>
+        T getLe() {
+            need(sizeof(T));
+            const T v = decode<T>(data(), false);
+            consume(sizeof(T));
+            return v;
+        }
+
+        std::uint64_t getVarint() {
+            std::uint64_t v = 0;
+            for (std::size_t i = 0; i < 10; ++i) {
+                need(i + 1);
+                const auto b = static_cast<unsigned char>(data()[i]);
+                v |= static_cast<std::uint64_t>(b & 0x7f) << (7 * i);
+                if (!(b & 0x80)) {
+                    consume(i + 1);
+                    return v;
+                }
+            }
+            throw std::out_of_range("ByteBuffer varint too long");
+        }
+
+        std::int64_t getVarintSigned() {
+            const std::uint64_t v = getVarint();
+            return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+        }
+
+    private:
+        template <typename T>
+        static void encode(char* out, T v, bool big_endian) noexcept {
+            static_assert(std::is_integral<T>::value, "ByteBuffer encodes integers");
+            auto u = static_cast<std::make_unsigned_t<T>>(v);
+            for (std::size_t i = 0; i < sizeof(T); ++i) {
+                out[big_endian ? sizeof(T) - 1 - i : i] = static_cast<char>(u & 0xff);
+                u = static_cast<decltype(u)>(static_cast<std::uint64_t>(u) >> 8);
+            }
+        }
+
+        template <typename T>
+        static T decode(const char* in, bool big_endian) noexcept {
+            static_assert(std::is_integral<T>::value, "ByteBuffer decodes integers");
+            std::make_unsigned_t<T> u = 0;
+            for (std::size_t i = 0; i < sizeof(T); ++i) {
+                const auto b = static_cast<unsigned char>(in[big_endian ? i : sizeof(T) - 1 - i]);
+                u = static_cast<decltype(u)>((static_cast<std::uint64_t>(u) << 8) | b);
+            }
+            return static_cast<T>(u);
+        }
+
+        void need(std::size_t n) const {
+            if (size() < n) throw std::out_of_range("ByteBuffer underflow");
+        }
+
+        void grow(std::size_t capacity) {
+            capacity = std::max<std::size_t>(capacity, 16);
+            std::unique_ptr<char[]> next(new char[capacity]);
+            if (size()) std::memcpy(next.get(), data(), size());
+            write_ -= read_;
+            read_ = 0;
+            storage_ = std::move(next);
+            capacity_ = capacity;
+        }
+
+        std::unique_ptr<char[]> storage_;
+        std::size_t capacity_ = 0;
+        std::size_t read_ = 0;
+        std::size_t write_ = 0;
+    };
+
+    // Rope-like message builder. Small pieces are copied into an internal buffer; large
+    // ones can be referenced in place (appendRef), so building a frame around a big payload
+    // copies nothing. slices() yields the pieces in order for Socket::send_all.
+    class SegmentedBuffer {
+    public:
+        // Copies the bytes.
+        void append(const void* data, std::size_t n) {
+            if (n == 0) return;
+            if (segments_.empty() || !segments_.back().owned) {
+                segments_.push_back(Segment{nullptr, owned_.size(), 0, true});
+            }
+            owned_.write(data, n);
+            segments_.back().size += n;
+            size_ += n;
+        }
+
+        void append(const std::string& s) { append(s.data(), s.size()); }
+        void append(const ByteBuffer& b) { append(b.data(), b.size()); }
+
+        // References the bytes; they must stay alive and unchanged until the send.
+        void appendRef(const void* data, std::size_t n) {
+            if (n == 0) return;
+            segments_.push_back(Segment{static_cast<const char*>(data), 0, n, false});
+            size_ += n;
+        }
+
+        // Shares ownership of the string so it lives as long as the builder.
+        void appendRef(std::shared_ptr<const std::string> s) {
+            appendRef(s->data(), s->size());
+            keep_.push_back(std::move(s));
+        }
+
+        template <typename T>
+        void putBe(T v) {
+            const std::size_t before = owned_.size();
+            owned_.putBe(v);
+            noteOwned(before);
+        }
+
+        template <typename T>
+        void putLe(T v) {
+            const std::size_t before = owned_.size();
+            owned_.putLe(v);
+            noteOwned(before);
+        }
+
+        void putVarint(std::uint64_t v) {
+            const std::size_t before = owned_.size();
+            owned_.putVarint(v);
+            noteOwned(before);
+        }
+
+        std::size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+        std::size_t segmentCount() const noexcept { return segments_.size(); }
+
+        // Valid until the builder is next modified.
+        void slices(std::vector<IoSlice>& out) const {
+            out.clear();
+            for (const auto& s : segments_) {
+                out.push_back(IoSlice{s.owned ? owned_.data() + s.offset : s.ref, s.size});
+            }
+        }
+
+        // Calls fn(data, size) for each piece in order.
+        template <typename Fn>
+        void forEach(Fn&& fn) const {
+            for (const auto& s : segments_) fn(s.owned ? owned_.data() + s.offset : s.ref, s.size);
+        }
+
+        void copyTo(std::string& out) const {
+            out.reserve(out.size() + size_);
+            forEach([&](const char* p, std::size_t n) { out.append(p, n); });
+        }
+
+        void clear() {
+            segments_.clear();
+            owned_.clear();
+            keep_.clear();
+            size_ = 0;
+        }
+
+    private:
+        // Owned pieces are kept as offsets because owned_ may move when it grows.
+        struct Segment {
+            const char* ref;
+            std::size_t offset;
+            std::size_t size;
+            bool owned;
+        };
+
+        void noteOwned(std::size_t before) {
+            const std::size_t n = owned_.size() - before;
+            if (segments_.empty() || !segments_.back().owned) {
+                segments_.push_back(Segment{nullptr, before, 0, true});
+            }
+            segments_.back().size += n;
+            size_ += n;
+        }
+
+        std::vector<Segment> segments_;
+        ByteBuffer owned_;
+        std::vector<std::shared_ptr<const std::string>> keep_;
+        std::size_t size_ = 0;
+    };
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cpplib {
+    // Byte-bounded response cache with optional TTL, split into independently locked shards.
+    // Values are shared, immutable buffers: a hit hands out another reference, so a cached
+    // reply (typically the encoded frame) can go to TcpServer::sendTo without a copy.
+    // Lookups take only their shard's reader lock and record recency in an atomic stamp, so
+    // hits never serialize on each other. When a shard goes over its byte budget, a pass
+    // drops expired entries and then the least recently used until it is 1/8 under budget.
+    class ResponseCache {
+    public:
+        using Value = std::shared_ptr<const std::string>;
+        using clock = std::chrono::steady_clock;
+
+        struct Stats {
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::uint64_t insertions = 0;
+            std::uint64_t evictions = 0;
+            std::uint64_t expirations = 0;
+            std::size_t bytes = 0;
+            std::size_t entries = 0;
+        };
+
+        // ttl of zero means entries never expire on their own.
+        explicit ResponseCache(std::size_t max_bytes, std::size_t shards = 16,
+                               std::chrono::milliseconds ttl = std::chrono::milliseconds::zero())
+            : shards_(std::max<std::size_t>(shards, 1)), ttl_(ttl) {
+            shard_budget_ = std::max<std::size_t>(max_bytes / shards_.size(), 1);
+        }
+
+        Value get(const std::string& key) {
+            Shard& sh = shardFor(key);
+            std::shared_lock<std::shared_mutex> lk(sh.mutex);
+            auto it = sh.map.find(key);
+            const auto now = clock::now();
+            if (it == sh.map.end() || expired(it->second, now)) {
+                sh.misses.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            it->second.stamp.store(stampOf(now), std::memory_order_relaxed);
+            sh.hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second.value;
+        }
+
+        // Values larger than a shard's budget are not cached. Replaces an existing entry.
+        void put(const std::string& key, Value value) { put(key, std::move(value), ttl_); }
+
+        void put(const std::string& key, Value value, std::chrono::milliseconds ttl) {
+            if (!value) return;
+            const std::size_t cost = costOf(key, *value);
+            if (cost > shard_budget_) return;
+            Shard& sh = shardFor(key);
+            std::unique_lock<std::shared_mutex> lk(sh.mutex);
+            auto it = sh.map.find(key);
+            if (it != sh.map.end()) {
+                sh.bytes -= it->second.cost;
+                sh.map.erase(it);
+            }
+            const auto now = clock::now();
+            auto& e = sh.map[key];
+            e.value = std::move(value);
+            e.cost = cost;
+            e.expires = ttl.count() > 0 ? now + ttl : clock::time_point::max();
+            e.stamp.store(stampOf(now), std::memory_order_relaxed);
+            sh.bytes += cost;
+            ++sh.insertions;
+            if (sh.bytes > shard_budget_) evict(sh);
+        }
+
+        Value put(const std::string& key, std::string value) {
+            auto v = std::make_shared<const std::string>(std::move(value));
+            put(key, v);
+            return v;
+        }
+
+        // Returns the cached value, or computes, stores and returns it. Concurrent misses
+        // each compute; pair with SingleFlight to collapse them.
+        Value getOrCompute(const std::string& key, const std::function<std::string()>& fn) {
+            if (auto v = get(key)) return v;
+            return put(key, fn());
+        }
+
+        bool erase(const std::string& key) {
+            Shard& sh = shardFor(key);
+            std::unique_lock<std::shared_mutex> lk(sh.mutex);
+            auto it = sh.map.find(key);
+            if (it == sh.map.end()) return false;
+            sh.bytes -= it->second.cost;
+            sh.map.erase(it);
+            return true;
+        }
+
+        void clear() {
+            for (auto& sh : shards_) {
+                std::unique_lock<std::shared_mutex> lk(sh.mutex);
+                sh.map.clear();
+                sh.bytes = 0;
+            }
+        }
+
+        Stats stats() const {
+            Stats s;
+            for (auto& sh : shards_) {
+                s.hits += sh.hits.load(std::memory_order_relaxed);
+                s.misses += sh.misses.load(std::memory_order_relaxed);
+                std::shared_lock<std::shared_mutex> lk(sh.mutex);
+                s.insertions += sh.insertions;
+                s.evictions += sh.evictions;
+                s.expirations += sh.expirations;
+                s.bytes += sh.bytes;
+                s.entries += sh.map.size();
+            }
+            return s;
+        }
+
+    private:
+        struct Entry {
+            Value value;
+            std::size_t cost = 0;
+            clock::time_point expires;
+            std::atomic<std::int64_t> stamp{0};  // last use; bumped under the reader lock
+        };
+
+        struct alignas(64) Shard {
+            mutable std::shared_mutex mutex;
+            std::unordered_map<std::string, Entry> map;
+            std::size_t bytes = 0;
+            std::uint64_t insertions = 0;
+            std::uint64_t evictions = 0;
+            std::uint64_t expirations = 0;
+            std::atomic<std::uint64_t> hits{0};
+            std::atomic<std::uint64_t> misses{0};
+        };
+
+        static constexpr std::size_t entry_overhead = 96;  // node, bucket and control block
+
+        static std::size_t costOf(const std::string& key, const std::string& value) noexcept {
+            return key.size() + value.size() + entry_overhead;
+        }
+
+        static bool expired(const Entry& e, clock::time_point now) noexcept { return now >= e.expires; }
+
+        // The clock doubles as the recency stamp, so hits share no counter across threads.
+        static std::int64_t stampOf(clock::time_point t) noexcept { return t.time_since_epoch().count(); }
+
+        Shard& shardFor(const std::string& key) {
+            return shards_[std::hash<std::string>{}(key) % shards_.size()];
+        }
+
+        // Caller holds the shard's writer lock.
+        void evict(Shard& sh) {
+            const auto now = clock::now();
+            const std::size_t low_water = shard_budget_ - shard_budget_ / 8;
+            for (auto it = sh.map.begin(); it != sh.map.end();) {
+                if (expired(it->second, now)) {
+                    sh.bytes -= it->second.cost;
+                    ++sh.expirations;
+                    it = sh.map.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            if (sh.bytes <= low_water) return;
+            victims_.clear();
+            for (auto& kv : sh.map) victims_.emplace_back(kv.second.stamp.load(std::memory_order_relaxed), &kv.first);
+            std::sort(victims_.begin(), victims_.end());
+            for (const auto& v : victims_) {
+                if (sh.bytes <= low_water) break;
+                auto it = sh.map.find(*v.second);
+                sh.bytes -= it->second.cost;
+                ++sh.evictions;
+                sh.map.erase(it);
+            }
+        }
+
+        std::vector<Shard> shards_;
+        std::size_t shard_budget_ = 0;
+        std::chrono::milliseconds ttl_;
+        static inline thread_local std::vector<std::pair<std::int64_t, const std::string*>> victims_;
+    };
+}
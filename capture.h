@@ -0,0 +1,342 @@
+#pragma once
+
+#if !defined(_WIN32) && !defined(_WIN64)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tcp.h"
+#include "timer.h"
+
+#define CPPLIB_HAS_CAPTURE 1
+
+namespace cpplib {
+    // Capture file layout: a 32-byte header ("CPLCAP01", u64 bytes of records, u64 record
+    // count, u64 reserved), then packed records of u64 nanoseconds since the capture
+    // started, u64 connection id, u32 length and the payload. Native byte order.
+    namespace capture {
+        constexpr char magic[8] = {'C', 'P', 'L', 'C', 'A', 'P', '0', '1'};
+        constexpr std::size_t header_size = 32;
+        constexpr std::size_t record_header_size = 20;
+    }
+
+    // Records inbound messages into a memory-mapped file. Writers reserve space with one
+    // atomic add and copy straight into the mapping, so concurrent connection threads
+    // never take a lock; the kernel writes pages back in the background. Once the file's
+    // capacity is used up further records are counted as dropped. Install with
+    // server.setInboundTap(writer.tap()); close() only after the server has stopped.
+    class CaptureWriter {
+    public:
+        struct Stats {
+            std::uint64_t records = 0;
+            std::uint64_t dropped = 0;
+            std::size_t bytes = 0;
+        };
+
+        CaptureWriter() = default;
+        explicit CaptureWriter(const std::string& path, std::size_t capacity = 256 * 1024 * 1024) { open(path, capacity); }
+        ~CaptureWriter() { close(); }
+
+        CaptureWriter(const CaptureWriter&) = delete;
+        CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+        bool open(const std::string& path, std::size_t capacity = 256 * 1024 * 1024) {
+            close();
+            fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd_ < 0) return false;
+            const std::size_t size = capture::header_size + capacity;
+            if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) return fail();
+            void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (p == MAP_FAILED) return fail();
+            base_ = static_cast<char*>(p);
+            mapped_ = size;
+            capacity_ = capacity;
+            std::memcpy(base_, capture::magic, sizeof(capture::magic));
+            tail_.store(0, std::memory_order_relaxed);
+            straddle_.store(no_straddle, std::memory_order_relaxed);
+            records_.store(0, std::memory_order_relaxed);
+            dropped_.store(0, std::memory_order_relaxed);
+            start_ = std::chrono::steady_clock::now();
+            return true;
+        }
+
+        bool isOpen() const noexcept { return base_ != nullptr; }
+
+        // Thread-safe.
+        void record(std::uint64_t conn, const void* data, std::size_t len) {
+            if (!base_) return;
+            const auto now = std::chrono::steady_clock::now();
+            const std::size_t need = capture::record_header_size + len;
+            if (len > 0xFFFFFFFFu) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            const std::size_t at = tail_.fetch_add(need, std::memory_order_relaxed);
+            if (at + need > capacity_) {
+                if (at <= capacity_) straddle_.store(at, std::memory_order_relaxed);  // at most one can straddle
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            char* p = base_ + capture::header_size + at;
+            const auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_).count());
+            const auto n32 = static_cast<std::uint32_t>(len);
+            std::memcpy(p, &ns, 8);
+            std::memcpy(p + 8, &conn, 8);
+            std::memcpy(p + 16, &n32, 4);
+            std::memcpy(p + capture::record_header_size, data, len);
+            records_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        TcpServer::InboundTap tap() {
+            return [this](TcpServer::ClientId id, const char* data, std::size_t len) { record(id, data, len); };
+        }
+
+        Stats stats() const noexcept {
+            Stats s;
+            s.records = records_.load(std::memory_order_relaxed);
+            s.dropped = dropped_.load(std::memory_order_relaxed);
+            s.bytes = used();
+            return s;
+        }
+
+        // Finalizes the header and trims the file to what was written.
+        bool close() {
+            if (!base_) return fd_ < 0 || fail();
+            const std::uint64_t used_bytes = used();
+            const std::uint64_t count = records_.load(std::memory_order_relaxed);
+            std::memcpy(base_ + 8, &used_bytes, 8);
+            std::memcpy(base_ + 16, &count, 8);
+            ::munmap(base_, mapped_);
+            base_ = nullptr;
+            const bool ok = ::ftruncate(fd_, static_cast<off_t>(capture::header_size + used_bytes)) == 0;
+            ::close(fd_);
+            fd_ = -1;
+            return ok;
+        }
+
+    private:
+        static constexpr std::size_t no_straddle = ~std::size_t(0);
+
+        // Records end where the one that overflowed the capacity would have started.
+        std::size_t used() const noexcept {
+            const std::size_t s = straddle_.load(std::memory_order_relaxed);
+            return s != no_straddle ? s : std::min(tail_.load(std::memory_order_relaxed), capacity_);
+        }
+
+        bool fail() {
+            if (fd_ >= 0) ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+
+        int fd_ = -1;
+        char* base_ = nullptr;
+        std::size_t mapped_ = 0;
+        std::size_t capacity_ = 0;
+        std::chrono::steady_clock::time_point start_;
+        alignas(64) std::atomic<std::size_t> tail_{0};
+        std::atomic<std::size_t> straddle_{no_straddle};
+        alignas(64) std::atomic<std::uint64_t> records_{0};
+        std::atomic<std::uint64_t> dropped_{0};
+    };
+
+    // Read-only view of a capture file. Record payloads point into the mapping.
+    class CaptureReader {
+    public:
+        struct Record {
+            std::uint64_t time_ns = 0;  // since the capture started
+            std::uint64_t conn = 0;
+            std::string_view data;
+        };
+
+        CaptureReader() = default;
+        explicit CaptureReader(const std::string& path) { open(path); }
+        ~CaptureReader() { close(); }
+
+        CaptureReader(const CaptureReader&) = delete;
+        CaptureReader& operator=(const CaptureReader&) = delete;
+
+        bool open(const std::string& path) {
+            close();
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) return false;
+            struct stat st{};
+            if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < capture::header_size) {
+                ::close(fd);
+                return false;
+            }
+            void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (p == MAP_FAILED) return false;
+            base_ = static_cast<const char*>(p);
+            mapped_ = static_cast<std::size_t>(st.st_size);
+            std::uint64_t used = 0;
+            std::memcpy(&used, base_ + 8, 8);
+            std::memcpy(&count_, base_ + 16, 8);
+            if (std::memcmp(base_, capture::magic, sizeof(capture::magic)) != 0 || used > mapped_ - capture::header_size) {
+                close();
+                return false;
+            }
+            end_ = capture::header_size + static_cast<std::size_t>(used);
+            pos_ = capture::header_size;
+            return true;
+        }
+
+        bool valid() const noexcept { return base_ != nullptr; }
+        std::uint64_t size() const noexcept { return count_; }
+
+        bool next(Record& r) noexcept {
+            if (!base_ || end_ - pos_ < capture::record_header_size) return false;
+            const char* p = base_ + pos_;
+            std::uint32_t len;
+            std::memcpy(&r.time_ns, p, 8);
+            std::memcpy(&r.conn, p + 8, 8);
+            std::memcpy(&len, p + 16, 4);
+            if (end_ - pos_ - capture::record_header_size < len) return false;
+            r.data = std::string_view(p + capture::record_header_size, len);
+            pos_ += capture::record_header_size + len;
+            return true;
+        }
+
+        void rewind() noexcept { pos_ = capture::header_size; }
+
+        void close() {
+            if (base_) ::munmap(const_cast<char*>(base_), mapped_);
+            base_ = nullptr;
+            mapped_ = end_ = pos_ = 0;
+            count_ = 0;
+        }
+
+    private:
+        const char* base_ = nullptr;
+        std::size_t mapped_ = 0;
+        std::size_t end_ = 0;
+        std::size_t pos_ = 0;
+        std::uint64_t count_ = 0;
+    };
+
+    // Plays a capture against a framed server: every captured connection gets its own
+    // TcpClient and thread, and its frames are re-sent on the captured schedule scaled by
+    // `speed` (2.0 = twice as fast, 0 = back to back). With await_replies each frame waits
+    // for one reply frame and the round trip is recorded; a connection whose replies fall
+    // behind its schedule sends late rather than piling up requests.
+    class ReplayDriver {
+    public:
+        struct Options {
+            double speed = 1.0;
+            bool await_replies = true;
+            int timeout_ms = 3000;
+        };
+
+        struct Report {
+            std::uint64_t sent = 0;
+            std::uint64_t replies = 0;
+            std::uint64_t errors = 0;
+            std::uint64_t late = 0;  // sent over 1ms behind schedule
+            std::size_t connections = 0;
+            double seconds = 0;
+            std::chrono::microseconds p50{0};
+            std::chrono::microseconds p99{0};
+            std::chrono::microseconds max{0};
+            double throughput() const noexcept { return seconds > 0 ? static_cast<double>(sent) / seconds : 0.0; }
+        };
+
+        ReplayDriver(std::string host, int port) : ReplayDriver(std::move(host), port, Options{}) {}
+        ReplayDriver(std::string host, int port, Options options) : host_(std::move(host)), port_(port), options_(options) {}
+
+        Report run(CaptureReader& capture) {
+            std::unordered_map<std::uint64_t, std::vector<CaptureReader::Record>> by_conn;
+            capture.rewind();
+            CaptureReader::Record r;
+            while (capture.next(r)) by_conn[r.conn].push_back(r);
+
+            struct Result {
+                std::uint64_t sent = 0, replies = 0, errors = 0, late = 0;
+                std::vector<std::int64_t> latencies;
+            };
+            std::vector<Result> results(by_conn.size());
+            std::vector<std::thread> threads;
+            const auto start = std::chrono::steady_clock::now() + std::chrono::milliseconds(5);  // let threads spin up
+            std::size_t i = 0;
+            for (auto& kv : by_conn) {
+                threads.emplace_back([this, start, &records = kv.second, &out = results[i++]] { play(start, records, out); });
+            }
+            for (auto& t : threads) t.join();
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+
+            Report report;
+            report.connections = by_conn.size();
+            report.seconds = std::chrono::duration<double>(elapsed).count();
+            std::vector<std::int64_t> all;
+            for (auto& res : results) {
+                report.sent += res.sent;
+                report.replies += res.replies;
+                report.errors += res.errors;
+                report.late += res.late;
+                all.insert(all.end(), res.latencies.begin(), res.latencies.end());
+            }
+            if (!all.empty()) {
+                std::sort(all.begin(), all.end());
+                report.p50 = std::chrono::microseconds(all[(all.size() - 1) / 2]);
+                report.p99 = std::chrono::microseconds(all[(all.size() - 1) * 99 / 100]);
+                report.max = std::chrono::microseconds(all.back());
+            }
+            return report;
+        }
+
+    private:
+        template <typename Result>
+        void play(std::chrono::steady_clock::time_point start, const std::vector<CaptureReader::Record>& records, Result& out) {
+            TcpClient client;
+            if (!client.connect(host_, port_, options_.timeout_ms)) {
+                out.errors += records.size();
+                return;
+            }
+            std::string reply;
+            for (const auto& rec : records) {
+                if (options_.speed > 0) {
+                    const auto due = start + std::chrono::nanoseconds(static_cast<std::int64_t>(static_cast<double>(rec.time_ns) / options_.speed));
+                    const auto now = std::chrono::steady_clock::now();
+                    if (due > now) {
+                        hypersleep(due - now);
+                    } else if (now - due > std::chrono::milliseconds(1)) {
+                        ++out.late;
+                    }
+                }
+                const auto sent_at = std::chrono::steady_clock::now();
+                if (!client.sendFrame(rec.data.data(), static_cast<std::uint32_t>(rec.data.size()))) {
+                    ++out.errors;
+                    return;
+                }
+                ++out.sent;
+                if (!options_.await_replies) continue;
+                if (!client.recvFrame(reply, options_.timeout_ms)) {
+                    ++out.errors;
+                    return;
+                }
+                ++out.replies;
+                out.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sent_at).count());
+            }
+        }
+
+        std::string host_;
+        int port_;
+        Options options_;
+    };
+}
+
+#endif
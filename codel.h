@@ -0,0 +1,122 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace cpplib {
+    // Queue-latency admission control after CoDel (Nichols & Jacobson). Every unit of work
+    // reports how long it sat queued when it is picked up. While sojourn times stay above
+    // `target` for a whole `interval` (i.e. even the minimum is too high, so the queue is a
+    // standing one rather than a burst) the controller is overloaded: new work is refused
+    // and queued work is shed at a rate that grows with the square root of the drop count.
+    // The first sojourn below target, or an empty queue, ends the episode. Work is assumed
+    // to leave in the order it was admitted. Thread-safe.
+    class CoDel {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        struct Options {
+            std::chrono::microseconds target{5000};
+            std::chrono::microseconds interval{100000};
+        };
+
+        struct Stats {
+            std::uint64_t admitted = 0;
+            std::uint64_t rejected = 0;   // refused by admit()
+            std::uint64_t shed = 0;       // dropped by onDequeue()
+            std::uint64_t episodes = 0;   // times the controller entered overload
+        };
+
+        CoDel() : CoDel(Options{}) {}
+        explicit CoDel(Options options) : options_(options) {}
+
+        // Asks to queue new work. On true the caller must pair it with onDequeue(). The
+        // oldest queued item's wait so far also counts as a sample, so a queue that stops
+        // moving altogether is caught without waiting for a dequeue.
+        bool admit(clock::time_point now = clock::now()) {
+            std::lock_guard<std::mutex> lk(mutex_);
+            if (dropping_ && queued_.empty()) {
+                dropping_ = false;  // drained: nothing left to measure, start fresh
+                first_above_ = clock::time_point{};
+            }
+            if (!dropping_ && !queued_.empty() && now - queued_.front() >= options_.target) {
+                if (first_above_ == clock::time_point{}) {
+                    first_above_ = now + options_.interval;
+                } else if (now >= first_above_) {
+                    enterDropping(now);
+                }
+            }
+            if (dropping_) {
+                ++stats_.rejected;
+                return false;
+            }
+            queued_.push_back(now);
+            ++stats_.admitted;
+            return true;
+        }
+
+        // Reports work leaving the queue after `sojourn`. Returns false if it should be
+        // failed fast instead of served.
+        bool onDequeue(clock::duration sojourn, clock::time_point now = clock::now()) {
+            std::lock_guard<std::mutex> lk(mutex_);
+            if (!queued_.empty()) queued_.pop_front();
+            if (sojourn < options_.target) {
+                first_above_ = clock::time_point{};
+                dropping_ = false;
+                return true;
+            }
+            if (!dropping_) {
+                if (first_above_ == clock::time_point{}) {
+                    first_above_ = now + options_.interval;
+                    return true;
+                }
+                if (now < first_above_) {
+                    return true;
+                }
+                enterDropping(now);
+            }
+            if (now < drop_next_) {
+                return true;
+            }
+            ++stats_.shed;
+            ++count_;
+            drop_next_ = now + controlLaw();
+            return false;
+        }
+
+        bool overloaded() const {
+            std::lock_guard<std::mutex> lk(mutex_);
+            return dropping_;
+        }
+
+        Stats stats() const {
+            std::lock_guard<std::mutex> lk(mutex_);
+            return stats_;
+        }
+
+    private:
+        void enterDropping(clock::time_point now) {
+            dropping_ = true;
+            ++stats_.episodes;
+            // Resume near the previous drop rate if the last episode ended recently.
+            count_ = (now - drop_next_ < 16 * options_.interval && count_ > 2) ? count_ - 2 : 1;
+            drop_next_ = now;
+        }
+
+        clock::duration controlLaw() const {
+            return std::chrono::duration_cast<clock::duration>(options_.interval / std::sqrt(static_cast<double>(count_)));
+        }
+
+        Options options_;
+        mutable std::mutex mutex_;
+        Stats stats_;
+        std::deque<clock::time_point> queued_;  // admission times, oldest first
+        std::uint64_t count_ = 0;
+        bool dropping_ = false;
+        clock::time_point first_above_{};
+        clock::time_point drop_next_{};
+    };
+}
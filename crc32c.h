@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+    #include <nmmintrin.h>
+    #define CPPLIB_CRC32C_X86 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+    #include <arm_acle.h>
+    #define CPPLIB_CRC32C_ARM 1
+#endif
+
+namespace cpplib {
+    // CRC-32C (Castagnoli). Uses the SSE4.2 crc32 instruction when the CPU has it (checked
+    // once at runtime) or the ARMv8 CRC extension when compiled for it, otherwise a
+    // slicing-by-8 table. The hardware path runs three independent streams to hide the
+    // instruction's latency and folds them back together with precomputed shift operators.
+    namespace detail {
+        constexpr std::uint32_t crc32c_poly = 0x82F63B78u;  // reflected
+
+        struct Crc32cTables {
+            std::uint32_t slice[8][256];
+            std::uint32_t long_shift[4][256];
+            std::uint32_t short_shift[4][256];
+        };
+
+        constexpr std::size_t crc32c_long = 8192;
+        constexpr std::size_t crc32c_short = 256;
+
+        inline std::uint32_t gf2MatrixTimes(const std::uint32_t* mat, std::uint32_t vec) noexcept {
+            std::uint32_t sum = 0;
+            while (vec) {
+                if (vec & 1) sum ^= *mat;
+                vec >>= 1;
+                ++mat;
+            }
+            return sum;
+        }
+
+        inline void gf2MatrixSquare(std::uint32_t* square, const std::uint32_t* mat) noexcept {
+            for (int n = 0; n < 32; ++n) square[n] = gf2MatrixTimes(mat, mat[n]);
+        }
+
+        // Operator that appends len zero bytes to a CRC, as byte-wise lookup tables.
+        inline void crc32cZerosTables(std::uint32_t zeros[4][256], std::size_t len) noexcept {
+            std::uint32_t even[32], odd[32], op[32];
+            odd[0] = crc32c_poly;
+            std::uint32_t row = 1;
+            for (int n = 1; n < 32; ++n) {
+                odd[n] = row;
+                row <<= 1;
+            }
+            gf2MatrixSquare(even, odd);  // 2 zero bits
+            gf2MatrixSquare(odd, even);  // 4 zero bits
+            // The first square below yields one zero byte; keep squaring per bit of len.
+            bool have = false;
+            std::uint32_t* cur = even;
+            std::uint32_t* other = odd;
+            do {
+                gf2MatrixSquare(cur, other);
+                if (len & 1) {
+                    if (!have) {
+                        std::memcpy(op, cur, sizeof(op));
+                        have = true;
+                    } else {
+                        std::uint32_t tmp[32];
+                        for (int n = 0; n < 32; ++n) tmp[n] = gf2MatrixTimes(cur, op[n]);
+                        std::memcpy(op, tmp, sizeof(op));
+                    }
+                }
+                len >>= 1;
+                std::uint32_t* t = cur;
+                cur = other;
+                other = t;
+            } while (len);
+            for (std::uint32_t n = 0; n < 256; ++n) {
+                zeros[0][n] = gf2MatrixTimes(op, n);
+                zeros[1][n] = gf2MatrixTimes(op, n << 8);
+                zeros[2][n] = gf2MatrixTimes(op, n << 16);
+                zeros[3][n] = gf2MatrixTimes(op, n << 24);
+            }
+        }
+
+        inline std::uint32_t crc32cShift(const std::uint32_t zeros[4][256], std::uint32_t crc) noexcept {
+            return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff] ^ zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+        }
+
+        inline const Crc32cTables& crc32cTables() {
+            static const Crc32cTables tables = [] {
+                Crc32cTables t{};
+                for (std::uint32_t n = 0; n < 256; ++n) {
+                    std::uint32_t crc = n;
+                    for (int k = 0; k < 8; ++k) crc = crc & 1 ? (crc >> 1) ^ crc32c_poly : crc >> 1;
+                    t.slice[0][n] = crc;
+                }
+                for (std::uint32_t n = 0; n < 256; ++n) {
+                    std::uint32_t crc = t.slice[0][n];
+                    for (int k = 1; k < 8; ++k) {
+                        crc = t.slice[0][crc & 0xff] ^ (crc >> 8);
+                        t.slice[k][n] = crc;
+                    }
+                }
+                crc32cZerosTables(t.long_shift, crc32c_long);
+                crc32cZerosTables(t.short_shift, crc32c_short);
+                return t;
+            }();
+            return tables;
+        }
+
+        // Operates on the pre/post-inverted register value.
+        inline std::uint32_t crc32cSoftware(std::uint32_t crc, const unsigned char* p, std::size_t n) noexcept {
+            const auto& t = crc32cTables().slice;
+            while (n && (reinterpret_cast<std::uintptr_t>(p) & 7)) {
+                crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+                --n;
+            }
+            while (n >= 8) {
+                std::uint64_t word;
+                std::memcpy(&word, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                word = __builtin_bswap64(word);
+#endif
+                word ^= crc;
+                crc = t[7][word & 0xff] ^ t[6][(word >> 8) & 0xff] ^ t[5][(word >> 16) & 0xff] ^
+                      t[4][(word >> 24) & 0xff] ^ t[3][(word >> 32) & 0xff] ^ t[2][(word >> 40) & 0xff] ^
+                      t[1][(word >> 48) & 0xff] ^ t[0][word >> 56];
+                p += 8;
+                n -= 8;
+            }
+            while (n--) crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+            return crc;
+        }
+
+#if defined(CPPLIB_CRC32C_X86) || defined(CPPLIB_CRC32C_ARM)
+    #if defined(CPPLIB_CRC32C_X86)
+        #define CPPLIB_CRC32C_TARGET __attribute__((target("sse4.2")))
+        CPPLIB_CRC32C_TARGET inline std::uint64_t crc32cStep64(std::uint64_t crc, std::uint64_t v) noexcept { return _mm_crc32_u64(crc, v); }
+        CPPLIB_CRC32C_TARGET inline std::uint32_t crc32cStep8(std::uint32_t crc, unsigned char v) noexcept { return _mm_crc32_u8(crc, v); }
+    #else
+        #define CPPLIB_CRC32C_TARGET
+        inline std::uint64_t crc32cStep64(std::uint64_t crc, std::uint64_t v) noexcept { return __crc32cd(static_cast<std::uint32_t>(crc), v); }
+        inline std::uint32_t crc32cStep8(std::uint32_t crc, unsigned char v) noexcept { return __crc32cb(crc, v); }
+    #endif
+
+        // Three interleaved streams over blocks of 3 * L bytes, then folded: crc(A|B|C) =
+        // shift_L(shift_L(crc(A)) ^ crc(B)) ^ crc(C), with the B and C streams started at 0.
+        template <std::size_t L>
+        CPPLIB_CRC32C_TARGET inline const unsigned char* crc32cTriple(std::uint32_t& crc, const unsigned char* p, std::size_t& n,
+                                                                       const std::uint32_t shift[4][256]) noexcept {
+            while (n >= 3 * L) {
+                std::uint64_t c0 = crc, c1 = 0, c2 = 0;
+                const unsigned char* end = p + L;
+                do {
+                    std::uint64_t a, b, c;
+                    std::memcpy(&a, p, 8);
+                    std::memcpy(&b, p + L, 8);
+                    std::memcpy(&c, p + 2 * L, 8);
+                    c0 = crc32cStep64(c0, a);
+                    c1 = crc32cStep64(c1, b);
+                    c2 = crc32cStep64(c2, c);
+                    p += 8;
+                } while (p < end);
+                crc = crc32cShift(shift, static_cast<std::uint32_t>(c0)) ^ static_cast<std::uint32_t>(c1);
+                crc = crc32cShift(shift, crc) ^ static_cast<std::uint32_t>(c2);
+                p += 2 * L;
+                n -= 3 * L;
+            }
+            return p;
+        }
+
+        CPPLIB_CRC32C_TARGET inline std::uint32_t crc32cHardware(std::uint32_t crc, const unsigned char* p, std::size_t n) noexcept {
+            const auto& t = crc32cTables();
+            while (n && (reinterpret_cast<std::uintptr_t>(p) & 7)) {
+                crc = crc32cStep8(crc, *p++);
+                --n;
+            }
+            p = crc32cTriple<crc32c_long>(crc, p, n, t.long_shift);
+            p = crc32cTriple<crc32c_short>(crc, p, n, t.short_shift);
+            std::uint64_t c = crc;
+            while (n >= 8) {
+                std::uint64_t v;
+                std::memcpy(&v, p, 8);
+                c = crc32cStep64(c, v);
+                p += 8;
+                n -= 8;
+            }
+            crc = static_cast<std::uint32_t>(c);
+            while (n--) crc = crc32cStep8(crc, *p++);
+            return crc;
+        }
+
+        inline bool crc32cHardwareAvailable() noexcept {
+    #if defined(CPPLIB_CRC32C_X86)
+            static const bool available = __builtin_cpu_supports("sse4.2");
+            return available;
+    #else
+            return true;
+    #endif
+        }
+#endif
+    }
+
+    // Extends `crc` (the result of a previous call, 0 to start) over n more bytes.
+    inline std::uint32_t crc32c(const void* data, std::size_t n, std::uint32_t crc = 0) noexcept {
+        const auto* p = static_cast<const unsigned char*>(data);
+        crc = ~crc;
+#if defined(CPPLIB_CRC32C_X86) || defined(CPPLIB_CRC32C_ARM)
+        if (detail::crc32cHardwareAvailable()) {
+            return ~detail::crc32cHardware(crc, p, n);
+        }
+#endif
+        return ~detail::crc32cSoftware(crc, p, n);
+    }
+
+    // Copies n bytes and checksums them in the same pass, while each chunk is still in L1.
+    inline std::uint32_t crc32cCopy(void* dst, const void* src, std::size_t n, std::uint32_t crc = 0) noexcept {
+        constexpr std::size_t chunk = 4096;
+        auto* d = static_cast<unsigned char*>(dst);
+        const auto* s = static_cast<const unsigned char*>(src);
+        while (n) {
+            const std::size_t take = n < chunk ? n : chunk;
+            std::memcpy(d, s, take);
+            crc = crc32c(d, take, crc);
+            d += take;
+            s += take;
+            n -= take;
+        }
+        return crc;
+    }
+}
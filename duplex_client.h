@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame.h"
+#include "tcp.h"
+
+namespace cpplib {
+    // Framed client for one reading thread and any number of writing threads. Writers
+    // push encoded frames onto a lock-free list; whichever writer finds no write in
+    // progress becomes the writer, sends everything queued so far with one gathered write
+    // and hands the role back. A writer whose frame is still queued when it finds the role
+    // taken waits for that one write to end, then takes the role itself, so no call writes
+    // more than one batch however busy the other threads are. Frames never interleave, a
+    // writer never waits for a lock, and a thread's frames go out in the order it sent
+    // them. Receiving shares nothing with the send side, so recvFrame() runs concurrently.
+    //
+    // sendFrame() returning true means the frame was queued on a healthy connection; it
+    // may be written by another thread a moment later. After a write error every queued
+    // frame is dropped and failed() turns true. Configure and connect before sharing.
+    class DuplexClient {
+    public:
+        struct Stats {
+            std::uint64_t frames = 0;
+            std::uint64_t writes = 0;  // gathered writes; frames / writes is the batching
+        };
+
+        DuplexClient() = default;
+        ~DuplexClient() { discard(head_.exchange(nullptr)); }
+
+        DuplexClient(const DuplexClient&) = delete;
+        DuplexClient& operator=(const DuplexClient&) = delete;
+
+        bool connect(const std::string& host, int port, int timeout_ms = 3000) {
+            failed_ = false;
+            return client_.connect(host, port, timeout_ms);
+        }
+
+        void setCompression(std::size_t threshold) { compress_threshold_ = threshold; }
+        void setChecksum(bool on) { checksum_ = on; }
+
+        bool sendFrame(const void* data, std::uint32_t len) {
+            if (failed_) return false;
+            if (len > frame::length_mask - (checksum_ ? frame::checksum_size : 0)) return false;
+            auto* node = new Node;
+            frame::append(node->bytes, data, len, compress_threshold_, checksum_);
+            // Treiber push; the writer takes the whole list at once, so there is no ABA.
+            node->next = head_.load();
+            while (!head_.compare_exchange_weak(node->next, node)) {}
+            drain();
+            return !failed_;
+        }
+
+        bool sendFrame(const std::string& s) { return sendFrame(s.data(), static_cast<std::uint32_t>(s.size())); }
+
+        // One thread at a time.
+        bool recvFrame(std::vector<std::uint8_t>& out, int timeout_ms) { return client_.recvFrame(out, timeout_ms); }
+        bool recvFrame(std::string& out, int timeout_ms) { return client_.recvFrame(out, timeout_ms); }
+
+        bool failed() const noexcept { return failed_; }
+
+        Stats stats() const noexcept {
+            Stats s;
+            s.frames = frames_.load(std::memory_order_relaxed);
+            s.writes = writes_.load(std::memory_order_relaxed);
+            return s;
+        }
+
+        // Call once no thread is sending any more.
+        void close() {
+            client_.close();
+            discard(head_.exchange(nullptr));
+        }
+
+        TcpClient& client() noexcept { return client_; }
+
+    private:
+        struct Node {
+            std::string bytes;
+            Node* next = nullptr;
+        };
+
+        // One batch per call. grabs_ counts batches taken off the list and is bumped
+        // before the take, so once it moves past the value read after our push, our frame
+        // is in a batch and this thread is done. Everything is seq_cst.
+        void drain() {
+            const std::uint64_t pushed_at = grabs_.load();
+            while (head_.load() != nullptr && grabs_.load() == pushed_at) {
+                if (writing_.exchange(true)) {
+                    while (writing_.load()) std::this_thread::yield();  // one write, not a lock
+                    continue;
+                }
+                grabs_.fetch_add(1);
+                Node* batch = reverse(head_.exchange(nullptr));
+                if (failed_) {
+                    discard(batch);
+                } else {
+                    write(batch);
+                }
+                writing_.store(false);
+                return;
+            }
+        }
+
+        void write(Node* batch) {
+            slices_.clear();
+            std::size_t total = 0;
+            for (Node* n = batch; n; n = n->next) {
+                slices_.push_back(IoSlice{n->bytes.data(), n->bytes.size()});
+                total += n->bytes.size();
+            }
+            const auto sent = client_.socket().send_all(slices_.data(), slices_.size());
+            if (sent != static_cast<std::ptrdiff_t>(total)) failed_ = true;
+            frames_.fetch_add(slices_.size(), std::memory_order_relaxed);
+            writes_.fetch_add(1, std::memory_order_relaxed);
+            discard(batch);
+        }
+
+        // The list comes off the stack newest first.
+        static Node* reverse(Node* n) noexcept {
+            Node* out = nullptr;
+            while (n) {
+                Node* next = n->next;
+                n->next = out;
+                out = n;
+                n = next;
+            }
+            return out;
+        }
+
+        static void discard(Node* n) noexcept {
+            while (n) {
+                Node* next = n->next;
+                delete n;
+                n = next;
+            }
+        }
+
+        TcpClient client_;
+        std::atomic<Node*> head_{nullptr};
+        std::atomic<bool> writing_{false};
+        std::atomic<std::uint64_t> grabs_{0};
+        std::atomic<bool> failed_{false};
+        std::vector<IoSlice> slices_;  // used only by the current writer
+        std::size_t compress_threshold_ = 0;
+        bool checksum_ = false;
+        std::atomic<std::uint64_t> frames_{0};
+        std::atomic<std::uint64_t> writes_{0};
+    };
+}
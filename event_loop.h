@@ -0,0 +1,409 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#define CPPLIB_HAS_EVENT_LOOP 1
+
+namespace cpplib {
+    // Single-threaded reactor: fd readiness (epoll), timers (one timerfd) and cross-thread
+    // post() (eventfd) all dispatch from the thread that calls run(). post(), stop(),
+    // runAfter(), runEvery() and cancel() may be called from any thread; add(), modify()
+    // and remove() must be called on the loop thread or before run() starts.
+    class EventLoop {
+    public:
+        using Callback   = std::function<void()>;
+        using IoCallback = std::function<void(std::uint32_t events)>;
+        using TimerId    = std::uint64_t;
+        using clock      = std::chrono::steady_clock;
+
+        static constexpr std::uint32_t READABLE = EPOLLIN;
+        static constexpr std::uint32_t WRITABLE = EPOLLOUT;
+        static constexpr std::uint32_t HANGUP   = EPOLLHUP | EPOLLRDHUP;
+        static constexpr std::uint32_t ERROR    = EPOLLERR;
+        static constexpr std::uint32_t EDGE     = EPOLLET;
+
+        EventLoop() {
+            epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+            if (epfd_ < 0) {
+                throw std::system_error(errno, std::system_category(), "epoll_create1 failed");
+            }
+            wakefd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            timerfd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (wakefd_ < 0 || timerfd_ < 0) {
+                const int err = errno;
+                closeFds();
+                throw std::system_error(err, std::system_category(), "eventfd/timerfd_create failed");
+            }
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u64 = tag(wakefd_, 0);
+            ::epoll_ctl(epfd_, EPOLL_CTL_ADD, wakefd_, &ev);
+            ev.data.u64 = tag(timerfd_, 0);
+            ::epoll_ctl(epfd_, EPOLL_CTL_ADD, timerfd_, &ev);
+        }
+
+        ~EventLoop() { closeFds(); }
+
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        void run() {
+            owner_.store(std::this_thread::get_id(), std::memory_order_release);
+            running_.store(true, std::memory_order_release);
+            while (!stop_requested_.load(std::memory_order_acquire)) {
+                runOnce(-1);
+            }
+            runPosted();
+            running_.store(false, std::memory_order_release);
+            stop_requested_.store(false, std::memory_order_release);
+            owner_.store(std::thread::id{}, std::memory_order_release);
+        }
+
+        // One epoll_wait and the dispatch that follows. Returns the number of fd events.
+        int runOnce(int timeout_ms) {
+            epoll_event events[128];
+            int n = ::epoll_wait(epfd_, events, 128, timeout_ms);
+            if (n < 0) {
+                return errno == EINTR ? 0 : -1;
+            }
+            int io = 0;
+            for (int i = 0; i < n; ++i) {
+                const int fd = static_cast<int>(events[i].data.u64 & 0xffffffffu);
+                if (fd == wakefd_) {
+                    std::uint64_t v;
+                    while (::read(wakefd_, &v, sizeof(v)) > 0) {}
+                    continue;
+                }
+                if (fd == timerfd_) {
+                    std::uint64_t v;
+                    while (::read(timerfd_, &v, sizeof(v)) > 0) {}
+                    runTimers();
+                    continue;
+                }
+                // An fd removed earlier in this batch may already be re-added for a new
+                // connection; its stale event carries the old generation and is dropped.
+                auto it = handlers_.find(fd);
+                if (it == handlers_.end() || it->second.generation != (events[i].data.u64 >> 32)) {
+                    continue;
+                }
+                auto handler = it->second.callback;  // keep alive if the callback removes itself
+                (*handler)(events[i].events);
+                ++io;
+            }
+            runPosted();
+            return io;
+        }
+
+        void stop() {
+            stop_requested_.store(true, std::memory_order_release);
+            wake();
+        }
+
+        bool running() const noexcept { return running_.load(std::memory_order_acquire); }
+
+        bool inLoopThread() const noexcept {
+            return owner_.load(std::memory_order_acquire) == std::this_thread::get_id();
+        }
+
+        void post(Callback cb) {
+            bool was_empty;
+            {
+                std::lock_guard<std::mutex> lk(posted_mtx_);
+                was_empty = posted_.empty();
+                posted_.push_back(std::move(cb));
+            }
+            if (was_empty) {
+                wake();
+            }
+        }
+
+        // Runs inline when already on the loop thread, otherwise posts.
+        void dispatch(Callback cb) {
+            if (inLoopThread()) {
+                cb();
+            } else {
+                post(std::move(cb));
+            }
+        }
+
+        bool add(int fd, std::uint32_t events, IoCallback cb) {
+            if (++generation_ == 0) ++generation_;  // 0 tags the loop's own fds
+            const std::uint32_t generation = generation_;
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.u64 = tag(fd, generation);
+            if (::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                return false;
+            }
+            handlers_[fd] = Handler{generation, std::make_shared<IoCallback>(std::move(cb))};
+            return true;
+        }
+
+        bool modify(int fd, std::uint32_t events) {
+            auto it = handlers_.find(fd);
+            if (it == handlers_.end()) {
+                return false;
+            }
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.u64 = tag(fd, it->second.generation);
+            return ::epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+        }
+
+        bool remove(int fd) {
+            if (handlers_.erase(fd) == 0) {
+                return false;
+            }
+            ::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+            return true;
+        }
+
+        std::size_t numHandlers() const noexcept { return handlers_.size(); }
+
+        template <typename Rep, typename Period>
+        TimerId runAfter(std::chrono::duration<Rep, Period> delay, Callback cb) {
+            return addTimer(std::chrono::duration_cast<clock::duration>(delay), clock::duration::zero(), std::move(cb));
+        }
+
+        template <typename Rep, typename Period>
+        TimerId runEvery(std::chrono::duration<Rep, Period> interval, Callback cb) {
+            const auto d = std::chrono::duration_cast<clock::duration>(interval);
+            return addTimer(d, d, std::move(cb));
+        }
+
+        void cancel(TimerId id) {
+            dispatch([this, id] {
+                auto it = timers_.find(id);
+                if (it == timers_.end()) {
+                    return;
+                }
+                eraseDeadline(it->second.deadline, id);
+                timers_.erase(it);
+                armTimerfd();
+            });
+        }
+
+    private:
+        struct Timer {
+            clock::time_point deadline;
+            clock::duration interval;
+            Callback cb;
+        };
+
+        TimerId addTimer(clock::duration delay, clock::duration interval, Callback cb) {
+            const TimerId id = next_timer_.fetch_add(1, std::memory_order_relaxed);
+            const auto deadline = clock::now() + delay;
+            dispatch([this, id, deadline, interval, cb = std::move(cb)]() mutable {
+                timers_.emplace(id, Timer{deadline, interval, std::move(cb)});
+                deadlines_.emplace(deadline, id);
+                armTimerfd();
+            });
+            return id;
+        }
+
+        void eraseDeadline(clock::time_point deadline, TimerId id) {
+            auto range = deadlines_.equal_range(deadline);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == id) {
+                    deadlines_.erase(it);
+                    return;
+                }
+            }
+        }
+
+        void runTimers() {
+            const auto now = clock::now();
+            while (!deadlines_.empty() && deadlines_.begin()->first <= now) {
+                const TimerId id = deadlines_.begin()->second;
+                deadlines_.erase(deadlines_.begin());
+                auto it = timers_.find(id);
+                if (it == timers_.end()) {
+                    continue;
+                }
+                Callback cb;
+                if (it->second.interval > clock::duration::zero()) {
+                    it->second.deadline += it->second.interval;
+                    if (it->second.deadline <= now) {
+                        it->second.deadline = now + it->second.interval;  // fell behind; skip missed ticks
+                    }
+                    deadlines_.emplace(it->second.deadline, id);
+                    cb = it->second.cb;
+                } else {
+                    cb = std::move(it->second.cb);
+                    timers_.erase(it);
+                }
+                cb();
+            }
+            armTimerfd();
+        }
+
+        void armTimerfd() {
+            itimerspec spec{};
+            if (!deadlines_.empty()) {
+                // steady_clock is CLOCK_MONOTONIC on Linux, so deadlines can be armed as absolute.
+                const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    deadlines_.begin()->first.time_since_epoch()).count();
+                spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+                spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+                if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+                    spec.it_value.tv_nsec = 1;  // all-zero would disarm
+                }
+            }
+            ::timerfd_settime(timerfd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+        }
+
+        void runPosted() {
+            std::vector<Callback> batch;
+            {
+                std::lock_guard<std::mutex> lk(posted_mtx_);
+                batch.swap(posted_);
+            }
+            for (auto& cb : batch) {
+                cb();
+            }
+        }
+
+        void wake() noexcept {
+            const std::uint64_t one = 1;
+            [[maybe_unused]] auto r = ::write(wakefd_, &one, sizeof(one));
+        }
+
+        void closeFds() noexcept {
+            if (timerfd_ >= 0) ::close(timerfd_);
+            if (wakefd_ >= 0) ::close(wakefd_);
+            if (epfd_ >= 0) ::close(epfd_);
+            timerfd_ = wakefd_ = epfd_ = -1;
+        }
+
+        int epfd_ = -1;
+        int wakefd_ = -1;
+        int timerfd_ = -1;
+        std::atomic<bool> running_{false};
+        std::atomic<bool> stop_requested_{false};
+        std::atomic<std::thread::id> owner_{};
+
+        struct Handler {
+            std::uint32_t generation = 0;
+            std::shared_ptr<IoCallback> callback;
+        };
+
+        // epoll data: fd in the low half, the registration's generation in the high half.
+        static std::uint64_t tag(int fd, std::uint32_t generation) noexcept {
+            return (std::uint64_t(generation) << 32) | static_cast<std::uint32_t>(fd);
+        }
+
+        std::unordered_map<int, Handler> handlers_;
+        std::uint32_t generation_ = 0;
+        std::unordered_map<TimerId, Timer> timers_;
+        std::multimap<clock::time_point, TimerId> deadlines_;
+        std::atomic<TimerId> next_timer_{1};
+
+        std::mutex posted_mtx_;
+        std::vector<Callback> posted_;
+    };
+
+    // N loops on N threads, each pinned to its own CPU from the process affinity mask.
+    // Building block for thread-per-core components.
+    class EventLoopGroup {
+    public:
+        explicit EventLoopGroup(std::size_t loops = 0, bool pin = true) {
+            const auto cpus = allowedCpus();
+            if (loops == 0) {
+                loops = cpus.empty() ? 1 : cpus.size();
+            }
+            loops_.reserve(loops);
+            cpus_.reserve(loops);
+            for (std::size_t i = 0; i < loops; ++i) {
+                loops_.push_back(std::make_unique<EventLoop>());
+                cpus_.push_back(pin && !cpus.empty() ? cpus[i % cpus.size()] : -1);
+            }
+        }
+
+        ~EventLoopGroup() { stop(); }
+
+        EventLoopGroup(const EventLoopGroup&) = delete;
+        EventLoopGroup& operator=(const EventLoopGroup&) = delete;
+
+        void start() {
+            if (!threads_.empty()) {
+                return;
+            }
+            for (std::size_t i = 0; i < loops_.size(); ++i) {
+                threads_.emplace_back([this, i] {
+                    if (cpus_[i] >= 0) {
+                        pinCurrentThread(cpus_[i]);
+                    }
+                    loops_[i]->run();
+                });
+            }
+        }
+
+        void stop() {
+            for (auto& loop : loops_) {
+                loop->stop();
+            }
+            for (auto& t : threads_) {
+                if (t.joinable()) {
+                    t.join();
+                }
+            }
+            threads_.clear();
+        }
+
+        std::size_t size() const noexcept { return loops_.size(); }
+        EventLoop& at(std::size_t i) { return *loops_[i]; }
+        int cpuOf(std::size_t i) const { return cpus_[i]; }
+
+        EventLoop& next() {
+            return *loops_[next_.fetch_add(1, std::memory_order_relaxed) % loops_.size()];
+        }
+
+        static bool pinCurrentThread(int cpu) noexcept {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+        }
+
+        static std::vector<int> allowedCpus() {
+            std::vector<int> cpus;
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+                for (int c = 0; c < CPU_SETSIZE; ++c) {
+                    if (CPU_ISSET(c, &set)) cpus.push_back(c);
+                }
+            }
+            return cpus;
+        }
+
+    private:
+        std::vector<std::unique_ptr<EventLoop>> loops_;
+        std::vector<int> cpus_;
+        std::vector<std::thread> threads_;
+        std::atomic<std::size_t> next_{0};
+    };
+}
+
+#endif
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "crc32c.h"
+#include "lz.h"
+
+namespace cpplib {
+    // Wire format shared by TcpClient::sendFrame/recvFrame and server-side decoding: a
+    // 4-byte big-endian header whose low bits are the body length and whose high bits are
+    // flags, followed by the body. A checksummed body starts with the 4-byte big-endian
+    // CRC-32C of the rest of the body as sent. A compressed payload starts with the 4-byte
+    // big-endian uncompressed length followed by an lz block.
+    namespace frame {
+        constexpr std::uint32_t compressed  = 0x80000000u;
+        constexpr std::uint32_t checksummed = 0x40000000u;
+        constexpr std::uint32_t length_mask = 0x3FFFFFFFu;
+        constexpr std::size_t   header_size = 4;
+        constexpr std::size_t   checksum_size = 4;
+
+        inline void putBe32(char* p, std::uint32_t v) noexcept {
+            p[0] = static_cast<char>(v >> 24);
+            p[1] = static_cast<char>(v >> 16);
+            p[2] = static_cast<char>(v >> 8);
+            p[3] = static_cast<char>(v);
+        }
+
+        inline std::uint32_t getBe32(const char* p) noexcept {
+            const auto* u = reinterpret_cast<const unsigned char*>(p);
+            return (static_cast<std::uint32_t>(u[0]) << 24) | (static_cast<std::uint32_t>(u[1]) << 16) |
+                   (static_cast<std::uint32_t>(u[2]) << 8) | u[3];
+        }
+
+        // Appends one encoded frame to out. Payloads of at least compress_threshold bytes
+        // (0 disables) are sent compressed when that actually makes them smaller.
+        inline void append(std::string& out, const void* data, std::uint32_t len, std::size_t compress_threshold = 0,
+                           bool checksum = false) {
+            const std::size_t at = out.size();
+            const std::size_t pre = header_size + (checksum ? checksum_size : 0);
+            std::uint32_t flags = checksum ? checksummed : 0;
+            out.resize(at + pre);
+            if (compress_threshold && len >= compress_threshold) {
+                out.resize(at + pre + 4 + lz::compressBound(len));
+                const std::size_t c = lz::compress(data, len, &out[at + pre + 4], lz::compressBound(len));
+                if (c != 0 && c + 4 < len) {
+                    putBe32(&out[at + pre], len);
+                    out.resize(at + pre + 4 + c);
+                    flags |= compressed;
+                } else {
+                    out.resize(at + pre);
+                }
+            }
+            if (!(flags & compressed)) {
+                out.append(static_cast<const char*>(data), len);
+            }
+            putBe32(&out[at], static_cast<std::uint32_t>(out.size() - at - header_size) | flags);
+            if (checksum) {
+                putBe32(&out[at + header_size], crc32c(&out[at + pre], out.size() - at - pre));
+            }
+        }
+
+        // Turns a received payload (checksum already stripped) into the message. `body` is
+        // replaced by the decoded bytes when the frame was compressed. Returns false on a
+        // corrupt body.
+        inline bool decodeBody(std::uint32_t header, std::vector<std::uint8_t>& body, std::size_t max_size) {
+            if (!(header & compressed)) {
+                return true;
+            }
+            if (body.size() < 4) {
+                return false;
+            }
+            const std::uint32_t raw = getBe32(reinterpret_cast<const char*>(body.data()));
+            if (raw > max_size) {
+                return false;
+            }
+            std::vector<std::uint8_t> out(raw);
+            if (lz::decompress(body.data() + 4, body.size() - 4, out.data(), raw) != static_cast<std::ptrdiff_t>(raw)) {
+                return false;
+            }
+            body.swap(out);
+            return true;
+        }
+    }
+
+    // Incremental decoder for a byte stream of frames, for servers that receive in
+    // arbitrary chunks. Feed every chunk; each complete frame is handed to the callback.
+    class FrameDecoder {
+    public:
+        using Handler = std::function<void(const char* data, std::size_t len)>;
+
+        explicit FrameDecoder(std::size_t max_frame = 64 * 1024 * 1024) : max_frame_(max_frame) {}
+
+        // Returns false once the stream is corrupt (oversized, undecodable or failing its
+        // checksum); the connection should then be dropped.
+        bool feed(const char* data, std::size_t len, const Handler& on_frame) {
+            if (failed_) {
+                return false;
+            }
+            // Fast path: complete frames straight out of the caller's buffer.
+            if (buffer_.empty()) {
+                while (len >= frame::header_size) {
+                    const std::uint32_t header = frame::getBe32(data);
+                    const std::size_t body = header & frame::length_mask;
+                    if (body > max_frame_) return fail();
+                    if (len - frame::header_size < body) break;
+                    if (!deliver(header, data + frame::header_size, body, on_frame)) return fail();
+                    data += frame::header_size + body;
+                    len -= frame::header_size + body;
+                }
+            }
+            buffer_.insert(buffer_.end(), data, data + len);
+            std::size_t pos = 0;
+            while (buffer_.size() - pos >= frame::header_size) {
+                const std::uint32_t header = frame::getBe32(reinterpret_cast<const char*>(buffer_.data() + pos));
+                const std::size_t body = header & frame::length_mask;
+                if (body > max_frame_) return fail();
+                if (buffer_.size() - pos - frame::header_size < body) break;
+                if (!deliver(header, reinterpret_cast<const char*>(buffer_.data() + pos + frame::header_size), body, on_frame)) {
+                    return fail();
+                }
+                pos += frame::header_size + body;
+            }
+            buffer_.erase(buffer_.begin(), buffer_.begin() + static_cast<std::ptrdiff_t>(pos));
+            return true;
+        }
+
+        std::size_t buffered() const noexcept { return buffer_.size(); }
+        void reset() { buffer_.clear(); failed_ = false; }
+
+    private:
+        bool fail() {
+            failed_ = true;
+            buffer_.clear();
+            return false;
+        }
+
+        bool deliver(std::uint32_t header, const char* body, std::size_t len, const Handler& on_frame) {
+            if (header & frame::checksummed) {
+                if (len < frame::checksum_size) return false;
+                const std::uint32_t expected = frame::getBe32(body);
+                body += frame::checksum_size;
+                len -= frame::checksum_size;
+                if (crc32c(body, len) != expected) return false;
+            }
+            if (!(header & frame::compressed)) {
+                on_frame(body, len);
+                return true;
+            }
+            if (len < 4) return false;
+            const std::uint32_t raw = frame::getBe32(body);
+            if (raw > max_frame_) return false;
+            scratch_.resize(raw);
+            if (lz::decompress(body + 4, len - 4, scratch_.data(), raw) != static_cast<std::ptrdiff_t>(raw)) return false;
+            on_frame(reinterpret_cast<const char*>(scratch_.data()), raw);
+            return true;
+        }
+
+        std::size_t max_frame_;
+        std::vector<std::uint8_t> buffer_;
+        std::vector<std::uint8_t> scratch_;
+        bool failed_ = false;
+    };
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "selector.h"
+#include "tcp.h"
+
+namespace cpplib {
+    // Sliding window of recent latencies with cached quantiles.
+    class LatencyTracker {
+    public:
+        explicit LatencyTracker(std::size_t window = 1024) : samples_(std::max<std::size_t>(window, 16)) {}
+
+        void record(std::chrono::microseconds latency) {
+            samples_[next_ % samples_.size()] = latency.count();
+            ++next_;
+            dirty_ = true;
+        }
+
+        std::size_t count() const noexcept { return std::min(next_, samples_.size()); }
+
+        std::chrono::microseconds quantile(double q) {
+            const std::size_t n = count();
+            if (n == 0) {
+                return std::chrono::microseconds::zero();
+            }
+            if (dirty_ || q != cached_q_) {
+                scratch_.assign(samples_.begin(), samples_.begin() + static_cast<std::ptrdiff_t>(n));
+                const auto k = static_cast<std::size_t>(q * static_cast<double>(n - 1));
+                std::nth_element(scratch_.begin(), scratch_.begin() + static_cast<std::ptrdiff_t>(k), scratch_.end());
+                cached_ = scratch_[k];
+                cached_q_ = q;
+                dirty_ = false;
+            }
+            return std::chrono::microseconds(cached_);
+        }
+
+    private:
+        std::vector<std::int64_t> samples_;
+        std::vector<std::int64_t> scratch_;
+        std::size_t next_ = 0;
+        std::int64_t cached_ = 0;
+        double cached_q_ = -1.0;
+        bool dirty_ = false;
+    };
+
+    // Framed request/response client over several equivalent endpoints. A request goes to
+    // one endpoint; if no reply arrives within the tracked latency quantile (p95 by default)
+    // a duplicate goes to the next endpoint and the first reply wins. The losing connection
+    // is closed so its late reply cannot be mistaken for the next response, and reconnects
+    // on demand. Hedges are paid for from a budget that refills by `budget` per request,
+    // capping extra load at that fraction of traffic. Not thread-safe.
+    class HedgedClient {
+    public:
+        struct Endpoint {
+            std::string host;
+            int port;
+        };
+
+        struct Options {
+            double quantile = 0.95;
+            double budget = 0.05;
+            std::size_t min_samples = 20;                      // before this, use initial_delay
+            std::chrono::milliseconds initial_delay{10};
+            std::chrono::milliseconds min_delay{1};
+            int connect_timeout_ms = 3000;
+        };
+
+        struct Stats {
+            std::uint64_t requests = 0;
+            std::uint64_t hedges = 0;
+            std::uint64_t hedge_wins = 0;
+            std::uint64_t budget_denied = 0;
+            std::uint64_t failures = 0;
+        };
+
+        explicit HedgedClient(std::vector<Endpoint> endpoints)
+            : HedgedClient(std::move(endpoints), Options{}) {}
+
+        HedgedClient(std::vector<Endpoint> endpoints, Options options)
+            : endpoints_(std::move(endpoints)), options_(options), clients_(endpoints_.size()) {}
+
+        bool request(const void* data, std::uint32_t len, std::vector<std::uint8_t>& reply, int timeout_ms) {
+            ++stats_.requests;
+            // Unused budget accrues for bursts, up to what a hundred requests would earn.
+            tokens_ = std::min(tokens_ + options_.budget, std::max(1.0, options_.budget * 100.0));
+            if (endpoints_.empty()) {
+                ++stats_.failures;
+                return false;
+            }
+
+            const auto start = clock::now();
+            const auto deadline = start + std::chrono::milliseconds(timeout_ms);
+            const std::size_t primary = next_++ % endpoints_.size();
+            std::vector<std::size_t> inflight;
+            if (send(primary, data, len)) {
+                inflight.push_back(primary);
+            }
+
+            std::size_t candidate = primary;
+            auto hedge_at = start + hedgeDelay();
+            if (inflight.empty()) {
+                hedge_at = start;  // primary unreachable: fail over immediately, still budgeted
+            }
+            bool hedged = false;
+            for (;;) {
+                const auto now = clock::now();
+                if (now >= deadline) break;
+                if (!hedged && now >= hedge_at && endpoints_.size() > 1) {
+                    hedged = true;
+                    if (tokens_ >= 1.0) {
+                        candidate = (candidate + 1) % endpoints_.size();
+                        if (send(candidate, data, len)) {
+                            tokens_ -= 1.0;
+                            ++stats_.hedges;
+                            inflight.push_back(candidate);
+                        }
+                    } else {
+                        ++stats_.budget_denied;
+                    }
+                }
+                if (inflight.empty()) break;
+
+                const auto until = (!hedged && endpoints_.size() > 1) ? std::min(hedge_at, deadline) : deadline;
+                const auto wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(until - now).count();
+                auto winner = waitAny(inflight, static_cast<int>(std::max<std::int64_t>(wait_ms, 1)), reply);
+                if (winner) {
+                    if (*winner != primary) ++stats_.hedge_wins;
+                    for (auto i : inflight) if (i != *winner) drop(i);  // cancel the loser
+                    tracker_.record(std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start));
+                    return true;
+                }
+            }
+            for (auto i : inflight) drop(i);
+            ++stats_.failures;
+            return false;
+        }
+
+        bool request(const std::string& data, std::string& reply, int timeout_ms) {
+            std::vector<std::uint8_t> buf;
+            if (!request(data.data(), static_cast<std::uint32_t>(data.size()), buf, timeout_ms)) return false;
+            reply.assign(reinterpret_cast<const char*>(buf.data()), buf.size());
+            return true;
+        }
+
+        std::chrono::milliseconds hedgeDelay() {
+            if (tracker_.count() < options_.min_samples) {
+                return options_.initial_delay;
+            }
+            // Selector waits have millisecond resolution, so round the quantile up.
+            const auto q = tracker_.quantile(options_.quantile);
+            const auto ms = std::chrono::milliseconds((q.count() + 999) / 1000);
+            return std::max(ms, options_.min_delay);
+        }
+
+        const Stats& stats() const noexcept { return stats_; }
+        LatencyTracker& latency() noexcept { return tracker_; }
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        bool send(std::size_t i, const void* data, std::uint32_t len) {
+            auto& c = clients_[i];
+            if (!c || !c->connected()) {
+                drop(i);  // the Selector must not keep the old socket's entry
+                c = std::make_unique<TcpClient>();
+                if (!c->connect(endpoints_[i].host, endpoints_[i].port, options_.connect_timeout_ms)) {
+                    c.reset();
+                    return false;
+                }
+            }
+            if (!c->sendFrame(data, len)) {
+                drop(i);
+                return false;
+            }
+            selector_.add(c->socket(), i);  // no-op if already registered
+            return true;
+        }
+
+        void drop(std::size_t i) {
+            if (clients_[i]) {
+                selector_.remove(clients_[i]->socket());
+                clients_[i].reset();
+            }
+        }
+
+        std::optional<std::size_t> waitAny(std::vector<std::size_t>& inflight, int timeout_ms, std::vector<std::uint8_t>& reply) {
+            if (selector_.wait(events_, timeout_ms) <= 0) {
+                return std::nullopt;
+            }
+            for (const auto& ev : events_) {
+                const auto i = static_cast<std::size_t>(ev.key);
+                const bool expected = std::find(inflight.begin(), inflight.end(), i) != inflight.end();
+                if (expected && clients_[i] && clients_[i]->recvFrame(reply, 0)) {
+                    return i;
+                }
+                // Failed read, or an idle connection turned readable (peer closed it).
+                drop(i);
+                inflight.erase(std::remove(inflight.begin(), inflight.end(), i), inflight.end());
+            }
+            return std::nullopt;
+        }
+
+        std::vector<Endpoint> endpoints_;
+        Options options_;
+        std::vector<std::unique_ptr<TcpClient>> clients_;
+        Selector selector_;
+        std::vector<Selector::Event> events_;
+        LatencyTracker tracker_;
+        Stats stats_;
+        double tokens_ = 1.0;
+        std::size_t next_ = 0;
+    };
+}
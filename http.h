@@ -0,0 +1,640 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+#endif
+
+#include "tcp.h"
+
+namespace cpplib {
+    class HttpServer;
+
+    // HTTP/1.1 over TcpServer: an incremental request parser, a response writer and a
+    // server that ties them to connections with keep-alive and pipelining.
+    namespace http {
+        struct Header {
+            std::string_view name;
+            std::string_view value;
+        };
+
+        // Views into the receive buffer (or the parser's own buffer when a request arrived
+        // in pieces); valid only during the handler call.
+        struct Request {
+            static constexpr std::size_t max_headers = 64;
+
+            std::string_view method;
+            std::string_view target;
+            std::string_view path;
+            std::string_view query;
+            std::string_view body;
+            int minor_version = 1;
+            bool keep_alive = true;
+            std::size_t header_count = 0;
+            std::array<Header, max_headers> headers;
+
+            // Case-insensitive; the first match, or empty.
+            std::string_view header(std::string_view name) const noexcept;
+        };
+
+        enum class Error {
+            none,
+            bad_request,        // 400
+            header_too_large,   // 431
+            body_too_large,     // 413
+            not_implemented,    // 501: a transfer coding other than chunked
+        };
+
+        namespace detail {
+            inline char lower(char c) noexcept { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 32) : c; }
+
+            inline bool iequals(std::string_view a, std::string_view b) noexcept {
+                if (a.size() != b.size()) return false;
+                for (std::size_t i = 0; i < a.size(); ++i) {
+                    if (lower(a[i]) != lower(b[i])) return false;
+                }
+                return true;
+            }
+
+            // Whether a comma-separated header value lists `token`.
+            inline bool hasToken(std::string_view value, std::string_view token) noexcept {
+                while (!value.empty()) {
+                    const auto comma = value.find(',');
+                    auto item = value.substr(0, comma);
+                    while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) item.remove_prefix(1);
+                    while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) item.remove_suffix(1);
+                    if (iequals(item, token)) return true;
+                    if (comma == std::string_view::npos) break;
+                    value.remove_prefix(comma + 1);
+                }
+                return false;
+            }
+
+            // Offset of the "\r\n\r\n" ending a request head, searching from `from`; npos if
+            // absent. SSE2 checks 16 bytes per step for '\r', which is rare in a head.
+            inline std::size_t findHeadEnd(const char* p, std::size_t n, std::size_t from) noexcept {
+                std::size_t i = from;
+#if defined(__SSE2__) || defined(_M_X64)
+                const __m128i cr = _mm_set1_epi8('\r');
+                for (; i + 16 <= n; i += 16) {
+                    auto mask = static_cast<unsigned>(_mm_movemask_epi8(
+                        _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), cr)));
+                    while (mask) {
+#if defined(_MSC_VER)
+                        unsigned long bit;
+                        _BitScanForward(&bit, mask);
+                        const std::size_t j = i + bit;
+#else
+                        const std::size_t j = i + static_cast<std::size_t>(__builtin_ctz(mask));
+#endif
+                        if (j + 4 <= n && std::memcmp(p + j, "\r\n\r\n", 4) == 0) return j;
+                        mask &= mask - 1;
+                    }
+                }
+#endif
+                while (i + 4 <= n) {
+                    const void* cr_at = std::memchr(p + i, '\r', n - 3 - i);
+                    if (!cr_at) break;
+                    const std::size_t j = static_cast<std::size_t>(static_cast<const char*>(cr_at) - p);
+                    if (std::memcmp(p + j, "\r\n\r\n", 4) == 0) return j;
+                    i = j + 1;
+                }
+                return std::string_view::npos;
+            }
+
+            inline bool parseSize(std::string_view s, int base, std::uint64_t& out) noexcept {
+                if (s.empty()) return false;
+                const auto r = std::from_chars(s.data(), s.data() + s.size(), out, base);
+                return r.ec == std::errc() && r.ptr == s.data() + s.size();
+            }
+
+            // IMF-fixdate for the Date header, formatted at most once a second per thread.
+            inline std::string_view date() {
+                thread_local std::time_t cached_at = 0;
+                thread_local char buf[32];
+                thread_local std::size_t len = 0;
+                const std::time_t now = std::time(nullptr);
+                if (now != cached_at) {
+                    std::tm tm{};
+#if defined(_WIN32)
+                    gmtime_s(&tm, &now);
+#else
+                    gmtime_r(&now, &tm);
+#endif
+                    len = std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+                    cached_at = now;
+                }
+                return std::string_view(buf, len);
+            }
+
+            inline std::string_view reason(int code) noexcept {
+                switch (code) {
+                    case 100: return "Continue";
+                    case 200: return "OK";
+                    case 201: return "Created";
+                    case 202: return "Accepted";
+                    case 204: return "No Content";
+                    case 206: return "Partial Content";
+                    case 301: return "Moved Permanently";
+                    case 302: return "Found";
+                    case 304: return "Not Modified";
+                    case 307: return "Temporary Redirect";
+                    case 308: return "Permanent Redirect";
+                    case 400: return "Bad Request";
+                    case 401: return "Unauthorized";
+                    case 403: return "Forbidden";
+                    case 404: return "Not Found";
+                    case 405: return "Method Not Allowed";
+                    case 408: return "Request Timeout";
+                    case 409: return "Conflict";
+                    case 413: return "Content Too Large";
+                    case 429: return "Too Many Requests";
+                    case 431: return "Request Header Fields Too Large";
+                    case 500: return "Internal Server Error";
+                    case 501: return "Not Implemented";
+                    case 502: return "Bad Gateway";
+                    case 503: return "Service Unavailable";
+                    case 504: return "Gateway Timeout";
+                    default:  return "Unknown";
+                }
+            }
+
+            inline void appendNumber(std::string& out, std::uint64_t v, int base = 10) {
+                char buf[24];
+                const auto r = std::to_chars(buf, buf + sizeof(buf), v, base);
+                out.append(buf, static_cast<std::size_t>(r.ptr - buf));
+            }
+        }
+
+        inline std::string_view Request::header(std::string_view name) const noexcept {
+            for (std::size_t i = 0; i < header_count; ++i) {
+                if (detail::iequals(headers[i].name, name)) return headers[i].value;
+            }
+            return {};
+        }
+
+        // Incremental request parser for a connection's byte stream, in the manner of
+        // FrameDecoder: whole requests are parsed straight out of the caller's buffer, and
+        // only a trailing partial request is copied aside until the rest arrives. Bodies
+        // come from Content-Length or chunked transfer coding (decoded into a side buffer).
+        class RequestParser {
+        public:
+            explicit RequestParser(std::size_t max_head = 64 * 1024, std::size_t max_body = 8 * 1024 * 1024)
+                : max_head_(max_head), max_body_(max_body) {}
+
+            // Calls on_request(const Request&) for each complete request. Returns false once
+            // the stream is malformed; error() says why and the connection should be closed.
+            template <typename Fn>
+            bool feed(const char* data, std::size_t len, Fn&& on_request) {
+                if (error_ != Error::none) {
+                    return false;
+                }
+                if (buffer_.empty()) {
+                    while (len > 0) {
+                        const auto r = parse(data, len);
+                        if (r < 0) return false;
+                        if (r == 0) break;
+                        on_request(static_cast<const Request&>(req_));
+                        data += r;
+                        len -= static_cast<std::size_t>(r);
+                    }
+                    if (len == 0) return true;
+                }
+                buffer_.append(data, len);
+                std::size_t pos = 0;
+                while (pos < buffer_.size()) {
+                    const auto r = parse(buffer_.data() + pos, buffer_.size() - pos);
+                    if (r < 0) {
+                        buffer_.clear();
+                        return false;
+                    }
+                    if (r == 0) break;
+                    on_request(static_cast<const Request&>(req_));
+                    pos += static_cast<std::size_t>(r);
+                }
+                buffer_.erase(0, pos);
+                return true;
+            }
+
+            Error error() const noexcept { return error_; }
+            std::size_t buffered() const noexcept { return buffer_.size(); }
+
+            void reset() {
+                buffer_.clear();
+                error_ = Error::none;
+                resetMessage();
+            }
+
+        private:
+            // Parses one request at the start of [p, p + n). Returns its length, 0 if it is
+            // not complete yet (progress is kept, relative to p), or -1 on error.
+            std::ptrdiff_t parse(const char* p, std::size_t n) {
+                bool fresh = false;
+                if (head_ == 0) {
+                    const std::size_t end = detail::findHeadEnd(p, n, scanned_);
+                    if (end == std::string_view::npos) {
+                        if (n > max_head_) return fail(Error::header_too_large);
+                        scanned_ = n > 3 ? n - 3 : 0;
+                        return 0;
+                    }
+                    head_ = end + 4;
+                    if (head_ > max_head_) return fail(Error::header_too_large);
+                    if (!parseHead(p)) return -1;
+                    fresh = true;
+                    chunk_at_ = head_;
+                    body_.clear();
+                }
+                std::size_t total;
+                if (chunked_) {
+                    if (!decodeChunks(p, n)) return error_ == Error::none ? 0 : -1;
+                    total = chunk_at_;
+                } else {
+                    total = head_ + content_length_;
+                    if (n < total) return 0;
+                }
+                // The views of a head parsed on an earlier call may point into a buffer that
+                // has since grown.
+                if (!fresh && !parseHead(p)) return -1;
+                req_.body = chunked_ ? std::string_view(body_) : std::string_view(p + head_, content_length_);
+                resetMessage();
+                return static_cast<std::ptrdiff_t>(total);
+            }
+
+            bool parseHead(const char* p) {
+                const std::string_view head(p, head_ - 2);  // keep the final CRLF of the last line
+                std::size_t at = 0;
+                auto line = nextLine(head, at);
+                const auto sp1 = line.find(' ');
+                const auto sp2 = sp1 == std::string_view::npos ? sp1 : line.find(' ', sp1 + 1);
+                if (sp1 == 0 || sp2 == std::string_view::npos || sp2 == sp1 + 1) return reject(Error::bad_request);
+                req_.method = line.substr(0, sp1);
+                req_.target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+                const auto version = line.substr(sp2 + 1);
+                if (version.size() != 8 || version.substr(0, 7) != "HTTP/1." || (version[7] != '0' && version[7] != '1')) {
+                    return reject(Error::bad_request);
+                }
+                req_.minor_version = version[7] - '0';
+                const auto q = req_.target.find('?');
+                req_.path = req_.target.substr(0, q);
+                req_.query = q == std::string_view::npos ? std::string_view() : req_.target.substr(q + 1);
+
+                req_.header_count = 0;
+                bool has_length = false, close = false, keep_alive = false;
+                content_length_ = 0;
+                chunked_ = false;
+                while (at < head.size()) {
+                    line = nextLine(head, at);
+                    const auto colon = line.find(':');
+                    if (colon == 0 || colon == std::string_view::npos) return reject(Error::bad_request);
+                    const auto name = line.substr(0, colon);
+                    if (name.back() == ' ' || name.back() == '\t') return reject(Error::bad_request);
+                    auto value = line.substr(colon + 1);
+                    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+                    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+                    if (req_.header_count == Request::max_headers) return reject(Error::header_too_large);
+                    req_.headers[req_.header_count++] = Header{name, value};
+
+                    if (detail::iequals(name, "content-length")) {
+                        std::uint64_t v;
+                        if (!detail::parseSize(value, 10, v) || (has_length && v != content_length_)) {
+                            return reject(Error::bad_request);
+                        }
+                        has_length = true;
+                        content_length_ = static_cast<std::size_t>(v);
+                    } else if (detail::iequals(name, "transfer-encoding")) {
+                        // chunked must be the final coding, and no other is supported.
+                        if (!detail::iequals(value, "chunked")) return reject(Error::not_implemented);
+                        chunked_ = true;
+                    } else if (detail::iequals(name, "connection")) {
+                        close = close || detail::hasToken(value, "close");
+                        keep_alive = keep_alive || detail::hasToken(value, "keep-alive");
+                    }
+                }
+                // Both framings at once is the classic request-smuggling vector.
+                if (has_length && chunked_) return reject(Error::bad_request);
+                if (content_length_ > max_body_) return reject(Error::body_too_large);
+                req_.keep_alive = req_.minor_version == 1 ? !close : (keep_alive && !close);
+                return true;
+            }
+
+            // Decodes chunks from chunk_at_ onward into body_. Returns true once the last
+            // chunk and trailers are in, leaving chunk_at_ just past the message.
+            bool decodeChunks(const char* p, std::size_t n) {
+                for (;;) {
+                    const std::string_view rest(p + chunk_at_, n - chunk_at_);
+                    const auto eol = rest.find("\r\n");
+                    if (eol == std::string_view::npos) {
+                        if (rest.size() > 1024) return reject(Error::bad_request);  // runaway size line
+                        return false;
+                    }
+                    if (in_trailers_) {
+                        chunk_at_ += eol + 2;
+                        if (eol == 0) return true;  // empty line ends the trailers
+                        continue;
+                    }
+                    auto size_text = rest.substr(0, eol);
+                    size_text = size_text.substr(0, size_text.find(';'));  // drop extensions
+                    std::uint64_t size;
+                    if (!detail::parseSize(size_text, 16, size)) return reject(Error::bad_request);
+                    if (size == 0) {
+                        in_trailers_ = true;
+                        chunk_at_ += eol + 2;
+                        continue;
+                    }
+                    if (size > max_body_ - body_.size()) return reject(Error::body_too_large);
+                    if (rest.size() < eol + 2 + size + 2) return false;
+                    if (rest.substr(eol + 2 + size, 2) != "\r\n") return reject(Error::bad_request);
+                    body_.append(rest.data() + eol + 2, size);
+                    chunk_at_ += eol + 2 + size + 2;
+                }
+            }
+
+            static std::string_view nextLine(std::string_view head, std::size_t& at) noexcept {
+                const auto eol = head.find("\r\n", at);
+                const auto line = head.substr(at, eol - at);
+                at = eol == std::string_view::npos ? head.size() : eol + 2;
+                return line;
+            }
+
+            std::ptrdiff_t fail(Error e) {
+                error_ = e;
+                resetMessage();
+                return -1;
+            }
+
+            bool reject(Error e) {
+                fail(e);
+                return false;
+            }
+
+            void resetMessage() {
+                head_ = 0;
+                scanned_ = 0;
+                chunk_at_ = 0;
+                in_trailers_ = false;
+            }
+
+            std::size_t max_head_;
+            std::size_t max_body_;
+            std::string buffer_;
+            std::string body_;              // decoded chunked body of the current request
+            Request req_;
+            Error error_ = Error::none;
+            std::size_t head_ = 0;          // head length once parsed, else 0
+            std::size_t scanned_ = 0;       // bytes already searched for the end of the head
+            std::size_t content_length_ = 0;
+            std::size_t chunk_at_ = 0;      // next chunk-size line (chunked bodies)
+            bool chunked_ = false;
+            bool in_trailers_ = false;
+        };
+
+        // Builds one response straight into the connection's outbound buffer. Either
+        // send() a whole body (Content-Length) or write() it in pieces (chunked; close-
+        // delimited for HTTP/1.0 clients) and end(). Large chunked output is handed to the
+        // socket as it grows instead of piling up.
+        class Response {
+        public:
+            Response& status(int code) {
+                status_ = code;
+                return *this;
+            }
+
+            Response& header(std::string_view name, std::string_view value) {
+                headers_.append(name).append(": ").append(value).append("\r\n");
+                return *this;
+            }
+
+            void send(std::string_view body) {
+                if (state_ != State::open) return;
+                writeHead();
+                if (status_ < 200 || status_ == 204 || status_ == 304) {
+                    out_->append("\r\n");  // these never carry a body
+                } else {
+                    out_->append("Content-Length: ");
+                    detail::appendNumber(*out_, body.size());
+                    out_->append("\r\n\r\n");
+                    if (!head_only_) out_->append(body);
+                }
+                state_ = State::done;
+            }
+
+            void write(std::string_view chunk) {
+                if (state_ == State::done) return;
+                if (state_ == State::open) {
+                    if (minor_version_ == 0) keep_alive_ = false;  // no chunked coding in 1.0
+                    writeHead();
+                    out_->append(minor_version_ == 0 ? "\r\n" : "Transfer-Encoding: chunked\r\n\r\n");
+                    state_ = State::streaming;
+                }
+                if (chunk.empty() || head_only_) return;
+                if (minor_version_ == 0) {
+                    out_->append(chunk);
+                } else {
+                    detail::appendNumber(*out_, chunk.size(), 16);
+                    out_->append("\r\n").append(chunk).append("\r\n");
+                }
+                if (out_->size() >= flush_threshold && flush_) (*flush_)();
+            }
+
+            // Completes the response; the server calls this after the handler returns.
+            void end() {
+                if (state_ == State::open) {
+                    send({});
+                } else if (state_ == State::streaming) {
+                    if (minor_version_ == 1 && !head_only_) out_->append("0\r\n\r\n");
+                    state_ = State::done;
+                }
+            }
+
+            bool keepAlive() const noexcept { return keep_alive_; }
+
+            // Stops this response from keeping the connection open.
+            Response& close() {
+                keep_alive_ = false;
+                return *this;
+            }
+
+        private:
+            friend class cpplib::HttpServer;
+            enum class State { open, streaming, done };
+            static constexpr std::size_t flush_threshold = 64 * 1024;
+
+            void begin(std::string* out, const Request& req, std::function<void()>* flush) {
+                out_ = out;
+                flush_ = flush && *flush ? flush : nullptr;
+                status_ = 200;
+                headers_.clear();
+                state_ = State::open;
+                keep_alive_ = req.keep_alive;
+                minor_version_ = req.minor_version;
+                head_only_ = req.method == "HEAD";
+            }
+
+            void writeHead() {
+                out_->append(minor_version_ == 0 ? "HTTP/1.0 " : "HTTP/1.1 ");
+                detail::appendNumber(*out_, static_cast<std::uint64_t>(status_));
+                out_->append(" ").append(detail::reason(status_)).append("\r\nDate: ").append(detail::date()).append("\r\n");
+                if (!keep_alive_) {
+                    out_->append("Connection: close\r\n");
+                } else if (minor_version_ == 0) {
+                    out_->append("Connection: keep-alive\r\n");
+                }
+                out_->append(headers_);
+            }
+
+            std::string* out_ = nullptr;
+            std::function<void()>* flush_ = nullptr;
+            std::string headers_;
+            int status_ = 200;
+            State state_ = State::done;
+            bool keep_alive_ = true;
+            int minor_version_ = 1;
+            bool head_only_ = false;
+        };
+    }
+
+    // HTTP/1.1 server on a TcpServer (pool or per-core mode). Every request parsed out of
+    // a received chunk is answered into one outbound buffer that goes out with a single
+    // sendTo() once the chunk is done, so pipelined requests cost one write. Connections
+    // stay open unless the request or response says otherwise; malformed requests get a
+    // 4xx/501 and the connection is closed. The handler runs on the connection's thread
+    // (or core) and must complete the response before returning.
+    class HttpServer {
+    public:
+        using Handler = std::function<void(const http::Request&, http::Response&)>;
+
+        struct Options {
+            std::size_t max_head = 64 * 1024;
+            std::size_t max_body = 8 * 1024 * 1024;
+        };
+
+        HttpServer() : HttpServer(Options{}) {}
+        explicit HttpServer(Options options) : options_(options) {}
+        ~HttpServer() { stop(); }
+
+        bool bind(int port) { return tcp_.bind(port); }
+        bool listen(int backlog = 128) { return tcp_.listen(backlog); }
+        std::uint16_t port() const { return tcp_.port(); }
+
+        void start(std::size_t workers, Handler handler) {
+            handler_ = std::move(handler);
+            tcp_.start(workers, TcpServer::OnConnect{}, onMessage(), onDisconnect());
+        }
+
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+        bool startPerCore(std::size_t cores, Handler handler) {
+            handler_ = std::move(handler);
+            return tcp_.startPerCore(cores, TcpServer::OnConnect{}, onMessage(), onDisconnect());
+        }
+#endif
+
+        void stop() { tcp_.stop(); }
+        bool isRunning() const noexcept { return tcp_.isRunning(); }
+
+        // For transport options (Fast Open, receive buffer size, admission control, ...).
+        TcpServer& tcp() noexcept { return tcp_; }
+
+    private:
+        struct Conn {
+            explicit Conn(const Options& o) : parser(o.max_head, o.max_body) {}
+            http::RequestParser parser;
+            http::Response response;
+            std::string out;
+            std::function<void()> flush;
+            bool closing = false;
+        };
+
+        // Connections are only touched by the thread serving them; the map itself is
+        // striped so lookups from different connections rarely meet on a lock.
+        struct alignas(64) Stripe {
+            std::mutex mutex;
+            std::unordered_map<TcpServer::ClientId, std::unique_ptr<Conn>> conns;
+        };
+
+        static constexpr std::size_t stripes = 64;
+
+        Stripe& stripeOf(TcpServer::ClientId id) noexcept {
+            return stripes_[(id ^ (id >> 56)) % stripes];
+        }
+
+        Conn& conn(TcpServer::ClientId id) {
+            Stripe& st = stripeOf(id);
+            std::lock_guard<std::mutex> lk(st.mutex);
+            auto& c = st.conns[id];
+            if (!c) {
+                c = std::make_unique<Conn>(options_);
+                Conn* raw = c.get();
+                raw->flush = [this, id, raw] {
+                    tcp_.sendTo(id, raw->out.data(), raw->out.size());
+                    raw->out.clear();
+                };
+            }
+            return *c;
+        }
+
+        TcpServer::MessageHandler onMessage() {
+            return [this](TcpServer::ClientId id, std::shared_ptr<Socket>, const char* data, std::size_t len) {
+                Conn& c = conn(id);
+                if (c.closing) return;
+                const bool ok = c.parser.feed(data, len, [&](const http::Request& req) {
+                    if (c.closing) return;  // pipelined behind a request that closes
+                    c.response.begin(&c.out, req, &c.flush);
+                    handler_(req, c.response);
+                    c.response.end();
+                    if (!c.response.keepAlive()) c.closing = true;
+                });
+                if (!ok && !c.closing) {
+                    writeError(c, c.parser.error());
+                    c.closing = true;
+                }
+                if (!c.out.empty()) {
+                    tcp_.sendTo(id, c.out.data(), c.out.size());
+                    c.out.clear();
+                }
+                if (c.closing) tcp_.closeClient(id);  // may drop c through onDisconnect
+            };
+        }
+
+        TcpServer::OnDisconnect onDisconnect() {
+            return [this](TcpServer::ClientId id) {
+                Stripe& st = stripeOf(id);
+                std::unique_ptr<Conn> gone;
+                std::lock_guard<std::mutex> lk(st.mutex);
+                auto it = st.conns.find(id);
+                if (it != st.conns.end()) {
+                    gone = std::move(it->second);
+                    st.conns.erase(it);
+                }
+            };
+        }
+
+        static void writeError(Conn& c, http::Error error) {
+            int code = 400;
+            if (error == http::Error::header_too_large) code = 431;
+            if (error == http::Error::body_too_large) code = 413;
+            if (error == http::Error::not_implemented) code = 501;
+            http::Request req;
+            req.keep_alive = false;
+            c.response.begin(&c.out, req, nullptr);
+            c.response.status(code).send(http::detail::reason(code));
+        }
+
+        Options options_;
+        Handler handler_;
+        std::array<Stripe, stripes> stripes_;
+        TcpServer tcp_;
+    };
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+#if defined(__linux__)
+    #include <sys/syscall.h>
+#endif
+
+namespace cpplib {
+    // Large, page-aligned buffer for socket and log rings. Sizes at or above huge_threshold
+    // are backed by explicit huge pages (MAP_HUGETLB) when the system has them reserved,
+    // otherwise by normal pages with a transparent huge page hint. Smaller sizes, and
+    // platforms without mmap, fall back to the regular heap.
+    class HugePageBuffer {
+    public:
+        static constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+        static constexpr std::size_t huge_threshold = huge_page_size;
+
+        enum class Backing : std::uint8_t {
+            NONE,
+            HEAP,
+            PAGES,      // mmap, normal pages (possibly THP-promoted after madvise)
+            HUGE_PAGES  // mmap with MAP_HUGETLB
+        };
+
+        HugePageBuffer() = default;
+        explicit HugePageBuffer(std::size_t size, bool numa_local = true) { allocate(size, numa_local); }
+        ~HugePageBuffer() { reset(); }
+
+        HugePageBuffer(HugePageBuffer&& other) noexcept
+            : data_(std::exchange(other.data_, nullptr)),
+              size_(std::exchange(other.size_, 0)),
+              mapped_(std::exchange(other.mapped_, 0)),
+              backing_(std::exchange(other.backing_, Backing::NONE)) {}
+
+        HugePageBuffer& operator=(HugePageBuffer&& other) noexcept {
+            if (this != &other) {
+                reset();
+                data_ = std::exchange(other.data_, nullptr);
+                size_ = std::exchange(other.size_, 0);
+                mapped_ = std::exchange(other.mapped_, 0);
+                backing_ = std::exchange(other.backing_, Backing::NONE);
+            }
+            return *this;
+        }
+
+        HugePageBuffer(const HugePageBuffer&) = delete;
+        HugePageBuffer& operator=(const HugePageBuffer&) = delete;
+
+        void allocate(std::size_t size, bool numa_local = true) {
+            reset();
+            if (size == 0) {
+                return;
+            }
+#if !defined(_WIN32) && !defined(_WIN64)
+            if (size >= huge_threshold) {
+                const std::size_t rounded = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+                void* p = MAP_FAILED;
+    #if defined(MAP_HUGETLB)
+                p = ::mmap(nullptr, rounded, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (p != MAP_FAILED) {
+                    backing_ = Backing::HUGE_PAGES;
+                }
+    #endif
+                if (p == MAP_FAILED) {
+                    p = ::mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                    if (p == MAP_FAILED) {
+                        throw std::bad_alloc();
+                    }
+                    backing_ = Backing::PAGES;
+    #if defined(MADV_HUGEPAGE)
+                    ::madvise(p, rounded, MADV_HUGEPAGE);
+    #endif
+                }
+                data_ = p;
+                size_ = size;
+                mapped_ = rounded;
+                if (numa_local) {
+                    bindToLocalNode();
+                }
+                return;
+            }
+#else
+            (void)numa_local;
+#endif
+            data_ = ::operator new(size, std::align_val_t{64});
+            size_ = size;
+            backing_ = Backing::HEAP;
+        }
+
+        void reset() noexcept {
+            if (!data_) {
+                return;
+            }
+#if !defined(_WIN32) && !defined(_WIN64)
+            if (mapped_) {
+                ::munmap(data_, mapped_);
+            } else {
+                ::operator delete(data_, std::align_val_t{64});
+            }
+#else
+            ::operator delete(data_, std::align_val_t{64});
+#endif
+            data_ = nullptr;
+            size_ = 0;
+            mapped_ = 0;
+            backing_ = Backing::NONE;
+        }
+
+        void* data() noexcept { return data_; }
+        const void* data() const noexcept { return data_; }
+        char* bytes() noexcept { return static_cast<char*>(data_); }
+        std::size_t size() const noexcept { return size_; }
+        bool empty() const noexcept { return size_ == 0; }
+        Backing backing() const noexcept { return backing_; }
+        bool hugePages() const noexcept { return backing_ == Backing::HUGE_PAGES; }
+
+    private:
+        // Prefer the NUMA node of the allocating thread. Issued as a raw syscall so there is
+        // no link dependency on libnuma; failure (no NUMA, seccomp, old kernel) is harmless.
+        void bindToLocalNode() noexcept {
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+            unsigned cpu = 0, node = 0;
+            if (::syscall(SYS_getcpu, &cpu, &node, nullptr) != 0 || node >= 63) {
+                return;
+            }
+            constexpr int mpol_preferred = 1;
+            unsigned long mask = 1UL << node;
+            ::syscall(SYS_mbind, data_, mapped_, mpol_preferred, &mask, 64UL, 0U);
+#endif
+        }
+
+        void* data_ = nullptr;
+        std::size_t size_ = 0;
+        std::size_t mapped_ = 0;
+        Backing backing_ = Backing::NONE;
+    };
+}
@@ -3,14 +3,21 @@
 #include <chrono>
 #include <cstdint>
 #include <ctime>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
 #include <type_traits>
 
+#include "hugepage.h"
+#include "lz.h"
+
 namespace cpplib {
     namespace detail {
         template <typename Enum>
@@ -51,9 +58,9 @@ namespace cpplib {
     public:
         Logger(LogLevel level = LogLevel::INFO, OutputTarget targets = OutputTarget::TERMINAL,
         const std::string& file = "")
-            : log_level(level), log_targets(targets) {
+            : log_level(level), log_targets(targets), file_path(file) {
             if (!file.empty()) {
-                log_file = std::make_unique<std::ofstream>(file, std::ios::app);
+                openFile();
             }
         }
 
@@ -61,6 +68,9 @@ namespace cpplib {
             if (log_file) {
                 log_file->close();
             }
+            if (compress_thread.joinable()) {
+                compress_thread.join();
+            }
         }
 
         void log(LogLevel level, const std::string& message) {
@@ -75,7 +85,18 @@ namespace cpplib {
                 std::cout << log_message << std::endl;
             }
             if (log_file && hasTarget(log_targets, OutputTarget::FILE)) {
-                *log_file << log_message << std::endl;
+                if (file_buffer.empty()) {
+                    *log_file << log_message << std::endl;
+                } else {
+                    *log_file << log_message << '\n';
+                    if (!(level < LogLevel::ERROR)) {
+                        log_file->flush();
+                    }
+                }
+                file_bytes += log_message.size() + 1;
+                if (rotate_bytes && file_bytes >= rotate_bytes) {
+                    rotate();
+                }
             }
             if (hasTarget(log_targets, OutputTarget::GUI)) {
                 // Implement GUI logging later
@@ -91,12 +112,117 @@ namespace cpplib {
 
         void setLogLevel(LogLevel level) { log_level = level; }
 
+        // Switches file output from flush-per-line to a large write buffer (huge-page backed
+        // from HugePageBuffer::huge_threshold up). ERROR and above still flush immediately.
+        // Pass 0 to go back to unbuffered lines.
+        bool setFileBuffer(std::size_t bytes) {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            if (file_path.empty()) {
+                return false;
+            }
+            if (log_file) {
+                log_file->close();
+            }
+            file_buffer.allocate(bytes);
+            return openFile();
+        }
+
+        // Rolls the file over once it reaches max_bytes, keeping max_files older files as
+        // <file>.1 (newest) to <file>.N. With compress, rotated files are stored as
+        // <file>.N.lz in lz::StreamCompressor format instead; the compression runs on a
+        // background thread, and a file it fails to write stays as plain <file>.N.
+        void setRotation(std::size_t max_bytes, std::size_t max_files, bool compress = false) {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            rotate_bytes = max_bytes;
+            rotate_keep = max_files;
+            rotate_compress = compress;
+        }
+
+        void flush() {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            if (log_file) {
+                log_file->flush();
+            }
+        }
+
     private:
         LogLevel log_level;
         OutputTarget log_targets;
+        std::string file_path;
+        HugePageBuffer file_buffer;
         std::unique_ptr<std::ofstream> log_file;
+        std::size_t file_bytes = 0;
+        std::size_t rotate_bytes = 0;
+        std::size_t rotate_keep = 0;
+        bool rotate_compress = false;
+        std::thread compress_thread;
         std::mutex log_mutex;
 
+        bool openFile() {
+            log_file = std::make_unique<std::ofstream>();
+            if (!file_buffer.empty()) {
+                log_file->rdbuf()->pubsetbuf(file_buffer.bytes(), static_cast<std::streamsize>(file_buffer.size()));
+            }
+            log_file->open(file_path, std::ios::app);
+            std::error_code ec;
+            const auto size = std::filesystem::file_size(file_path, ec);
+            file_bytes = ec ? 0 : static_cast<std::size_t>(size);
+            return log_file->is_open();
+        }
+
+        std::string rotatedName(std::size_t index, bool lz) const {
+            return file_path + "." + std::to_string(index) + (lz ? ".lz" : "");
+        }
+
+        // Called with log_mutex held, so only renames happen here; compressing waits for
+        // the lock to be released.
+        void rotate() {
+            log_file->close();
+            std::error_code ec;
+            if (rotate_keep == 0) {
+                std::filesystem::remove(file_path, ec);
+                openFile();
+                return;
+            }
+            // The previous compression reads <file>.1 and must finish before it moves.
+            if (compress_thread.joinable()) {
+                compress_thread.join();
+            }
+            // Either form may exist at any index: plain where compression failed.
+            for (bool lz : {false, true}) std::filesystem::remove(rotatedName(rotate_keep, lz), ec);
+            for (std::size_t i = rotate_keep - 1; i >= 1; --i) {
+                for (bool lz : {false, true}) std::filesystem::rename(rotatedName(i, lz), rotatedName(i + 1, lz), ec);
+            }
+            std::filesystem::rename(file_path, rotatedName(1, false), ec);
+            if (!ec && rotate_compress) {
+                compress_thread = std::thread(compressFile, rotatedName(1, false), rotatedName(1, true));
+            }
+            openFile();
+        }
+
+        static void compressFile(const std::string& from, const std::string& to) {
+            std::error_code ec;
+            std::ifstream in(from, std::ios::binary);
+            std::ofstream out(to, std::ios::binary | std::ios::trunc);
+            lz::StreamCompressor compressor;
+            std::string chunk(64 * 1024, '\0');
+            std::string encoded;
+            while (out && (in.read(chunk.data(), static_cast<std::streamsize>(chunk.size())) || in.gcount() > 0)) {
+                compressor.write(chunk.data(), static_cast<std::size_t>(in.gcount()), encoded);
+                out.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+                encoded.clear();
+            }
+            compressor.flush(encoded);
+            out.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+            out.close();
+            in.close();
+            if (out) {
+                std::filesystem::remove(from, ec);
+            } else if (std::filesystem::is_regular_file(to, ec)) {
+                std::filesystem::remove(to, ec);  // keep the plain file rather than a torn .lz
+            }
+        }
+
         std::string getTimestamp(bool includeSubsecond = false) {
             auto now = std::chrono::system_clock::now();
             auto time_t_now = std::chrono::system_clock::to_time_t(now);
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace cpplib {
+    // Dependency-free LZ77 block codec using the LZ4 block format (greedy single-probe hash
+    // matcher, 64 KiB window), tuned for speed over ratio. Blocks are self-contained; the
+    // stream classes below chunk arbitrary data into blocks.
+    namespace lz {
+        namespace detail {
+            constexpr std::size_t min_match = 4;
+            constexpr std::size_t last_literals = 5;   // the format requires the tail to be literals
+            constexpr std::size_t mf_limit = 12;       // no match may start this close to the end
+            constexpr unsigned hash_log = 12;
+            constexpr std::size_t max_offset = 65535;
+
+            inline std::uint32_t read32(const unsigned char* p) noexcept {
+                std::uint32_t v;
+                std::memcpy(&v, p, sizeof(v));
+                return v;
+            }
+
+            inline std::uint64_t read64(const unsigned char* p) noexcept {
+                std::uint64_t v;
+                std::memcpy(&v, p, sizeof(v));
+                return v;
+            }
+
+            inline std::size_t firstDifferentByte(std::uint64_t diff) noexcept {
+#if defined(_MSC_VER)
+                unsigned long idx;
+                _BitScanForward64(&idx, diff);
+                return idx >> 3;
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                return static_cast<std::size_t>(__builtin_clzll(diff) >> 3);
+#else
+                return static_cast<std::size_t>(__builtin_ctzll(diff) >> 3);
+#endif
+            }
+
+            inline std::uint32_t hash(std::uint32_t v) noexcept {
+                return (v * 2654435761u) >> (32 - hash_log);
+            }
+
+            inline std::size_t commonLength(const unsigned char* a, const unsigned char* b, const unsigned char* limit) noexcept {
+                const unsigned char* start = a;
+                while (a + 8 <= limit) {
+                    const std::uint64_t diff = read64(a) ^ read64(b);
+                    if (diff) {
+                        return static_cast<std::size_t>(a - start) + firstDifferentByte(diff);
+                    }
+                    a += 8;
+                    b += 8;
+                }
+                while (a < limit && *a == *b) {
+                    ++a;
+                    ++b;
+                }
+                return static_cast<std::size_t>(a - start);
+            }
+
+            inline unsigned char* writeLength(unsigned char* op, std::size_t len) noexcept {
+                while (len >= 255) {
+                    *op++ = 255;
+                    len -= 255;
+                }
+                *op++ = static_cast<unsigned char>(len);
+                return op;
+            }
+        }
+
+        inline std::size_t compressBound(std::size_t n) noexcept {
+            return n + n / 255 + 16;
+        }
+
+        // Returns the compressed size, or 0 if dst is too small.
+        inline std::size_t compress(const void* src, std::size_t n, void* dst, std::size_t capacity) {
+            using namespace detail;
+            const auto* const base = static_cast<const unsigned char*>(src);
+            auto* op = static_cast<unsigned char*>(dst);
+            auto* const oend = op + capacity;
+            const unsigned char* anchor = base;
+
+            auto emit = [&](const unsigned char* lit_end, std::size_t offset, std::size_t match_len) -> bool {
+                const std::size_t lit = static_cast<std::size_t>(lit_end - anchor);
+                const std::size_t worst = 1 + lit / 255 + 1 + lit + 2 + match_len / 255 + 1;
+                if (static_cast<std::size_t>(oend - op) < worst) {
+                    return false;
+                }
+                unsigned char* token = op++;
+                *token = static_cast<unsigned char>((lit >= 15 ? 15 : lit) << 4);
+                if (lit >= 15) op = writeLength(op, lit - 15);
+                std::memcpy(op, anchor, lit);
+                op += lit;
+                if (match_len == 0) {
+                    return true;  // final literal-only sequence
+                }
+                *op++ = static_cast<unsigned char>(offset & 0xff);
+                *op++ = static_cast<unsigned char>(offset >> 8);
+                const std::size_t ml = match_len - min_match;
+                *token |= static_cast<unsigned char>(ml >= 15 ? 15 : ml);
+                if (ml >= 15) op = writeLength(op, ml - 15);
+                return true;
+            };
+
+            if (n >= mf_limit + 1) {
+                std::uint32_t table[1u << hash_log] = {};
+                const unsigned char* ip = base;
+                const unsigned char* const mflimit = base + n - mf_limit;
+                const unsigned char* const matchlimit = base + n - last_literals;
+                table[hash(read32(ip))] = 0;
+                ++ip;
+                unsigned misses = 0;
+                while (ip < mflimit) {
+                    const std::uint32_t h = hash(read32(ip));
+                    const unsigned char* ref = base + table[h];
+                    table[h] = static_cast<std::uint32_t>(ip - base);
+                    if (ref >= ip || static_cast<std::size_t>(ip - ref) > max_offset || read32(ref) != read32(ip)) {
+                        ip += 1 + (misses++ >> 6);  // skip faster through incompressible data
+                        continue;
+                    }
+                    misses = 0;
+                    while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                        --ip;
+                        --ref;
+                    }
+                    const std::size_t len = min_match + commonLength(ip + min_match, ref + min_match, matchlimit);
+                    if (!emit(ip, static_cast<std::size_t>(ip - ref), len)) {
+                        return 0;
+                    }
+                    ip += len;
+                    anchor = ip;
+                    if (ip < mflimit) {
+                        table[hash(read32(ip - 2))] = static_cast<std::uint32_t>(ip - 2 - base);
+                    }
+                }
+            }
+            if (!emit(base + n, 0, 0)) {
+                return 0;
+            }
+            return static_cast<std::size_t>(op - static_cast<unsigned char*>(dst));
+        }
+
+        // Returns the decompressed size, or -1 if the input is malformed or does not fit.
+        inline std::ptrdiff_t decompress(const void* src, std::size_t n, void* dst, std::size_t capacity) {
+            const auto* ip = static_cast<const unsigned char*>(src);
+            const auto* const iend = ip + n;
+            auto* const ostart = static_cast<unsigned char*>(dst);
+            auto* op = ostart;
+            auto* const oend = op + capacity;
+
+            auto readLength = [&](std::size_t& len) -> bool {
+                unsigned char b;
+                do {
+                    if (ip >= iend) return false;
+                    b = *ip++;
+                    len += b;
+                } while (b == 255);
+                return true;
+            };
+
+            for (;;) {
+                if (ip >= iend) return -1;
+                const unsigned token = *ip++;
+                std::size_t lit = token >> 4;
+                if (lit == 15 && !readLength(lit)) return -1;
+                if (lit > static_cast<std::size_t>(iend - ip) || lit > static_cast<std::size_t>(oend - op)) return -1;
+                if (lit <= 16 && iend - ip >= 16 && oend - op >= 16) {
+                    std::memcpy(op, ip, 16);  // fixed-size copy of short literal runs
+                } else {
+                    std::memcpy(op, ip, lit);
+                }
+                op += lit;
+                ip += lit;
+                if (ip == iend) {
+                    break;  // last sequence carries literals only
+                }
+                if (iend - ip < 2) return -1;
+                const std::size_t offset = static_cast<std::size_t>(ip[0]) | (static_cast<std::size_t>(ip[1]) << 8);
+                ip += 2;
+                if (offset == 0 || offset > static_cast<std::size_t>(op - ostart)) return -1;
+                std::size_t len = token & 15;
+                if (len == 15 && !readLength(len)) return -1;
+                len += detail::min_match;
+                if (len > static_cast<std::size_t>(oend - op)) return -1;
+                const unsigned char* match = op - offset;
+                unsigned char* const cpy = op + len;
+                if (offset >= 16 && len <= 16 && oend - op >= 16) {
+                    std::memcpy(op, match, 16);
+                    op = cpy;
+                } else if (offset >= 8 && static_cast<std::size_t>(oend - cpy) >= 8) {
+                    // Wild copy in 8-byte steps; may write up to 7 bytes past cpy, which the
+                    // next sequence overwrites.
+                    do {
+                        std::memcpy(op, match, 8);
+                        op += 8;
+                        match += 8;
+                    } while (op < cpy);
+                    op = cpy;
+                } else {
+                    while (op < cpy) *op++ = *match++;
+                }
+            }
+            return op - ostart;
+        }
+
+        inline std::string compress(const void* src, std::size_t n) {
+            std::string out(compressBound(n), '\0');
+            out.resize(compress(src, n, out.data(), out.size()));
+            return out;
+        }
+
+        // Chunks a byte stream into independently decodable blocks, each prefixed by an 8-byte
+        // header: u32 LE payload size (high bit set when stored uncompressed) and u32 LE raw size.
+        class StreamCompressor {
+        public:
+            static constexpr std::uint32_t stored_flag = 0x80000000u;
+
+            explicit StreamCompressor(std::size_t block_size = 64 * 1024) : block_size_(block_size ? block_size : 64 * 1024) {}
+
+            void write(const void* data, std::size_t n, std::string& out) {
+                const auto* p = static_cast<const char*>(data);
+                while (n > 0) {
+                    if (pending_.empty() && n >= block_size_) {
+                        emitBlock(p, block_size_, out);  // full blocks skip the staging copy
+                        p += block_size_;
+                        n -= block_size_;
+                        continue;
+                    }
+                    const std::size_t take = std::min(n, block_size_ - pending_.size());
+                    pending_.append(p, take);
+                    p += take;
+                    n -= take;
+                    if (pending_.size() == block_size_) {
+                        emitBlock(pending_.data(), pending_.size(), out);
+                        pending_.clear();
+                    }
+                }
+            }
+
+            void flush(std::string& out) {
+                if (!pending_.empty()) {
+                    emitBlock(pending_.data(), pending_.size(), out);
+                    pending_.clear();
+                }
+            }
+
+        private:
+            static void putLe32(std::string& out, std::uint32_t v) {
+                const char b[4] = {static_cast<char>(v), static_cast<char>(v >> 8), static_cast<char>(v >> 16), static_cast<char>(v >> 24)};
+                out.append(b, 4);
+            }
+
+            void emitBlock(const char* data, std::size_t n, std::string& out) {
+                scratch_.resize(compressBound(n));
+                const std::size_t c = compress(data, n, scratch_.data(), scratch_.size());
+                if (c == 0 || c >= n) {
+                    putLe32(out, static_cast<std::uint32_t>(n) | stored_flag);
+                    putLe32(out, static_cast<std::uint32_t>(n));
+                    out.append(data, n);
+                } else {
+                    putLe32(out, static_cast<std::uint32_t>(c));
+                    putLe32(out, static_cast<std::uint32_t>(n));
+                    out.append(scratch_.data(), c);
+                }
+            }
+
+            std::size_t block_size_;
+            std::string pending_;
+            std::string scratch_;
+        };
+
+        class StreamDecompressor {
+        public:
+            explicit StreamDecompressor(std::size_t max_block = 64 * 1024 * 1024) : max_block_(max_block) {}
+
+            // Appends decoded bytes to out. Returns false on corrupt input.
+            bool feed(const void* data, std::size_t n, std::string& out) {
+                buffer_.append(static_cast<const char*>(data), n);
+                std::size_t pos = 0;
+                while (buffer_.size() - pos >= 8) {
+                    const auto* h = reinterpret_cast<const unsigned char*>(buffer_.data() + pos);
+                    const std::uint32_t word = h[0] | (h[1] << 8) | (h[2] << 16) | (static_cast<std::uint32_t>(h[3]) << 24);
+                    const std::uint32_t raw = h[4] | (h[5] << 8) | (h[6] << 16) | (static_cast<std::uint32_t>(h[7]) << 24);
+                    const std::uint32_t size = word & ~StreamCompressor::stored_flag;
+                    if (size > max_block_ || raw > max_block_) return false;
+                    if (buffer_.size() - pos - 8 < size) break;
+                    const char* payload = buffer_.data() + pos + 8;
+                    if (word & StreamCompressor::stored_flag) {
+                        if (size != raw) return false;
+                        out.append(payload, size);
+                    } else {
+                        const std::size_t at = out.size();
+                        out.resize(at + raw);
+                        if (decompress(payload, size, out.data() + at, raw) != static_cast<std::ptrdiff_t>(raw)) return false;
+                    }
+                    pos += 8 + size;
+                }
+                buffer_.erase(0, pos);
+                return true;
+            }
+
+            // True when no partial block is buffered.
+            bool idle() const noexcept { return buffer_.empty(); }
+
+        private:
+            std::size_t max_block_;
+            std::string buffer_;
+        };
+    }
+}
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "threadpool.h"
+
+namespace cpplib {
+    // Parallel algorithms over random-access ranges, run on an existing ThreadPool. Work
+    // is cut into cache-sized chunks that the pool's workers and the calling thread claim
+    // from a shared counter. The caller never waits for a task to be scheduled: it keeps
+    // claiming chunks until none are left and then waits only for chunks already being
+    // worked on. So a call makes progress even when every worker is busy, and it may be
+    // made from inside a pool task. Helpers that start late find nothing left and return.
+    //
+    // If a callable throws, the first exception is rethrown to the caller once the other
+    // chunks have finished; the range is then left in an unspecified order.
+    namespace parallel {
+        // About half a typical per-core L2: a chunk's working set stays cache-resident
+        // while it is processed, and per-chunk overhead (one atomic, one call) is noise.
+        constexpr std::size_t chunk_bytes = 128 * 1024;
+
+        template <typename T>
+        constexpr std::size_t grain() noexcept {
+            return std::max<std::size_t>(chunk_bytes / sizeof(T), 1024);
+        }
+
+        namespace detail {
+            struct Job {
+                std::function<void(std::size_t)> body;
+                std::size_t chunks = 0;
+                std::atomic<std::size_t> next{0};
+                std::atomic<std::size_t> done{0};
+                std::mutex mtx;
+                std::condition_variable cv;
+                std::exception_ptr error;
+            };
+
+            inline void work(Job& job) {
+                for (;;) {
+                    const std::size_t i = job.next.fetch_add(1, std::memory_order_relaxed);
+                    if (i >= job.chunks) return;
+                    try {
+                        job.body(i);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lk(job.mtx);
+                        if (!job.error) job.error = std::current_exception();
+                    }
+                    if (job.done.fetch_add(1, std::memory_order_acq_rel) + 1 == job.chunks) {
+                        std::lock_guard<std::mutex> lk(job.mtx);
+                        job.cv.notify_all();
+                    }
+                }
+            }
+
+            inline std::size_t ceilDiv(std::size_t a, std::size_t b) noexcept { return (a + b - 1) / b; }
+
+            // Raw storage for n objects; holds the ones constructed into it and destroys
+            // them on the way out.
+            template <typename T>
+            class Buffer {
+            public:
+                explicit Buffer(std::size_t n) : n_(n), p_(std::allocator<T>().allocate(n)) {}
+                ~Buffer() {
+                    if (constructed_) std::destroy(p_, p_ + n_);
+                    std::allocator<T>().deallocate(p_, n_);
+                }
+                Buffer(const Buffer&) = delete;
+                Buffer& operator=(const Buffer&) = delete;
+
+                T* data() const noexcept { return p_; }
+                void constructed() noexcept { constructed_ = true; }
+
+            private:
+                std::size_t n_;
+                T* p_;
+                bool constructed_ = false;
+            };
+        }
+
+        // Runs fn(i) for every i in [0, chunks) on the pool and the calling thread.
+        template <typename Fn>
+        void for_each_chunk(ThreadPool& pool, std::size_t chunks, Fn&& fn) {
+            const std::size_t helpers = std::min(pool.getThreadCount(), chunks > 0 ? chunks - 1 : 0);
+            if (helpers == 0) {
+                for (std::size_t i = 0; i < chunks; ++i) fn(i);
+                return;
+            }
+            // Shared so a helper that only starts after we return still has a counter to read.
+            auto job = std::make_shared<detail::Job>();
+            job->body = [&fn](std::size_t i) { fn(i); };
+            job->chunks = chunks;
+            for (std::size_t h = 0; h < helpers; ++h) pool.enqueue([job] { detail::work(*job); });
+            detail::work(*job);
+            {
+                std::unique_lock<std::mutex> lk(job->mtx);
+                job->cv.wait(lk, [&] { return job->done.load(std::memory_order_acquire) == chunks; });
+            }
+            job->body = nullptr;
+            if (job->error) std::rethrow_exception(job->error);
+        }
+
+        // Runs fn(begin, end) over [0, n) in chunks of `grain` indices.
+        template <typename Fn>
+        void for_each_range(ThreadPool& pool, std::size_t n, std::size_t grain, Fn&& fn) {
+            grain = std::max<std::size_t>(grain, 1);
+            for_each_chunk(pool, detail::ceilDiv(n, grain), [&](std::size_t c) {
+                fn(c * grain, std::min(n, (c + 1) * grain));
+            });
+        }
+
+        // reduce(init, reduce(t(x0), t(x1), ...)) with chunk partials combined left to
+        // right, so for a given grain the result does not depend on scheduling.
+        template <typename It, typename T, typename Reduce, typename Transform>
+        T transform_reduce(ThreadPool& pool, It first, It last, T init, Reduce reduce, Transform transform) {
+            using R = std::decay_t<decltype(transform(*first))>;
+            const auto n = static_cast<std::size_t>(last - first);
+            const std::size_t g = grain<R>();
+            std::vector<std::optional<R>> partial(detail::ceilDiv(n, g));
+            for_each_range(pool, n, g, [&](std::size_t b, std::size_t e) {
+                R acc = transform(first[b]);
+                for (std::size_t i = b + 1; i < e; ++i) acc = reduce(std::move(acc), transform(first[i]));
+                partial[b / g].emplace(std::move(acc));
+            });
+            for (auto& p : partial) init = reduce(std::move(init), std::move(*p));
+            return init;
+        }
+
+        namespace detail {
+            // Two passes: each chunk's total, a serial scan over the (few) totals, then each
+            // chunk scanned from its carry. d_first may equal first.
+            template <typename It, typename Out, typename T, typename Op>
+            Out scan(ThreadPool& pool, It first, It last, Out d_first, std::optional<T> init, Op op, bool inclusive) {
+                const auto n = static_cast<std::size_t>(last - first);
+                if (n == 0) return d_first;
+                // Alone, one pass beats two.
+                const std::size_t g = pool.getThreadCount() == 0 ? n : grain<T>();
+                std::vector<std::optional<T>> carry(ceilDiv(n, g));
+                if (carry.size() > 1) {
+                    std::vector<std::optional<T>> total(carry.size());
+                    for_each_range(pool, n, g, [&](std::size_t b, std::size_t e) {
+                        T acc = first[b];
+                        for (std::size_t i = b + 1; i < e; ++i) acc = op(std::move(acc), first[i]);
+                        total[b / g].emplace(std::move(acc));
+                    });
+                    std::optional<T> run = init;
+                    for (std::size_t c = 0; c < carry.size(); ++c) {
+                        carry[c] = run;
+                        run = run ? op(std::move(*run), std::move(*total[c])) : std::move(total[c]);
+                    }
+                } else {
+                    carry[0] = init;
+                }
+                for_each_range(pool, n, g, [&](std::size_t b, std::size_t e) {
+                    std::optional<T> acc = std::move(carry[b / g]);
+                    for (std::size_t i = b; i < e; ++i) {
+                        T x = first[i];  // read before writing: the output may alias the input
+                        if (inclusive) {
+                            acc = acc ? op(std::move(*acc), std::move(x)) : std::move(x);
+                            d_first[i] = *acc;
+                        } else {
+                            d_first[i] = *acc;
+                            acc = op(std::move(*acc), std::move(x));
+                        }
+                    }
+                });
+                return d_first + static_cast<std::ptrdiff_t>(n);
+            }
+        }
+
+        template <typename It, typename Out, typename Op = std::plus<>>
+        Out inclusive_scan(ThreadPool& pool, It first, It last, Out d_first, Op op = Op{}) {
+            using T = typename std::iterator_traits<It>::value_type;
+            return detail::scan<It, Out, T, Op>(pool, first, last, d_first, std::nullopt, op, true);
+        }
+
+        template <typename It, typename Out, typename T, typename Op = std::plus<>>
+        Out exclusive_scan(ThreadPool& pool, It first, It last, Out d_first, T init, Op op = Op{}) {
+            return detail::scan<It, Out, T, Op>(pool, first, last, d_first, std::move(init), op, false);
+        }
+
+        // First element satisfying pred, or last. Chunks are claimed in order and any chunk
+        // past a match already found is skipped, so the work done is about the match
+        // position plus one chunk per thread.
+        template <typename It, typename Pred>
+        It find_first(ThreadPool& pool, It first, It last, Pred pred) {
+            using T = typename std::iterator_traits<It>::value_type;
+            const auto n = static_cast<std::size_t>(last - first);
+            std::atomic<std::size_t> found{n};
+            for_each_range(pool, n, grain<T>(), [&](std::size_t b, std::size_t e) {
+                if (b >= found.load(std::memory_order_relaxed)) return;
+                for (std::size_t i = b; i < e; ++i) {
+                    if (pred(first[i])) {
+                        std::size_t cur = found.load(std::memory_order_relaxed);
+                        while (i < cur && !found.compare_exchange_weak(cur, i, std::memory_order_relaxed)) {}
+                        return;
+                    }
+                }
+            });
+            return first + static_cast<std::ptrdiff_t>(found.load());
+        }
+
+        // Stable partition: elements satisfying pred first, each group in its original
+        // order. pred is called once per element. Returns the start of the second group.
+        template <typename It, typename Pred>
+        It partition(ThreadPool& pool, It first, It last, Pred pred) {
+            using T = typename std::iterator_traits<It>::value_type;
+            const auto n = static_cast<std::size_t>(last - first);
+            const std::size_t g = grain<T>();
+            const std::size_t chunks = detail::ceilDiv(n, g);
+            if (chunks <= 1 || pool.getThreadCount() == 0) return std::stable_partition(first, last, pred);
+
+            std::vector<unsigned char> keep(n);
+            std::vector<std::size_t> front(chunks + 1, 0);
+            for_each_range(pool, n, g, [&](std::size_t b, std::size_t e) {
+                std::size_t count = 0;
+                for (std::size_t i = b; i < e; ++i) count += (keep[i] = pred(first[i]) ? 1 : 0);
+                front[b / g + 1] = count;
+            });
+            for (std::size_t c = 0; c < chunks; ++c) front[c + 1] += front[c];
+            const std::size_t split = front[chunks];
+
+            detail::Buffer<T> buf(n);
+            T* out = buf.data();
+            for_each_range(pool, n, g, [&](std::size_t b, std::size_t e) {
+                std::size_t t = front[b / g];
+                std::size_t f = split + (b - t);  // false elements before this chunk: b - t
+                for (std::size_t i = b; i < e; ++i) {
+                    ::new (static_cast<void*>(out + (keep[i] ? t++ : f++))) T(std::move(first[i]));
+                }
+            });
+            buf.constructed();
+            for_each_range(pool, n, g, [&](std::size_t b, std::size_t e) {
+                std::move(out + b, out + e, first + static_cast<std::ptrdiff_t>(b));
+            });
+            return first + static_cast<std::ptrdiff_t>(split);
+        }
+
+        namespace detail {
+            // Number of elements of `a` among the first k of the stable merge of a and b.
+            template <typename A, typename B, typename Comp>
+            std::size_t coRank(std::size_t k, A a, std::size_t na, B b, std::size_t nb, Comp& comp) {
+                std::size_t lo = k > nb ? k - nb : 0;
+                std::size_t hi = std::min(k, na);
+                while (lo < hi) {
+                    const std::size_t i = lo + (hi - lo) / 2;
+                    if (!comp(b[k - i - 1], a[i])) {
+                        lo = i + 1;  // a[i] goes before b[k-i-1] (ties favour a)
+                    } else {
+                        hi = i;
+                    }
+                }
+                return lo;
+            }
+
+            // One merge level: pairs of adjacent runs from src merged into dst, each pair's
+            // output cut into grain-sized pieces that are placed with coRank and merged
+            // independently. Every piece is placed before any piece moves: coRank reads
+            // elements that a neighbouring piece would otherwise be moving out.
+            template <typename Src, typename Dst, typename Comp>
+            void mergeLevel(ThreadPool& pool, Src src, Dst dst, const std::vector<std::size_t>& bounds,
+                            std::size_t width, std::size_t g, Comp& comp) {
+                struct Piece {
+                    std::size_t lo, mid, hi, k0, k1;
+                    std::size_t i0 = 0, i1 = 0;  // taken from a for outputs k0 and k1
+                };
+                std::vector<Piece> pieces;
+                const std::size_t runs = bounds.size() - 1;
+                for (std::size_t r = 0; r < runs; r += 2 * width) {
+                    const std::size_t lo = bounds[r];
+                    const std::size_t mid = bounds[std::min(r + width, runs)];
+                    const std::size_t hi = bounds[std::min(r + 2 * width, runs)];
+                    for (std::size_t k = 0; k < hi - lo; k += g) pieces.push_back(Piece{lo, mid, hi, k, std::min(k + g, hi - lo)});
+                }
+                for_each_chunk(pool, pieces.size(), [&](std::size_t p) {
+                    Piece& pc = pieces[p];
+                    const auto a = src + static_cast<std::ptrdiff_t>(pc.lo);
+                    const auto b = src + static_cast<std::ptrdiff_t>(pc.mid);
+                    const std::size_t na = pc.mid - pc.lo, nb = pc.hi - pc.mid;
+                    pc.i0 = coRank(pc.k0, a, na, b, nb, comp);
+                    pc.i1 = coRank(pc.k1, a, na, b, nb, comp);
+                });
+                for_each_chunk(pool, pieces.size(), [&](std::size_t p) {
+                    const Piece& pc = pieces[p];
+                    const auto a = src + static_cast<std::ptrdiff_t>(pc.lo);
+                    const auto b = src + static_cast<std::ptrdiff_t>(pc.mid);
+                    std::merge(std::make_move_iterator(a + static_cast<std::ptrdiff_t>(pc.i0)),
+                               std::make_move_iterator(a + static_cast<std::ptrdiff_t>(pc.i1)),
+                               std::make_move_iterator(b + static_cast<std::ptrdiff_t>(pc.k0 - pc.i0)),
+                               std::make_move_iterator(b + static_cast<std::ptrdiff_t>(pc.k1 - pc.i1)),
+                               dst + static_cast<std::ptrdiff_t>(pc.lo + pc.k0), comp);
+                });
+            }
+        }
+
+        namespace detail {
+            template <typename It, typename Comp>
+            void mergeSort(ThreadPool& pool, It first, It last, Comp& comp, bool stable) {
+                using T = typename std::iterator_traits<It>::value_type;
+                const auto n = static_cast<std::size_t>(last - first);
+                const std::size_t g = grain<T>();
+                const std::size_t threads = pool.getThreadCount() + 1;
+                std::size_t runs = 1;
+                while (runs < threads) runs *= 2;
+                while (runs > 1 && n / runs < g) runs /= 2;
+                if (runs == 1) {
+                    if (stable) std::stable_sort(first, last, comp); else std::sort(first, last, comp);
+                    return;
+                }
+
+                std::vector<std::size_t> bounds(runs + 1);
+                for (std::size_t r = 0; r <= runs; ++r) bounds[r] = n * r / runs;
+                Buffer<T> buf(n);
+                T* scratch = buf.data();
+                for_each_chunk(pool, runs, [&](std::size_t r) {
+                    std::uninitialized_move(first + static_cast<std::ptrdiff_t>(bounds[r]),
+                                            first + static_cast<std::ptrdiff_t>(bounds[r + 1]), scratch + bounds[r]);
+                    if (stable) {
+                        std::stable_sort(scratch + bounds[r], scratch + bounds[r + 1], comp);
+                    } else {
+                        std::sort(scratch + bounds[r], scratch + bounds[r + 1], comp);
+                    }
+                });
+                buf.constructed();
+
+                bool in_scratch = true;
+                for (std::size_t width = 1; width < runs; width *= 2) {
+                    if (in_scratch) {
+                        mergeLevel(pool, scratch, first, bounds, width, g, comp);
+                    } else {
+                        mergeLevel(pool, first, scratch, bounds, width, g, comp);
+                    }
+                    in_scratch = !in_scratch;
+                }
+                if (in_scratch) {
+                    for_each_range(pool, n, g, [&](std::size_t b, std::size_t e) {
+                        std::move(scratch + b, scratch + e, first + static_cast<std::ptrdiff_t>(b));
+                    });
+                }
+            }
+        }
+
+        // Parallel merge sort. One run per participating thread (rounded up to a power of
+        // two) is moved into scratch and sorted there; runs are then merged pairwise, each
+        // level splitting every merge into grain-sized pieces so all threads stay busy to
+        // the last level. Uses n elements of scratch.
+        template <typename It, typename Comp = std::less<>>
+        void sort(ThreadPool& pool, It first, It last, Comp comp = Comp{}) {
+            detail::mergeSort(pool, first, last, comp, false);
+        }
+
+        // As sort(), keeping equal elements in their original order.
+        template <typename It, typename Comp = std::less<>>
+        void stable_sort(ThreadPool& pool, It first, It last, Comp comp = Comp{}) {
+            detail::mergeSort(pool, first, last, comp, true);
+        }
+    }
+}
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tcp.h"
+#include "threadpool.h"
+
+namespace cpplib {
+    // Fixed-size pool of framed TcpClients to one endpoint, meant to be opened and warmed
+    // before a service reports ready (see Prewarmer). acquire() lends an idle connection
+    // for exclusive use and the Lease hands it back when destroyed; the most recently
+    // returned connection goes out first, so the hot ones stay hot. A lease that hit an
+    // error should be discard()ed: the connection is closed and reopened, cold, by the
+    // acquire() that next picks it.
+    class ClientPool {
+    public:
+        struct Options {
+            std::string host = "127.0.0.1";
+            int port = 0;
+            std::size_t size = 4;
+            std::size_t min_warm = 0;          // warm connections needed for ready(); 0: all
+            int timeout_ms = 3000;             // socket timeouts, also per warm-up reply
+            std::size_t connect_attempts = 3;
+            std::chrono::milliseconds retry_backoff{50};  // doubles after each failed attempt
+            std::function<void(TcpClient&)> configure;    // before connecting (Fast Open, busy poll, ...)
+            // Warm-up: each connection sends `warmup_frame` `warmup_rounds` times, waiting
+            // for a reply frame each time, so the path, the peer's caches and the congestion
+            // window are warm before the first real request. `warmup` replaces the rounds
+            // with a custom exchange; it returns false if the connection is not usable.
+            std::string warmup_frame;
+            std::size_t warmup_rounds = 0;
+            std::function<bool(TcpClient&)> warmup;
+        };
+
+        struct Report {
+            std::size_t connected = 0;
+            std::size_t warm = 0;
+            std::size_t failed = 0;
+            std::chrono::microseconds elapsed{0};    // wall time of the whole prewarm
+            std::chrono::microseconds first_rtt{0};  // median first warm-up round trip
+            std::chrono::microseconds last_rtt{0};   // median last one: what a first request should see
+        };
+
+        struct Stats {
+            std::uint64_t leases = 0;
+            std::uint64_t waits = 0;       // acquire() found no idle connection
+            std::uint64_t reconnects = 0;  // cold reopens after discard()
+        };
+
+        class Lease {
+        public:
+            Lease() = default;
+            Lease(Lease&& o) noexcept : pool_(o.pool_), slot_(o.slot_), broken_(o.broken_) { o.pool_ = nullptr; }
+            Lease& operator=(Lease&& o) noexcept {
+                if (this != &o) {
+                    reset();
+                    pool_ = o.pool_;
+                    slot_ = o.slot_;
+                    broken_ = o.broken_;
+                    o.pool_ = nullptr;
+                }
+                return *this;
+            }
+            ~Lease() { reset(); }
+
+            explicit operator bool() const noexcept { return pool_ != nullptr; }
+            TcpClient& operator*() const noexcept { return pool_->slots_[slot_]->client; }
+            TcpClient* operator->() const noexcept { return &pool_->slots_[slot_]->client; }
+
+            void discard() noexcept { broken_ = true; }
+
+            void reset() noexcept {
+                if (pool_) pool_->release(slot_, broken_);
+                pool_ = nullptr;
+            }
+
+        private:
+            friend class ClientPool;
+            Lease(ClientPool* pool, std::size_t slot) : pool_(pool), slot_(slot) {}
+
+            ClientPool* pool_ = nullptr;
+            std::size_t slot_ = 0;
+            bool broken_ = false;
+        };
+
+        explicit ClientPool(Options options) : options_(std::move(options)) {
+            for (std::size_t i = 0; i < options_.size; ++i) {
+                slots_.push_back(std::make_unique<Slot>());
+                idle_.push_back(i);
+            }
+        }
+
+        ClientPool(const ClientPool&) = delete;
+        ClientPool& operator=(const ClientPool&) = delete;
+
+        // Opens and warms every connection in parallel on `pool`; blocks until done.
+        Report prewarm(ThreadPool& pool) {
+            auto pending = startWarm(pool);
+            return finishWarm(pending);
+        }
+
+        // As above on a pool of its own with one thread per connection.
+        Report prewarm() {
+            ThreadPool pool(std::max<std::size_t>(slots_.size(), 1));
+            return prewarm(pool);
+        }
+
+        bool ready() const noexcept { return ready_.load(std::memory_order_acquire); }
+        const Report& report() const noexcept { return report_; }
+        const Options& options() const noexcept { return options_; }
+        std::size_t size() const noexcept { return slots_.size(); }
+
+        // Waits up to timeout_ms (negative: forever) for an idle connection. An empty lease
+        // means none came free, or the one that did could not be reopened.
+        Lease acquire(int timeout_ms = -1) {
+            std::size_t slot;
+            {
+                std::unique_lock<std::mutex> lk(mtx_);
+                ++stats_.leases;
+                if (idle_.empty()) {
+                    ++stats_.waits;
+                    auto has_idle = [this] { return !idle_.empty(); };
+                    if (timeout_ms < 0) {
+                        cv_.wait(lk, has_idle);
+                    } else if (!cv_.wait_for(lk, std::chrono::milliseconds(timeout_ms), has_idle)) {
+                        return Lease{};
+                    }
+                }
+                slot = idle_.back();
+                idle_.pop_back();
+                slots_[slot]->leased = true;
+            }
+            if (!slots_[slot]->client.connected()) {
+                {
+                    std::lock_guard<std::mutex> lk(mtx_);
+                    ++stats_.reconnects;
+                }
+                if (!open(*slots_[slot])) {
+                    release(slot, true);
+                    return Lease{};
+                }
+            }
+            return Lease(this, slot);
+        }
+
+        std::size_t idle() const {
+            std::lock_guard<std::mutex> lk(mtx_);
+            return idle_.size();
+        }
+
+        Stats stats() const {
+            std::lock_guard<std::mutex> lk(mtx_);
+            return stats_;
+        }
+
+    private:
+        friend class Prewarmer;
+
+        struct Slot {
+            TcpClient client;
+            std::chrono::microseconds first_rtt{0};
+            std::chrono::microseconds last_rtt{0};
+            bool warm = false;
+            bool leased = false;  // guarded by mtx_; a slot is in idle_ only when not leased or warming
+        };
+
+        bool open(Slot& s) {
+            auto backoff = options_.retry_backoff;
+            for (std::size_t attempt = 0; attempt < std::max<std::size_t>(options_.connect_attempts, 1); ++attempt) {
+                if (attempt > 0) {
+                    std::this_thread::sleep_for(backoff);
+                    backoff *= 2;
+                }
+                s.client.close();
+                if (options_.configure) options_.configure(s.client);
+                if (s.client.connect(options_.host, options_.port, options_.timeout_ms)) return true;
+            }
+            s.client.close();
+            return false;
+        }
+
+        bool warm(Slot& s) {
+            if (options_.warmup) return options_.warmup(s.client);
+            std::vector<std::uint8_t> reply;
+            for (std::size_t round = 0; round < options_.warmup_rounds; ++round) {
+                const auto start = std::chrono::steady_clock::now();
+                if (!s.client.sendFrame(options_.warmup_frame) || !s.client.recvFrame(reply, options_.timeout_ms)) {
+                    return false;
+                }
+                const auto rtt = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+                if (round == 0) s.first_rtt = rtt;
+                s.last_rtt = rtt;
+            }
+            return true;
+        }
+
+        struct Pending {
+            std::chrono::steady_clock::time_point start;
+            std::vector<std::size_t> slots;  // taken out of idle_ while they warm
+            std::vector<std::future<void>> tasks;
+        };
+
+        // Warms the idle slots that are not warm yet; leased and warm ones are left alone,
+        // so a retry never reopens a connection someone is using.
+        Pending startWarm(ThreadPool& pool) {
+            Pending p;
+            p.start = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                auto cold = std::stable_partition(idle_.begin(), idle_.end(), [this](std::size_t i) { return slots_[i]->warm; });
+                p.slots.assign(cold, idle_.end());
+                idle_.erase(cold, idle_.end());
+            }
+            for (std::size_t i : p.slots) {
+                Slot* s = slots_[i].get();
+                p.tasks.push_back(pool.enqueue([this, s] {
+                    s->warm = open(*s) && warm(*s);
+                    if (!s->warm) s->client.close();
+                }));
+            }
+            return p;
+        }
+
+        Report finishWarm(Pending& p) {
+            for (auto& f : p.tasks) f.get();
+            Report r;
+            std::vector<std::chrono::microseconds> first, last;
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                for (std::size_t i = 0; i < slots_.size(); ++i) {
+                    Slot& s = *slots_[i];
+                    // A leased client belongs to its holder; acquire() left it connected.
+                    if (s.leased || s.client.connected()) ++r.connected;
+                    if (s.warm) {
+                        ++r.warm;
+                        first.push_back(s.first_rtt);
+                        last.push_back(s.last_rtt);
+                    } else {
+                        ++r.failed;
+                    }
+                }
+                idle_.insert(idle_.end(), p.slots.begin(), p.slots.end());  // failed slots reopen on acquire()
+                // Warm connections on top of the LIFO so they are lent first.
+                std::stable_partition(idle_.begin(), idle_.end(), [this](std::size_t i) { return !slots_[i]->warm; });
+            }
+            r.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - p.start);
+            r.first_rtt = median(first);
+            r.last_rtt = median(last);
+            report_ = r;
+            const std::size_t need = options_.min_warm ? std::min(options_.min_warm, slots_.size()) : slots_.size();
+            ready_.store(r.warm >= need, std::memory_order_release);
+            cv_.notify_all();
+            return r;
+        }
+
+        static std::chrono::microseconds median(std::vector<std::chrono::microseconds>& v) {
+            if (v.empty()) return std::chrono::microseconds::zero();
+            std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(v.size() / 2), v.end());
+            return v[v.size() / 2];
+        }
+
+        void release(std::size_t slot, bool broken) {
+            if (broken) slots_[slot]->client.close();
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                if (broken) slots_[slot]->warm = false;
+                slots_[slot]->leased = false;
+                idle_.push_back(slot);
+            }
+            cv_.notify_one();
+        }
+
+        Options options_;
+        std::vector<std::unique_ptr<Slot>> slots_;
+        mutable std::mutex mtx_;
+        std::condition_variable cv_;
+        std::vector<std::size_t> idle_;  // LIFO
+        Stats stats_;
+        Report report_;
+        std::atomic<bool> ready_{false};
+    };
+
+    // Startup phase for a service's outbound connections: every connection of every pool
+    // is opened and warmed at the same time, and ready() turns true only once each pool
+    // has its warm quorum. Hook ready() into the health check (or use onReady) so traffic
+    // arrives after connection setup, not during it.
+    class Prewarmer {
+    public:
+        // The pool lives as long as the Prewarmer.
+        ClientPool& add(ClientPool::Options options) {
+            pools_.push_back(std::make_unique<ClientPool>(std::move(options)));
+            return *pools_.back();
+        }
+
+        // Called once, on the thread that runs run(), when every pool is ready. Set before run().
+        void onReady(std::function<void()> fn) { on_ready_ = std::move(fn); }
+
+        // Opens and warms everything on `threads` workers (0: one per connection, up to
+        // 64) and blocks until done. Returns ready(). May be called again to retry: pools
+        // that are already ready are skipped and keep their report.
+        bool run(std::size_t threads = 0) {
+            std::size_t total = 0;
+            for (const auto& p : pools_) total += p->size();
+            if (threads == 0) threads = std::min<std::size_t>(std::max<std::size_t>(total, 1), 64);
+            std::vector<ClientPool::Pending> pending(pools_.size());
+            std::vector<bool> retry(pools_.size());
+            {
+                ThreadPool pool(threads);
+                for (std::size_t i = 0; i < pools_.size(); ++i) {
+                    retry[i] = !pools_[i]->ready();
+                    if (retry[i]) pending[i] = pools_[i]->startWarm(pool);
+                }
+                reports_.clear();
+                for (std::size_t i = 0; i < pools_.size(); ++i) {
+                    reports_.push_back(retry[i] ? pools_[i]->finishWarm(pending[i]) : pools_[i]->report());
+                }
+            }
+            const bool ok = std::all_of(pools_.begin(), pools_.end(), [](const auto& p) { return p->ready(); });
+            if (ok && !ready_.exchange(true, std::memory_order_acq_rel) && on_ready_) on_ready_();
+            return ok;
+        }
+
+        // Safe from any thread, e.g. a readiness probe.
+        bool ready() const noexcept { return ready_.load(std::memory_order_acquire); }
+
+        std::size_t size() const noexcept { return pools_.size(); }
+        ClientPool& pool(std::size_t i) { return *pools_[i]; }
+        const std::vector<ClientPool::Report>& reports() const noexcept { return reports_; }
+
+    private:
+        std::vector<std::unique_ptr<ClientPool>> pools_;
+        std::vector<ClientPool::Report> reports_;
+        std::function<void()> on_ready_;
+        std::atomic<bool> ready_{false};
+    };
+}
@@ -0,0 +1,375 @@
+#pragma once
+
+#include "event_loop.h"
+
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "tcp.h"
+
+#define CPPLIB_HAS_SPLICE_PROXY 1
+
+namespace cpplib {
+    // TCP proxy: accepts on a TcpServer, connects each client to one upstream with a
+    // TcpClient, and moves bytes both ways with splice() through a pipe per direction,
+    // so payload never enters user space. A half-close on either side is passed on with
+    // shutdown(SHUT_WR); the tunnel closes once both directions are done or either fails.
+    //
+    // start(): each tunnel is pumped by its own pool worker, so `workers` bounds the
+    // number of concurrent tunnels. startEpoll(): tunnels are spread over event loops and
+    // the pool only runs upstream connects, for many concurrent tunnels.
+    class SpliceProxy {
+    public:
+        struct Options {
+            std::string upstream_host = "127.0.0.1";
+            int upstream_port = 0;
+            int connect_timeout_ms = 3000;
+            std::size_t pipe_size = 256 * 1024;  // F_SETPIPE_SZ, best effort
+        };
+
+        struct TunnelStats {
+            std::uint64_t id = 0;
+            std::uint64_t to_upstream = 0;
+            std::uint64_t to_client = 0;
+        };
+
+        struct Totals {
+            std::uint64_t opened = 0;
+            std::uint64_t active = 0;
+            std::uint64_t connect_failures = 0;
+            std::uint64_t to_upstream = 0;  // includes tunnels still open
+            std::uint64_t to_client = 0;
+        };
+
+        using OnClose = std::function<void(const TunnelStats&)>;
+
+        explicit SpliceProxy(Options options) : options_(std::move(options)) {}
+        ~SpliceProxy() { stop(); }
+
+        SpliceProxy(const SpliceProxy&) = delete;
+        SpliceProxy& operator=(const SpliceProxy&) = delete;
+
+        bool bind(int port) { return tcp_.bind(port); }
+        bool listen(int backlog = 128) { return tcp_.listen(backlog); }
+        std::uint16_t port() const { return tcp_.port(); }
+
+        // Called with a tunnel's final counters when it closes. Set before start().
+        void setOnClose(OnClose on_close) { on_close_ = std::move(on_close); }
+
+        void start(std::size_t workers) {
+            if (running_.exchange(true)) return;
+            tcp_.setAcceptHandler([this](std::shared_ptr<Socket> client) {
+                if (auto t = open(std::move(client))) runBlocking(*t);
+            });
+            tcp_.start(workers, TcpServer::OnConnect{}, TcpServer::MessageHandler{}, TcpServer::OnDisconnect{});
+        }
+
+        void startEpoll(std::size_t loops = 1, std::size_t connectors = 2) {
+            if (running_.exchange(true)) return;
+            group_ = std::make_unique<EventLoopGroup>(loops);
+            group_->start();
+            tcp_.setAcceptHandler([this](std::shared_ptr<Socket> client) {
+                if (auto t = open(std::move(client))) {
+                    EventLoop& loop = group_->next();
+                    loop.post([this, t, &loop] { attach(loop, t); });
+                }
+            });
+            tcp_.start(connectors, TcpServer::OnConnect{}, TcpServer::MessageHandler{}, TcpServer::OnDisconnect{});
+        }
+
+        void stop() {
+            if (!running_.exchange(false)) return;
+            tcp_.stop();  // joins the workers; threaded tunnels see running_ and finish
+            if (group_) group_->stop();
+            std::vector<std::shared_ptr<Tunnel>> left;
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                for (auto& kv : tunnels_) left.push_back(kv.second);
+            }
+            for (auto& t : left) finish(*t);
+            group_.reset();
+        }
+
+        bool isRunning() const noexcept { return running_.load(); }
+
+        // Counters of the tunnels open right now.
+        std::vector<TunnelStats> tunnels() const {
+            std::vector<TunnelStats> out;
+            std::lock_guard<std::mutex> lk(mtx_);
+            out.reserve(tunnels_.size());
+            for (const auto& kv : tunnels_) out.push_back(kv.second->stats());
+            return out;
+        }
+
+        Totals totals() const {
+            Totals t;
+            std::lock_guard<std::mutex> lk(mtx_);
+            t.opened = opened_;
+            t.active = tunnels_.size();
+            t.connect_failures = connect_failures_;
+            t.to_upstream = closed_up_;
+            t.to_client = closed_down_;
+            for (const auto& kv : tunnels_) {
+                const auto s = kv.second->stats();
+                t.to_upstream += s.to_upstream;
+                t.to_client += s.to_client;
+            }
+            return t;
+        }
+
+        // For transport options (Fast Open, admission control, ...).
+        TcpServer& tcp() noexcept { return tcp_; }
+
+    private:
+        // One direction: in -> pipe -> out.
+        struct Flow {
+            int in = -1;
+            int out = -1;
+            int pipe[2] = {-1, -1};
+            std::size_t chunk = 0;     // pipe capacity
+            std::size_t buffered = 0;  // bytes sitting in the pipe
+            bool eof = false;
+            bool done = false;         // eof seen and everything forwarded
+            std::atomic<std::uint64_t> bytes{0};
+
+            ~Flow() {
+                if (pipe[0] >= 0) ::close(pipe[0]);
+                if (pipe[1] >= 0) ::close(pipe[1]);
+            }
+
+            bool init(int from, int to, std::size_t pipe_size) {
+                in = from;
+                out = to;
+                if (::pipe2(pipe, O_NONBLOCK | O_CLOEXEC) != 0) return false;
+                ::fcntl(pipe[1], F_SETPIPE_SZ, static_cast<int>(pipe_size));
+                const int cap = ::fcntl(pipe[1], F_GETPIPE_SZ);
+                chunk = cap > 0 ? static_cast<std::size_t>(cap) : 64 * 1024;
+                return true;
+            }
+
+            // Moves what it can without blocking; false on a socket error.
+            bool pump() {
+                while (!done) {
+                    if (buffered > 0) {
+                        const auto n = ::splice(pipe[0], nullptr, out, nullptr, buffered, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                        if (n > 0) {
+                            buffered -= static_cast<std::size_t>(n);
+                            bytes.fetch_add(static_cast<std::uint64_t>(n), std::memory_order_relaxed);
+                            continue;
+                        }
+                        if (n < 0 && errno == EINTR) continue;
+                        return n < 0 && errno == EAGAIN;  // EAGAIN: out is full
+                    }
+                    if (eof) {
+                        ::shutdown(out, SHUT_WR);
+                        done = true;
+                        break;
+                    }
+                    // The pipe is empty here, so EAGAIN can only mean `in` has nothing.
+                    const auto n = ::splice(in, nullptr, pipe[1], nullptr, chunk, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                    if (n > 0) {
+                        buffered = static_cast<std::size_t>(n);
+                    } else if (n == 0) {
+                        eof = true;
+                    } else if (errno == EINTR) {
+                        continue;
+                    } else {
+                        return errno == EAGAIN;
+                    }
+                }
+                return true;
+            }
+
+            bool wantsRead() const noexcept { return !done && buffered == 0; }
+            bool wantsWrite() const noexcept { return buffered > 0; }
+        };
+
+        struct Tunnel {
+            std::uint64_t id = 0;
+            std::shared_ptr<Socket> client;
+            TcpClient upstream;
+            Flow up;    // client -> upstream
+            Flow down;  // upstream -> client
+            bool closed = false;
+            std::uint32_t client_events = 0;    // epoll interest, loop thread only
+            std::uint32_t upstream_events = 0;
+            bool client_watched = false;        // registered with the loop
+            bool upstream_watched = false;
+
+            int clientFd() const noexcept { return static_cast<int>(client->native_handle()); }
+            int upstreamFd() const noexcept { return static_cast<int>(upstream.socket().native_handle()); }
+
+            bool pump() { return up.pump() && down.pump(); }
+            bool finished() const noexcept { return up.done && down.done; }
+
+            // Readiness each socket is waiting for, as poll/epoll input/output bits.
+            std::pair<bool, bool> clientWants() const noexcept { return {up.wantsRead(), down.wantsWrite()}; }
+            std::pair<bool, bool> upstreamWants() const noexcept { return {down.wantsRead(), up.wantsWrite()}; }
+
+            TunnelStats stats() const noexcept {
+                TunnelStats s;
+                s.id = id;
+                s.to_upstream = up.bytes.load(std::memory_order_relaxed);
+                s.to_client = down.bytes.load(std::memory_order_relaxed);
+                return s;
+            }
+        };
+
+        // Runs on a pool worker: connects upstream and registers the tunnel.
+        std::shared_ptr<Tunnel> open(std::shared_ptr<Socket> client) {
+            auto t = std::make_shared<Tunnel>();
+            t->client = std::move(client);
+            if (!t->upstream.connect(options_.upstream_host, options_.upstream_port, options_.connect_timeout_ms)) {
+                std::lock_guard<std::mutex> lk(mtx_);
+                ++connect_failures_;
+                t->client->close();
+                return nullptr;
+            }
+            t->upstream.socket().set_timeouts(0, 0);
+            t->client->set_nonblocking(true);
+            t->upstream.socket().set_nonblocking(true);
+            if (!t->up.init(t->clientFd(), t->upstreamFd(), options_.pipe_size) ||
+                !t->down.init(t->upstreamFd(), t->clientFd(), options_.pipe_size)) {
+                t->client->close();
+                return nullptr;
+            }
+            std::lock_guard<std::mutex> lk(mtx_);
+            t->id = ++opened_;
+            tunnels_.emplace(t->id, t);
+            return t;
+        }
+
+        void finish(Tunnel& t) {
+            TunnelStats s;
+            {
+                std::lock_guard<std::mutex> lk(mtx_);
+                if (t.closed) return;
+                t.closed = true;
+                s = t.stats();
+                closed_up_ += s.to_upstream;
+                closed_down_ += s.to_client;
+            }
+            t.client->close();
+            t.upstream.close();
+            if (on_close_) on_close_(s);
+            std::lock_guard<std::mutex> lk(mtx_);
+            tunnels_.erase(t.id);
+        }
+
+        static short pollBits(std::pair<bool, bool> wants) noexcept {
+            return static_cast<short>((wants.first ? POLLIN : 0) | (wants.second ? POLLOUT : 0));
+        }
+
+        // Errors and hangups are reported whatever the interest. Only an error ends the
+        // tunnel; the poll and epoll bits share values.
+        static bool failed(int revents) noexcept { return (revents & POLLERR) != 0; }
+
+        // A hangup on a socket the tunnel is not waiting on, e.g. an upstream that closed
+        // while its last bytes sit in the pipe for a slow client. Not a failure, but it
+        // would wake us forever with nothing to do, so the socket is set aside until the
+        // tunnel needs it again; a real problem then shows up as a failed splice.
+        static bool idleHangup(int revents, int interest) noexcept { return (revents & POLLHUP) && interest == 0; }
+
+        void runBlocking(Tunnel& t) {
+            pollfd fds[2];
+            const int fd[2] = {t.clientFd(), t.upstreamFd()};
+            bool hung_up[2] = {false, false};
+            while (running_.load(std::memory_order_relaxed)) {
+                if (!t.pump() || t.finished()) break;
+                fds[0].events = pollBits(t.clientWants());
+                fds[1].events = pollBits(t.upstreamWants());
+                for (int i = 0; i < 2; ++i) fds[i].fd = hung_up[i] && fds[i].events == 0 ? -1 : fd[i];
+                // Bounded so stop() is noticed.
+                if (::poll(fds, 2, 100) < 0 && errno != EINTR) break;
+                if (failed(fds[0].revents) || failed(fds[1].revents)) break;
+                for (int i = 0; i < 2; ++i) hung_up[i] = hung_up[i] || idleHangup(fds[i].revents, fds[i].events);
+            }
+            finish(t);
+        }
+
+        static std::uint32_t epollBits(std::pair<bool, bool> wants) noexcept {
+            return (wants.first ? EventLoop::READABLE : 0u) | (wants.second ? EventLoop::WRITABLE : 0u);
+        }
+
+        // Loop thread. Level-triggered: interest always matches what the tunnel is waiting
+        // for, so a full pipe never spins on a readable socket.
+        void attach(EventLoop& loop, const std::shared_ptr<Tunnel>& t) {
+            if (t->closed) return;
+            t->client_events = epollBits(t->clientWants());
+            t->upstream_events = epollBits(t->upstreamWants());
+            watch(loop, t, false);
+            watch(loop, t, true);
+            service(loop, t, false);
+        }
+
+        void watch(EventLoop& loop, const std::shared_ptr<Tunnel>& t, bool upstream) {
+            const int fd = upstream ? t->upstreamFd() : t->clientFd();
+            (upstream ? t->upstream_watched : t->client_watched) = true;
+            loop.add(fd, upstream ? t->upstream_events : t->client_events, [this, &loop, t, upstream, fd](std::uint32_t ev) {
+                if (idleHangup(static_cast<int>(ev), static_cast<int>(upstream ? t->upstream_events : t->client_events))) {
+                    // Set aside; service() watches it again once the tunnel needs it.
+                    loop.remove(fd);
+                    (upstream ? t->upstream_watched : t->client_watched) = false;
+                    return;
+                }
+                service(loop, t, failed(static_cast<int>(ev)));
+            });
+        }
+
+        void service(EventLoop& loop, std::shared_ptr<Tunnel> t, bool error) {
+            if (t->closed) return;
+            if (error || !t->pump() || t->finished()) {
+                if (t->client_watched) loop.remove(t->clientFd());
+                if (t->upstream_watched) loop.remove(t->upstreamFd());
+                finish(*t);
+                return;
+            }
+            const auto c = epollBits(t->clientWants());
+            const auto u = epollBits(t->upstreamWants());
+            if (!t->client_watched && c != 0) {
+                t->client_events = c;
+                watch(loop, t, false);
+            } else if (c != t->client_events) {
+                t->client_events = c;
+                if (t->client_watched) loop.modify(t->clientFd(), c);
+            }
+            if (!t->upstream_watched && u != 0) {
+                t->upstream_events = u;
+                watch(loop, t, true);
+            } else if (u != t->upstream_events) {
+                t->upstream_events = u;
+                if (t->upstream_watched) loop.modify(t->upstreamFd(), u);
+            }
+        }
+
+        Options options_;
+        TcpServer tcp_;
+        std::unique_ptr<EventLoopGroup> group_;
+        std::atomic<bool> running_{false};
+        OnClose on_close_;
+
+        mutable std::mutex mtx_;
+        std::unordered_map<std::uint64_t, std::shared_ptr<Tunnel>> tunnels_;
+        std::uint64_t opened_ = 0;
+        std::uint64_t connect_failures_ = 0;
+        std::uint64_t closed_up_ = 0;
+        std::uint64_t closed_down_ = 0;
+    };
+}
+
+#endif
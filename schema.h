@@ -0,0 +1,282 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "bytebuffer.h"
+#include "frame.h"
+
+namespace cpplib {
+    // Flat binary messages with a compile-time layout. A layout lists field types in order:
+    //
+    //   using Quote = schema::Layout<std::uint64_t, double, std::int32_t, schema::Bytes>;
+    //   enum QuoteField { id, price, size, symbol };
+    //
+    // Encoding: u32 size of the fixed region, then the fixed region with scalars inline
+    // (little-endian) and a (u32 offset, u32 length) slot per Bytes/Array field, then the
+    // variable-length data. Builder writes fields straight into a ByteBuffer; View reads
+    // them in place from a received span without parsing or allocating. Fields may be
+    // appended to a layout later: a View over a message from an older sender returns
+    // zero/empty for fields beyond its fixed region.
+    namespace schema {
+        struct Bytes {};
+
+        template <typename T>
+        struct Array {
+            static_assert(std::is_arithmetic<T>::value, "schema::Array holds scalars");
+        };
+
+        namespace detail {
+            template <typename T>
+            struct Slot {
+                static_assert(std::is_arithmetic<T>::value, "schema fields are scalars, Bytes or Array<T>");
+                static constexpr std::size_t size = sizeof(T);
+                static constexpr bool variable = false;
+            };
+
+            template <>
+            struct Slot<Bytes> {
+                static constexpr std::size_t size = 8;
+                static constexpr bool variable = true;
+            };
+
+            template <typename T>
+            struct Slot<Array<T>> {
+                static constexpr std::size_t size = 8;
+                static constexpr bool variable = true;
+            };
+
+            template <typename T>
+            inline void store(char* p, T v) noexcept {
+                if constexpr (std::is_same<T, bool>::value) {
+                    *p = v ? 1 : 0;
+                } else {
+                    std::memcpy(p, &v, sizeof(T));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                    for (std::size_t i = 0; i < sizeof(T) / 2; ++i) std::swap(p[i], p[sizeof(T) - 1 - i]);
+#endif
+                }
+            }
+
+            template <typename T>
+            inline T load(const char* p) noexcept {
+                if constexpr (std::is_same<T, bool>::value) {
+                    return *p != 0;
+                } else {
+                    char b[sizeof(T)];
+                    std::memcpy(b, p, sizeof(T));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                    for (std::size_t i = 0; i < sizeof(T) / 2; ++i) std::swap(b[i], b[sizeof(T) - 1 - i]);
+#endif
+                    T v;
+                    std::memcpy(&v, b, sizeof(T));
+                    return v;
+                }
+            }
+
+            constexpr std::size_t prefix_size = 4;  // u32 fixed-region size
+        }
+
+        template <typename... Fields>
+        struct Layout {
+            static constexpr std::size_t count = sizeof...(Fields);
+
+            template <std::size_t I>
+            using Field = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+            // Offset of field I within the fixed region.
+            template <std::size_t I>
+            static constexpr std::size_t offset() noexcept {
+                constexpr std::size_t sizes[] = {0, detail::Slot<Fields>::size...};
+                std::size_t at = 0;
+                for (std::size_t i = 0; i < I; ++i) at += sizes[i + 1];
+                return at;
+            }
+
+            static constexpr std::size_t fixed_size = (detail::Slot<Fields>::size + ... + 0);
+        };
+
+        // Scalars of an Array<T> field, read in place.
+        template <typename T>
+        class ArrayView {
+        public:
+            ArrayView() = default;
+            ArrayView(const char* data, std::size_t count) : data_(data), count_(count) {}
+
+            std::size_t size() const noexcept { return count_; }
+            bool empty() const noexcept { return count_ == 0; }
+            T operator[](std::size_t i) const noexcept { return detail::load<T>(data_ + i * sizeof(T)); }
+
+        private:
+            const char* data_ = nullptr;
+            std::size_t count_ = 0;
+        };
+
+        // Writes one message into `out`. Scalars may be set in any order; each Bytes/Array
+        // field is set at most once. With `framed`, a frame header goes in front so the
+        // buffer is ready for Socket::send_all / TcpServer::sendTo after finish().
+        template <typename L>
+        class Builder {
+        public:
+            explicit Builder(ByteBuffer& out, bool framed = false) : out_(out), framed_(framed) {
+                if (framed_) frame_ = out_.skip(frame::header_size);
+                start_ = out_.skip(detail::prefix_size + L::fixed_size);
+                char prefix[detail::prefix_size];
+                detail::store<std::uint32_t>(prefix, static_cast<std::uint32_t>(L::fixed_size));
+                out_.backfill(start_, prefix, sizeof(prefix));
+            }
+
+            template <std::size_t I>
+            Builder& set(typename L::template Field<I> value) {
+                using F = typename L::template Field<I>;
+                static_assert(!detail::Slot<F>::variable, "use setBytes/setArray for variable-length fields");
+                char b[sizeof(F)];
+                detail::store<F>(b, value);
+                out_.backfill(slotAt<I>(), b, sizeof(F));
+                return *this;
+            }
+
+            template <std::size_t I>
+            Builder& setBytes(const void* data, std::size_t len) {
+                static_assert(std::is_same<typename L::template Field<I>, Bytes>::value, "field is not Bytes");
+                return setVariable<I>(data, len, len);
+            }
+
+            template <std::size_t I>
+            Builder& setBytes(std::string_view s) { return setBytes<I>(s.data(), s.size()); }
+
+            template <std::size_t I, typename T>
+            Builder& setArray(const T* data, std::size_t count) {
+                static_assert(std::is_same<typename L::template Field<I>, Array<T>>::value, "field is not Array<T>");
+                const auto start = out_.size();
+                for (std::size_t i = 0; i < count; ++i) {
+                    char b[sizeof(T)];
+                    detail::store<T>(b, data[i]);
+                    out_.write(b, sizeof(T));
+                }
+                writeSlot<I>(start, count);
+                return *this;
+            }
+
+            // Completes the message (and frame header). Returns the message size in bytes.
+            std::size_t finish() {
+                const std::size_t size = out_.size() - start_;
+                if (framed_) {
+                    out_.backfillBe<std::uint32_t>(frame_, static_cast<std::uint32_t>(size));
+                }
+                return size;
+            }
+
+        private:
+            template <std::size_t I>
+            std::size_t slotAt() const noexcept {
+                return start_ + detail::prefix_size + L::template offset<I>();
+            }
+
+            template <std::size_t I>
+            Builder& setVariable(const void* data, std::size_t bytes, std::size_t count) {
+                const auto start = out_.size();
+                out_.write(data, bytes);
+                writeSlot<I>(start, count);
+                return *this;
+            }
+
+            template <std::size_t I>
+            void writeSlot(std::size_t at, std::size_t count) {
+                char b[8];
+                detail::store<std::uint32_t>(b, static_cast<std::uint32_t>(at - start_));
+                detail::store<std::uint32_t>(b + 4, static_cast<std::uint32_t>(count));
+                out_.backfill(slotAt<I>(), b, sizeof(b));
+            }
+
+            ByteBuffer& out_;
+            bool framed_;
+            ByteBuffer::Mark frame_ = 0;
+            ByteBuffer::Mark start_ = 0;
+        };
+
+        // Reads a message in place. The span must outlive the view. All offsets are checked
+        // once on construction; a malformed message is !valid() and reads as zero/empty.
+        template <typename L>
+        class View {
+        public:
+            View(const char* data, std::size_t len) : data_(data), len_(len) {
+                if (len_ < detail::prefix_size) return;
+                fixed_ = detail::load<std::uint32_t>(data_);
+                if (fixed_ > len_ - detail::prefix_size) return;
+                valid_ = checkAll(std::make_index_sequence<L::count>{});
+            }
+
+            bool valid() const noexcept { return valid_; }
+            std::size_t size() const noexcept { return len_; }
+
+            template <std::size_t I>
+            auto get() const noexcept {
+                using F = typename L::template Field<I>;
+                if constexpr (std::is_same<F, Bytes>::value) {
+                    const auto [at, n] = span<I>();
+                    return std::string_view(data_ + at, n);
+                } else if constexpr (detail::Slot<F>::variable) {
+                    return arrayOf<I>(static_cast<F*>(nullptr));
+                } else {
+                    if (!present<I>()) return F{};
+                    return detail::load<F>(data_ + detail::prefix_size + L::template offset<I>());
+                }
+            }
+
+        private:
+            template <std::size_t I>
+            bool present() const noexcept {
+                return valid_ && L::template offset<I>() + detail::Slot<typename L::template Field<I>>::size <= fixed_;
+            }
+
+            // (offset, element count) of a variable-length field, or (0, 0) if absent.
+            template <std::size_t I>
+            std::pair<std::size_t, std::size_t> span() const noexcept {
+                if (!present<I>()) return {0, 0};
+                const char* slot = data_ + detail::prefix_size + L::template offset<I>();
+                return {detail::load<std::uint32_t>(slot), detail::load<std::uint32_t>(slot + 4)};
+            }
+
+            template <std::size_t I, typename T>
+            ArrayView<T> arrayOf(Array<T>*) const noexcept {
+                const auto [at, n] = span<I>();
+                return ArrayView<T>(data_ + at, n);
+            }
+
+            template <typename T>
+            static constexpr std::size_t elementSize(Array<T>*) noexcept { return sizeof(T); }
+            static constexpr std::size_t elementSize(Bytes*) noexcept { return 1; }
+
+            template <std::size_t I>
+            bool check() const noexcept {
+                using F = typename L::template Field<I>;
+                if constexpr (!detail::Slot<F>::variable) {
+                    return true;
+                } else {
+                    if (L::template offset<I>() + detail::Slot<F>::size > fixed_) return true;  // older sender
+                    const char* slot = data_ + detail::prefix_size + L::template offset<I>();
+                    const std::uint64_t at = detail::load<std::uint32_t>(slot);
+                    const std::uint64_t bytes = std::uint64_t(detail::load<std::uint32_t>(slot + 4)) * elementSize(static_cast<F*>(nullptr));
+                    if (at == 0 && bytes == 0) return true;  // never set
+                    return at >= detail::prefix_size + fixed_ && at + bytes <= len_;
+                }
+            }
+
+            template <std::size_t... I>
+            bool checkAll(std::index_sequence<I...>) const noexcept {
+                return (check<I>() && ... && true);
+            }
+
+            const char* data_;
+            std::size_t len_;
+            std::size_t fixed_ = 0;
+            bool valid_ = false;
+        };
+    }
+}
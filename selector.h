@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "socket.h"
+
+#if defined(__linux__)
+    #include <sys/epoll.h>
+    #include <unistd.h>
+#elif !defined(_WIN32) && !defined(_WIN64)
+    #include <poll.h>
+#endif
+
+namespace cpplib {
+    // Waits on many sockets at once. Each registration carries a caller-chosen key that is
+    // reported back with its readiness. epoll on Linux, poll()/WSAPoll() elsewhere.
+    // Not thread-safe.
+    class Selector {
+    public:
+        using Key = std::uint64_t;
+
+        enum Interest : std::uint8_t {
+            READ  = 1 << 0,
+            WRITE = 1 << 1
+        };
+
+        struct Event {
+            Key key;
+            bool readable;
+            bool writable;
+            bool error;  // error or hang-up; a read will report the details
+        };
+
+        Selector() {
+#if defined(__linux__)
+            epfd_ = ::epoll_create1(EPOLL_CLOEXEC);
+            if (epfd_ < 0) {
+                throw std::system_error(errno, std::system_category(), "epoll_create1 failed");
+            }
+#endif
+        }
+
+        ~Selector() {
+#if defined(__linux__)
+            if (epfd_ >= 0) ::close(epfd_);
+#endif
+        }
+
+        Selector(const Selector&) = delete;
+        Selector& operator=(const Selector&) = delete;
+
+        bool add(const Socket& socket, Key key, std::uint8_t interest = READ) {
+            const auto fd = socket.native_handle();
+            if (!socket.valid() || entries_.count(fd)) {
+                return false;
+            }
+#if defined(__linux__)
+            epoll_event ev{};
+            ev.events = toEpoll(interest);
+            ev.data.u64 = key;
+            if (::epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                return false;
+            }
+#endif
+            entries_[fd] = Entry{key, interest};
+            return true;
+        }
+
+        bool modify(const Socket& socket, std::uint8_t interest) {
+            auto it = entries_.find(socket.native_handle());
+            if (it == entries_.end()) {
+                return false;
+            }
+#if defined(__linux__)
+            epoll_event ev{};
+            ev.events = toEpoll(interest);
+            ev.data.u64 = it->second.key;
+            if (::epoll_ctl(epfd_, EPOLL_CTL_MOD, it->first, &ev) < 0) {
+                return false;
+            }
+#endif
+            it->second.interest = interest;
+            return true;
+        }
+
+        bool remove(const Socket& socket) {
+            auto it = entries_.find(socket.native_handle());
+            if (it == entries_.end()) {
+                return false;
+            }
+#if defined(__linux__)
+            ::epoll_ctl(epfd_, EPOLL_CTL_DEL, it->first, nullptr);
+#endif
+            entries_.erase(it);
+            return true;
+        }
+
+        std::size_t size() const noexcept { return entries_.size(); }
+
+        // Fills out with ready sockets. Returns the count, 0 on timeout, -1 on error.
+        // Interrupted waits resume with the remaining time.
+        int wait(std::vector<Event>& out, int timeout_ms) {
+            out.clear();
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms < 0 ? 0 : timeout_ms);
+            for (;;) {
+                const int r = waitOnce(out, timeout_ms);
+                if (r >= 0 || errno != EINTR) {
+                    return r;
+                }
+                if (timeout_ms > 0) {
+                    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                    timeout_ms = left > 0 ? static_cast<int>(left) : 0;
+                }
+            }
+        }
+
+    private:
+        using native_t = decltype(std::declval<const Socket&>().native_handle());
+
+        struct Entry {
+            Key key;
+            std::uint8_t interest;
+        };
+
+#if defined(__linux__)
+        static std::uint32_t toEpoll(std::uint8_t interest) {
+            std::uint32_t ev = EPOLLRDHUP;
+            if (interest & READ) ev |= EPOLLIN;
+            if (interest & WRITE) ev |= EPOLLOUT;
+            return ev;
+        }
+
+        int waitOnce(std::vector<Event>& out, int timeout_ms) {
+            events_.resize(std::max<std::size_t>(entries_.size(), 1));
+            const int n = ::epoll_wait(epfd_, events_.data(), static_cast<int>(events_.size()), timeout_ms);
+            for (int i = 0; i < n; ++i) {
+                const auto ev = events_[i].events;
+                out.push_back(Event{events_[i].data.u64, (ev & (EPOLLIN | EPOLLRDHUP)) != 0, (ev & EPOLLOUT) != 0,
+                                    (ev & (EPOLLERR | EPOLLHUP)) != 0});
+            }
+            return n;
+        }
+
+        int epfd_ = -1;
+        std::vector<epoll_event> events_;
+#else
+        int waitOnce(std::vector<Event>& out, int timeout_ms) {
+            fds_.clear();
+            keys_.clear();
+            for (const auto& kv : entries_) {
+    #if defined(_WIN32) || defined(_WIN64)
+                WSAPOLLFD p{};
+                p.fd = kv.first;
+                p.events = static_cast<SHORT>(((kv.second.interest & READ) ? POLLRDNORM : 0) |
+                                              ((kv.second.interest & WRITE) ? POLLWRNORM : 0));
+    #else
+                pollfd p{};
+                p.fd = kv.first;
+                p.events = static_cast<short>(((kv.second.interest & READ) ? POLLIN : 0) |
+                                              ((kv.second.interest & WRITE) ? POLLOUT : 0));
+    #endif
+                fds_.push_back(p);
+                keys_.push_back(kv.second.key);
+            }
+    #if defined(_WIN32) || defined(_WIN64)
+            int n = WSAPoll(fds_.data(), static_cast<ULONG>(fds_.size()), timeout_ms);
+            if (n == SOCKET_ERROR && WSAGetLastError() == WSAEINTR) errno = EINTR;
+            const short rd = POLLRDNORM, wr = POLLWRNORM;
+    #else
+            int n = ::poll(fds_.data(), static_cast<nfds_t>(fds_.size()), timeout_ms);
+            const short rd = POLLIN, wr = POLLOUT;
+    #endif
+            if (n <= 0) {
+                return n < 0 ? -1 : 0;
+            }
+            for (std::size_t i = 0; i < fds_.size(); ++i) {
+                const auto re = fds_[i].revents;
+                if (!re) continue;
+                out.push_back(Event{keys_[i], (re & rd) != 0, (re & wr) != 0, (re & (POLLERR | POLLHUP)) != 0});
+            }
+            return static_cast<int>(out.size());
+        }
+
+    #if defined(_WIN32) || defined(_WIN64)
+        std::vector<WSAPOLLFD> fds_;
+    #else
+        std::vector<pollfd> fds_;
+    #endif
+        std::vector<Key> keys_;
+#endif
+        std::unordered_map<native_t, Entry> entries_;
+    };
+}
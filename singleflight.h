@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cpplib {
+    // Collapses concurrent calls that share a key into one execution. The first caller
+    // (the leader) runs the function; callers arriving while it is in flight get the very
+    // same result buffer instead of running it again. Nothing is cached: once the leader
+    // finishes, the next call with that key runs afresh. Thread-safe.
+    class SingleFlight {
+    public:
+        using Result   = std::shared_ptr<const std::string>;
+        using Function = std::function<std::string()>;
+        using Done     = std::function<void(Result)>;
+
+        struct Stats {
+            std::uint64_t calls = 0;
+            std::uint64_t executions = 0;
+            std::uint64_t coalesced = 0;  // calls served by another caller's execution
+        };
+
+        // Blocks until the result is ready; rethrows the leader's exception.
+        Result run(const std::string& key, const Function& fn) {
+            std::unique_lock<std::mutex> lk(mutex_);
+            calls_.fetch_add(1, std::memory_order_relaxed);
+            auto it = inflight_.find(key);
+            if (it != inflight_.end()) {
+                coalesced_.fetch_add(1, std::memory_order_relaxed);
+                auto call = it->second;
+                call->cv.wait(lk, [&] { return call->done; });
+                if (call->error) std::rethrow_exception(call->error);
+                return call->result;
+            }
+            auto call = lead(key);
+            lk.unlock();
+            execute(key, *call, fn);
+            if (call->error) std::rethrow_exception(call->error);
+            return call->result;
+        }
+
+        // Never blocks on another caller: a follower's `done` is queued and later invoked on
+        // the leader's thread. `done` receives nullptr if the function threw. Suited to
+        // event-loop handlers that must not wait.
+        void run(const std::string& key, const Function& fn, Done done) {
+            std::unique_lock<std::mutex> lk(mutex_);
+            calls_.fetch_add(1, std::memory_order_relaxed);
+            auto it = inflight_.find(key);
+            if (it != inflight_.end()) {
+                coalesced_.fetch_add(1, std::memory_order_relaxed);
+                it->second->waiters.push_back(std::move(done));
+                return;
+            }
+            auto call = lead(key);
+            lk.unlock();
+            execute(key, *call, fn);
+            done(call->result);
+        }
+
+        std::size_t inflight() const {
+            std::lock_guard<std::mutex> lk(mutex_);
+            return inflight_.size();
+        }
+
+        Stats stats() const {
+            Stats s;
+            s.calls = calls_.load(std::memory_order_relaxed);
+            s.executions = executions_.load(std::memory_order_relaxed);
+            s.coalesced = coalesced_.load(std::memory_order_relaxed);
+            return s;
+        }
+
+    private:
+        struct Call {
+            std::condition_variable cv;
+            bool done = false;
+            Result result;
+            std::exception_ptr error;
+            std::vector<Done> waiters;
+        };
+
+        std::shared_ptr<Call> lead(const std::string& key) {
+            executions_.fetch_add(1, std::memory_order_relaxed);
+            auto call = std::make_shared<Call>();
+            inflight_.emplace(key, call);
+            return call;
+        }
+
+        void execute(const std::string& key, Call& call, const Function& fn) {
+            Result result;
+            std::exception_ptr error;
+            try {
+                result = std::make_shared<const std::string>(fn());
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::vector<Done> waiters;
+            {
+                std::lock_guard<std::mutex> lk(mutex_);
+                call.result = std::move(result);
+                call.error = error;
+                call.done = true;
+                waiters.swap(call.waiters);
+                inflight_.erase(key);
+            }
+            call.cv.notify_all();
+            for (auto& w : waiters) w(call.result);
+        }
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, std::shared_ptr<Call>> inflight_;
+        std::atomic<std::uint64_t> calls_{0};
+        std::atomic<std::uint64_t> executions_{0};
+        std::atomic<std::uint64_t> coalesced_{0};
+    };
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -15,12 +17,22 @@
 #else
     #include <arpa/inet.h>
     #include <cerrno>
+    #include <fcntl.h>
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <poll.h>
     #include <sys/socket.h>
+    #include <sys/uio.h>
     #include <unistd.h>
 #endif
 
 namespace cpplib {
+    // One piece of a gathered write.
+    struct IoSlice {
+        const void* data;
+        std::size_t size;
+    };
+
     class Socket {
     public:
         Socket();
@@ -37,16 +49,28 @@ namespace cpplib {
         bool connect(const std::string& address, int port);
         std::ptrdiff_t send(const void* buffer, std::size_t length);
         std::ptrdiff_t receive(void* buffer, std::size_t length);
+        std::ptrdiff_t receive_nowait(void* buffer, std::size_t length);
         std::ptrdiff_t send_all(const void* buffer, std::size_t length);  
+        std::ptrdiff_t send_all(const IoSlice* slices, std::size_t count);
+        std::ptrdiff_t send_some(const IoSlice* slices, std::size_t count);
         std::ptrdiff_t recv_exact(void* buffer, std::size_t length);
         bool set_timeouts(int recv_ms, int send_ms) noexcept;
         bool wait_readable(int timeout_ms) noexcept;
+        bool wait_readable(std::chrono::microseconds timeout) noexcept;
         bool wait_writable(int timeout_ms) noexcept;
         void close();
         void shutdown();
         bool valid() const noexcept;
         std::uint16_t localPort() const;
-    private:
+        bool open();
+        bool set_nonblocking(bool enable) noexcept;
+        bool set_reuse_port(bool enable);
+        int incoming_cpu() const noexcept;
+        bool set_incoming_cpu(int cpu) noexcept;
+        bool set_fast_open(int queue_len) noexcept;
+        bool set_fast_open_connect(bool enable) noexcept;
+        bool set_busy_poll(int usec) noexcept;
+        int pending_error() const noexcept;
 #if defined(_WIN32) || defined(_WIN64)
         using native_socket_t = SOCKET;
         static constexpr native_socket_t invalid_socket = INVALID_SOCKET;
@@ -54,6 +78,9 @@ namespace cpplib {
         using native_socket_t = int;
         static constexpr native_socket_t invalid_socket = -1;
 #endif
+        static constexpr std::ptrdiff_t would_block = -2;  // receive_nowait(), send_some(): not now
+        native_socket_t native_handle() const noexcept { return sockfd; }
+    private:
 
         explicit Socket(native_socket_t handle);
 
@@ -62,6 +89,10 @@ namespace cpplib {
 #endif
         void ensureSocket();
         void closeSocket() noexcept;
+        bool would_block_nonblocking() const noexcept;
+#if !defined(_WIN32) && !defined(_WIN64)
+        bool poll_for(short events, int timeout_ms) const noexcept;
+#endif
 
         native_socket_t sockfd;
     };
@@ -295,6 +326,33 @@ namespace cpplib {
         }
     }
 
+    // Never blocks, whatever the socket's mode. Returns the bytes read, 0 once the peer has
+    // closed, would_block when nothing is queued, and -1 on error.
+    inline std::ptrdiff_t Socket::receive_nowait(void* buffer, std::size_t length) {
+        if (!valid()) {
+            return -1;
+        }
+#if defined(_WIN32) || defined(_WIN64)
+        if (!wait_readable(0)) {
+            return would_block;
+        }
+        return receive(buffer, length);
+#else
+        for (;;) {
+            const auto received = ::recv(sockfd, buffer, length, MSG_DONTWAIT);
+            if (received >= 0) {
+                return received;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return would_block;
+            }
+            if (errno != EINTR) {
+                return -1;
+            }
+        }
+#endif
+    }
+
     inline std::ptrdiff_t Socket::send_all(const void* buf, std::size_t len) {
         if (!valid()) return -1;
         const char* p = static_cast<const char*>(buf);
@@ -305,7 +363,11 @@ namespace cpplib {
             if (r == SOCKET_ERROR) return -1;
     #else
             ssize_t r = ::send(sockfd, p + sent, len - sent, 0);
-            if (r < 0) { if (errno == EINTR) continue; return -1; }
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                if (would_block_nonblocking() && wait_writable(-1)) continue;
+                return -1;
+            }
     #endif
             if (r == 0) break;
             sent += (std::size_t)r;
@@ -313,6 +375,116 @@ namespace cpplib {
         return (std::ptrdiff_t)sent;
     }
 
+    // Gathered send_all: writes every slice in order with as few syscalls as the kernel
+    // allows (sendmsg / WSASend), without concatenating them first.
+    inline std::ptrdiff_t Socket::send_all(const IoSlice* slices, std::size_t count) {
+        if (!valid()) return -1;
+        constexpr std::size_t batch = 64;
+        std::size_t sent = 0;
+        std::size_t i = 0;
+        std::size_t offset = 0;  // bytes of slices[i] already sent
+        for (;;) {
+            while (i < count && offset == slices[i].size) {
+                ++i;
+                offset = 0;
+            }
+            if (i == count) break;
+    #if defined(_WIN32)
+            WSABUF bufs[batch];
+            DWORD n = 0;
+            for (std::size_t j = i; j < count && n < batch; ++j) {
+                const std::size_t skip = j == i ? offset : 0;
+                if (slices[j].size == skip) continue;
+                bufs[n].buf = const_cast<char*>(static_cast<const char*>(slices[j].data) + skip);
+                bufs[n].len = static_cast<ULONG>(slices[j].size - skip);
+                ++n;
+            }
+            DWORD written = 0;
+            if (WSASend(sockfd, bufs, n, &written, 0, nullptr, nullptr) == SOCKET_ERROR) return -1;
+            std::size_t r = written;
+    #else
+            iovec iov[batch];
+            std::size_t n = 0;
+            for (std::size_t j = i; j < count && n < batch; ++j) {
+                const std::size_t skip = j == i ? offset : 0;
+                if (slices[j].size == skip) continue;
+                iov[n].iov_base = const_cast<char*>(static_cast<const char*>(slices[j].data) + skip);
+                iov[n].iov_len = slices[j].size - skip;
+                ++n;
+            }
+            msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = n;
+            const ssize_t w = ::sendmsg(sockfd, &msg, 0);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                if (would_block_nonblocking() && wait_writable(-1)) continue;
+                return -1;
+            }
+            std::size_t r = static_cast<std::size_t>(w);
+    #endif
+            if (r == 0) break;
+            sent += r;
+            while (r > 0) {
+                const std::size_t left = slices[i].size - offset;
+                if (r < left) {
+                    offset += r;
+                    break;
+                }
+                r -= left;
+                ++i;
+                offset = 0;
+            }
+        }
+        return static_cast<std::ptrdiff_t>(sent);
+    }
+
+    // One gathered write that never blocks, whatever the socket's mode. Returns the bytes
+    // the kernel took (possibly fewer than offered), would_block when it took none, and -1
+    // on error.
+    inline std::ptrdiff_t Socket::send_some(const IoSlice* slices, std::size_t count) {
+        if (!valid()) return -1;
+        constexpr std::size_t batch = 64;
+    #if defined(_WIN32)
+        if (!wait_writable(0)) return would_block;
+        WSABUF bufs[batch];
+        DWORD n = 0;
+        for (std::size_t j = 0; j < count && n < batch; ++j) {
+            if (slices[j].size == 0) continue;
+            bufs[n].buf = const_cast<char*>(static_cast<const char*>(slices[j].data));
+            bufs[n].len = static_cast<ULONG>(slices[j].size);
+            ++n;
+        }
+        DWORD written = 0;
+        if (WSASend(sockfd, bufs, n, &written, 0, nullptr, nullptr) == SOCKET_ERROR) {
+            return WSAGetLastError() == WSAEWOULDBLOCK ? would_block : -1;
+        }
+        return static_cast<std::ptrdiff_t>(written);
+    #else
+        iovec iov[batch];
+        std::size_t n = 0;
+        for (std::size_t j = 0; j < count && n < batch; ++j) {
+            if (slices[j].size == 0) continue;
+            iov[n].iov_base = const_cast<char*>(static_cast<const char*>(slices[j].data));
+            iov[n].iov_len = slices[j].size;
+            ++n;
+        }
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n;
+        int flags = MSG_DONTWAIT;
+    #if defined(MSG_NOSIGNAL)
+        flags |= MSG_NOSIGNAL;
+    #endif
+        for (;;) {
+            const ssize_t w = ::sendmsg(sockfd, &msg, flags);
+            if (w >= 0) return static_cast<std::ptrdiff_t>(w);
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? would_block : -1;
+        }
+    #endif
+    }
+
     inline std::ptrdiff_t Socket::recv_exact(void* buf, std::size_t len) {
         if (!valid()) return -1;
         char* p = static_cast<char*>(buf);
@@ -323,7 +495,11 @@ namespace cpplib {
             if (r == SOCKET_ERROR) return -1;
     #else
             ssize_t r = ::recv(sockfd, p + got, len - got, 0);
-            if (r < 0) { if (errno == EINTR) continue; return -1; }
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                if (would_block_nonblocking() && wait_readable(-1)) continue;
+                return -1;
+            }
     #endif
             if (r == 0) return 0; // peer closed
             got += (std::size_t)r;
@@ -348,10 +524,27 @@ namespace cpplib {
         int r = WSAPoll(&p, 1, timeout_ms);
         return r > 0 && (p.revents & (POLLRDNORM | POLLHUP | POLLERR));
     #else
-        fd_set fds; FD_ZERO(&fds); FD_SET(sockfd, &fds);
-        timeval tv{ timeout_ms/1000, (timeout_ms%1000)*1000 };
-        int r = select(sockfd+1, &fds, nullptr, nullptr, (timeout_ms<0? nullptr: &tv));
-        return r > 0;
+        return poll_for(POLLIN, timeout_ms);
+    #endif
+    }
+    // Sub-millisecond variant; only Linux (ppoll) honours microseconds, elsewhere the wait
+    // is rounded up to whole milliseconds.
+    inline bool Socket::wait_readable(std::chrono::microseconds timeout) noexcept {
+        if (timeout.count() < 0) timeout = std::chrono::microseconds::zero();
+    #if defined(__linux__)
+        if (!valid()) return false;
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        pollfd p{ sockfd, POLLIN, 0 };
+        for (;;) {
+            const auto left = std::max<std::int64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now()).count(), 0);
+            const timespec ts{ static_cast<time_t>(left / 1000000000), static_cast<long>(left % 1000000000) };
+            int r = ::ppoll(&p, 1, &ts, nullptr);
+            if (r > 0) return (p.revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+            if (r == 0 || errno != EINTR) return false;
+        }
+    #else
+        return wait_readable(static_cast<int>((timeout.count() + 999) / 1000));
     #endif
     }
     inline bool Socket::wait_writable(int timeout_ms) noexcept {
@@ -360,10 +553,146 @@ namespace cpplib {
         int r = WSAPoll(&p, 1, timeout_ms);
         return r > 0 && (p.revents & (POLLWRNORM | POLLERR));
     #else
-        fd_set fds; FD_ZERO(&fds); FD_SET(sockfd, &fds);
-        timeval tv{ timeout_ms/1000, (timeout_ms%1000)*1000 };
-        int r = select(sockfd+1, nullptr, &fds, nullptr, (timeout_ms<0? nullptr: &tv));
-        return r > 0;
+        return poll_for(POLLOUT, timeout_ms);
+    #endif
+    }
+
+    #if !defined(_WIN32)
+    // poll() has no FD_SETSIZE limit (select() is undefined above fd 1023); a signal only
+    // shortens the wait by the time already spent.
+    inline bool Socket::poll_for(short events, int timeout_ms) const noexcept {
+        if (!valid()) return false;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms < 0 ? 0 : timeout_ms);
+        pollfd p{ sockfd, events, 0 };
+        for (;;) {
+            int r = ::poll(&p, 1, timeout_ms);
+            if (r > 0) return (p.revents & (events | POLLHUP | POLLERR)) != 0;
+            if (r == 0 || errno != EINTR) return false;
+            if (timeout_ms > 0) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                timeout_ms = left > 0 ? static_cast<int>(left) : 0;
+            }
+        }
+    }
+    #endif
+
+    inline bool Socket::open() {
+        ensureSocket();
+        return valid();
+    }
+
+    // SO_ERROR: the outcome of a non-blocking connect() once the socket turns writable.
+    inline int Socket::pending_error() const noexcept {
+        if (!valid()) return -1;
+        int err = 0;
+    #if defined(_WIN32)
+        int len = sizeof(err);
+    #else
+        socklen_t len = sizeof(err);
+    #endif
+        if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &len) != 0) return -1;
+        return err;
+    }
+
+    inline bool Socket::set_nonblocking(bool enable) noexcept {
+        if (!valid()) return false;
+    #if defined(_WIN32)
+        u_long mode = enable ? 1 : 0;
+        return ioctlsocket(sockfd, FIONBIO, &mode) == 0;
+    #else
+        int flags = ::fcntl(sockfd, F_GETFL, 0);
+        if (flags < 0) return false;
+        flags = enable ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+        return ::fcntl(sockfd, F_SETFL, flags) == 0;
+    #endif
+    }
+
+    // EAGAIN on a socket in non-blocking mode means "try again once ready"; on a blocking
+    // socket it means SO_RCVTIMEO/SO_SNDTIMEO expired and must be reported.
+    inline bool Socket::would_block_nonblocking() const noexcept {
+    #if defined(_WIN32)
+        return false;
+    #else
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return false;
+        const int flags = ::fcntl(sockfd, F_GETFL, 0);
+        return flags >= 0 && (flags & O_NONBLOCK);
+    #endif
+    }
+
+    inline bool Socket::set_reuse_port(bool enable) {
+        ensureSocket();
+    #if defined(SO_REUSEPORT)
+        int v = enable ? 1 : 0;
+        return ::setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, reinterpret_cast<const char*>(&v), sizeof(v)) == 0;
+    #else
+        (void)enable;
+        return false;
+    #endif
+    }
+
+    // SO_INCOMING_CPU: the CPU that last processed this socket's packets, or -1 where the
+    // option is unavailable.
+    inline int Socket::incoming_cpu() const noexcept {
+    #if defined(SO_INCOMING_CPU)
+        if (!valid()) return -1;
+        int cpu = -1;
+        socklen_t len = sizeof(cpu);
+        if (::getsockopt(sockfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) != 0) return -1;
+        return cpu;
+    #else
+        return -1;
+    #endif
+    }
+
+    // On a SO_REUSEPORT listener (Linux 6.1+), prefers it for connections whose packets
+    // arrive on `cpu`.
+    inline bool Socket::set_incoming_cpu(int cpu) noexcept {
+    #if defined(SO_INCOMING_CPU)
+        if (!valid()) return false;
+        return ::setsockopt(sockfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == 0;
+    #else
+        (void)cpu;
+        return false;
+    #endif
+    }
+
+    // TCP_FASTOPEN on a listener: accept data carried in the SYN, with at most `queue_len`
+    // such connections pending the handshake. Needs the server bit of the
+    // net.ipv4.tcp_fastopen sysctl; without it the listener behaves as before.
+    inline bool Socket::set_fast_open(int queue_len) noexcept {
+    #if defined(TCP_FASTOPEN)
+        if (!valid()) return false;
+        return ::setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN, reinterpret_cast<const char*>(&queue_len), sizeof(queue_len)) == 0;
+    #else
+        (void)queue_len;
+        return false;
+    #endif
+    }
+
+    // TCP_FASTOPEN_CONNECT (Linux 4.11+): connect() returns at once and the handshake
+    // goes out with the first write, which rides in the SYN when a cookie for the peer is
+    // cached. Otherwise the kernel does a normal handshake and sends the data after it.
+    inline bool Socket::set_fast_open_connect(bool enable) noexcept {
+    #if defined(TCP_FASTOPEN_CONNECT)
+        if (!valid()) return false;
+        int v = enable ? 1 : 0;
+        return ::setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &v, sizeof(v)) == 0;
+    #else
+        (void)enable;
+        return false;
+    #endif
+    }
+
+    // SO_BUSY_POLL: blocking receives on this socket poll the device queue for up to `usec`
+    // before sleeping. Only helps on NICs with NAPI busy-poll support (not loopback), and
+    // raising it above net.core.busy_read needs CAP_NET_ADMIN.
+    inline bool Socket::set_busy_poll(int usec) noexcept {
+    #if defined(SO_BUSY_POLL)
+        if (!valid()) return false;
+        return ::setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) == 0;
+    #else
+        (void)usec;
+        return false;
     #endif
     }
 
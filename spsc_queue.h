@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #include <immintrin.h>
+#endif
+
+namespace cpplib {
+    // Spin-wait hint: lets the sibling hyperthread run and avoids the memory-order
+    // mis-speculation penalty when the awaited store finally lands.
+    inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield" ::: "memory");
+#endif
+    }
+
+    // Bounded wait-free single-producer/single-consumer ring. Exactly one thread may call
+    // try_push() and exactly one (other) thread may call try_pop(). Capacity is rounded up
+    // to a power of two.
+    template <typename T>
+    class SpscQueue {
+    public:
+        explicit SpscQueue(std::size_t capacity = 1024) {
+            std::size_t cap = 2;
+            while (cap < capacity) cap <<= 1;
+            mask_ = cap - 1;
+            slots_ = std::allocator<Slot>().allocate(cap);
+        }
+
+        ~SpscQueue() {
+            while (try_pop()) {}
+            std::allocator<Slot>().deallocate(slots_, mask_ + 1);
+        }
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        template <typename... Args>
+        bool try_emplace(Args&&... args) {
+            const std::size_t tail = tail_.load(std::memory_order_relaxed);
+            if (tail - head_cache_ > mask_) {
+                head_cache_ = head_.load(std::memory_order_acquire);
+                if (tail - head_cache_ > mask_) {
+                    return false;
+                }
+            }
+            ::new (static_cast<void*>(&slots_[tail & mask_])) T(std::forward<Args>(args)...);
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool try_push(T value) { return try_emplace(std::move(value)); }
+
+        std::optional<T> try_pop() {
+            const std::size_t head = head_.load(std::memory_order_relaxed);
+            if (head == tail_cache_) {
+                tail_cache_ = tail_.load(std::memory_order_acquire);
+                if (head == tail_cache_) {
+                    return std::nullopt;
+                }
+            }
+            T* slot = std::launder(reinterpret_cast<T*>(&slots_[head & mask_]));
+            std::optional<T> out(std::move(*slot));
+            slot->~T();
+            head_.store(head + 1, std::memory_order_release);
+            return out;
+        }
+
+        bool empty() const noexcept {
+            return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+        }
+
+        std::size_t capacity() const noexcept { return mask_ + 1; }
+
+    private:
+        using Slot = std::aligned_storage_t<sizeof(T), alignof(T)>;
+        static constexpr std::size_t cache_line = 64;
+
+        Slot* slots_ = nullptr;
+        std::size_t mask_ = 0;
+        alignas(cache_line) std::atomic<std::size_t> head_{0};  // consumer
+        std::size_t tail_cache_ = 0;
+        alignas(cache_line) std::atomic<std::size_t> tail_{0};  // producer
+        std::size_t head_cache_ = 0;
+    };
+}
@@ -1,15 +1,21 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
+#include <deque>
 #include <functional>
+#include <future>
 #include <memory>
 #include <string>
 #include <thread>
 #include <vector>
 #include <chrono>
 #include <unordered_map>
+#include <unordered_set>
 #include <mutex>
+#include <memory_resource>
+#include <optional>
 #if defined(_WIN32)
   #include <winsock2.h>
   #include <ws2tcpip.h>
@@ -17,7 +23,16 @@
   #include <arpa/inet.h>
 #endif
 
+#include "arena.h"
+#include "bytebuffer.h"
+#include "codel.h"
+#include "crc32c.h"
+#include "event_loop.h"
+#include "frame.h"
+#include "hugepage.h"
+#include "selector.h"
 #include "socket.h"
+#include "spsc_queue.h"
 #include "threadpool.h"
 
 namespace cpplib {
@@ -26,9 +41,13 @@ namespace cpplib {
         TcpClient() = default;
 
         bool connect(const std::string& host, int port, int timeout_ms = 3000) {
+            if (fast_open_ && socket_.open()) {
+                socket_.set_fast_open_connect(true);  // unsupported: plain connect below
+            }
             if (!socket_.connect(host, port)) return false;
             // Optional low-latency defaults and timeouts
             socket_.set_timeouts(timeout_ms, timeout_ms);
+            if (busy_poll_usec_ > 0) socket_.set_busy_poll(busy_poll_usec_);  // best effort
             return true;
         }
 
@@ -55,23 +74,113 @@ namespace cpplib {
             return out;
         }
 
+        // Frames of at least `threshold` bytes are sent lz-compressed when that makes them
+        // smaller; 0 turns compression off. Receiving always accepts compressed frames.
+        void setCompression(std::size_t threshold) { compress_threshold_ = threshold; }
+
+        // Sends frames with a CRC-32C of the body. Receiving always verifies checksummed
+        // frames and fails on a mismatch.
+        void setChecksum(bool on) { checksum_ = on; }
+
+        // TCP Fast Open for the next connect(): the first frame sent travels in the SYN
+        // when the kernel holds a cookie for the server, saving a round trip. connect()
+        // then returns before the handshake, so a refused connection shows up as a failed
+        // first send. Falls back to a normal handshake wherever TFO is unavailable.
+        void setFastOpen(bool on) { fast_open_ = on; }
+
+        // Busy-poll receive: recvFrame spins on non-blocking reads for up to `spin` before
+        // blocking, trading a core for the wake-up latency of a sleeping receiver. A
+        // nonzero `kernel_usec` also sets SO_BUSY_POLL, which polls the NIC queue inside
+        // blocking reads where the driver supports it. A zero spin turns it off.
+        void setBusyPoll(std::chrono::microseconds spin, int kernel_usec = 0) {
+            spin_ = spin;
+            busy_poll_usec_ = kernel_usec;
+            if (kernel_usec > 0 && socket_.valid()) socket_.set_busy_poll(kernel_usec);
+        }
+
         bool sendFrame(const void* data, std::uint32_t len) {
-            std::uint32_t be = htonl(len);
-            if (socket_.send_all(&be, 4) < 0) return false;
-            if (len == 0) return true;
-            return socket_.send_all(data, len) == static_cast<std::ptrdiff_t>(len);
+            if (len > frame::length_mask - (checksum_ ? frame::checksum_size : 0)) return false;
+            if (compress_threshold_ && len >= compress_threshold_) {
+                send_buf_.clear();
+                frame::append(send_buf_, data, len, compress_threshold_, checksum_);
+                return send(send_buf_.data(), send_buf_.size());
+            }
+            // Header and body go out in one gathered write, so a Fast Open SYN carries
+            // the whole frame rather than just its header.
+            char head[frame::header_size + frame::checksum_size];
+            std::size_t head_len = frame::header_size;
+            if (checksum_) {
+                frame::putBe32(head, (len + static_cast<std::uint32_t>(frame::checksum_size)) | frame::checksummed);
+                frame::putBe32(head + frame::header_size, crc32c(data, len));
+                head_len += frame::checksum_size;
+            } else {
+                frame::putBe32(head, len);
+            }
+            const IoSlice parts[2] = {{head, head_len}, {data, len}};
+            const auto total = static_cast<std::ptrdiff_t>(head_len + len);
+            return socket_.send_all(parts, len ? 2 : 1) == total;
         }
 
         bool sendFrame(const std::string& s) { return sendFrame(s.data(), static_cast<std::uint32_t>(s.size())); }
 
+        // Sends the header and every segment with one gathered write; referenced segments
+        // are not copied. Compressed frames still have to be flattened first.
+        bool sendFrame(const SegmentedBuffer& msg) {
+            const std::size_t len = msg.size();
+            if (len > frame::length_mask - (checksum_ ? frame::checksum_size : 0)) return false;
+            if (compress_threshold_ && len >= compress_threshold_) {
+                std::string flat;
+                msg.copyTo(flat);
+                return sendFrame(flat);
+            }
+            char head[frame::header_size + frame::checksum_size];
+            std::size_t head_len = frame::header_size;
+            if (checksum_) {
+                std::uint32_t crc = 0;
+                msg.forEach([&](const char* p, std::size_t n) { crc = crc32c(p, n, crc); });
+                frame::putBe32(head, static_cast<std::uint32_t>(len + frame::checksum_size) | frame::checksummed);
+                frame::putBe32(head + frame::header_size, crc);
+                head_len += frame::checksum_size;
+            } else {
+                frame::putBe32(head, static_cast<std::uint32_t>(len));
+            }
+            msg.slices(slices_);
+            slices_.insert(slices_.begin(), IoSlice{head, head_len});
+            const auto total = static_cast<std::ptrdiff_t>(head_len + len);
+            return socket_.send_all(slices_.data(), slices_.size()) == total;
+        }
+
+        bool send(const SegmentedBuffer& msg) {
+            msg.slices(slices_);
+            return socket_.send_all(slices_.data(), slices_.size()) == static_cast<std::ptrdiff_t>(msg.size());
+        }
+
         bool recvFrame(std::vector<std::uint8_t>& out, int timeout_ms) {
-            if (!socket_.wait_readable(timeout_ms)) return false;
             std::uint32_t be = 0;
-            if (socket_.recv_exact(&be, 4) <= 0) return false;
-            std::uint32_t need = ntohl(be);
+            if (!recvHeader(be, timeout_ms)) return false;
+            const std::uint32_t header = ntohl(be);
+            std::uint32_t need = header & frame::length_mask;
+            if (header & frame::checksummed) {
+                if (need < frame::checksum_size || socket_.recv_exact(&be, 4) != 4) return false;
+                need -= static_cast<std::uint32_t>(frame::checksum_size);
+                out.resize(need);
+                // Each chunk lands in an L1-sized staging buffer and is checksummed as it is
+                // copied into place (crc32cCopy), so verifying costs no extra pass.
+                constexpr std::size_t chunk = 16 * 1024;
+                char stage[chunk];
+                std::uint32_t crc = 0;
+                for (std::size_t got = 0; got < need;) {
+                    const std::size_t take = std::min<std::size_t>(chunk, need - got);
+                    if (socket_.recv_exact(stage, take) != static_cast<std::ptrdiff_t>(take)) return false;
+                    crc = crc32cCopy(out.data() + got, stage, take, crc);
+                    got += take;
+                }
+                if (crc != ntohl(be)) return false;
+                return frame::decodeBody(header, out, frame::length_mask);
+            }
             out.resize(need);
-            if (need == 0) return true;
-            return socket_.recv_exact(out.data(), need) == static_cast<std::ptrdiff_t>(need);
+            if (need > 0 && socket_.recv_exact(out.data(), need) != static_cast<std::ptrdiff_t>(need)) return false;
+            return frame::decodeBody(header, out, frame::length_mask);
         }
 
         bool recvFrame(std::string& out, int timeout_ms) {
@@ -87,8 +196,120 @@ namespace cpplib {
 
         bool connected() const { return socket_.valid(); }
 
+        Socket& socket() noexcept { return socket_; }
+        const Socket& socket() const noexcept { return socket_; }
+
     private:
+        bool recvHeader(std::uint32_t& be, int timeout_ms) {
+            char* p = reinterpret_cast<char*>(&be);
+            std::size_t got = 0;
+            if (spin_.count() > 0) {
+                const auto deadline = std::chrono::steady_clock::now() + spin_;
+                while (got < sizeof(be)) {
+                    const auto n = socket_.receive_nowait(p + got, sizeof(be) - got);
+                    if (n > 0) {
+                        got += static_cast<std::size_t>(n);
+                    } else if (n != Socket::would_block) {
+                        return false;
+                    } else if (std::chrono::steady_clock::now() >= deadline) {
+                        break;
+                    } else {
+                        cpu_relax();
+                    }
+                }
+            }
+            if (got == 0 && !socket_.wait_readable(timeout_ms)) return false;
+            const std::size_t left = sizeof(be) - got;
+            return left == 0 || socket_.recv_exact(p + got, left) == static_cast<std::ptrdiff_t>(left);
+        }
+
         Socket socket_;
+        std::size_t compress_threshold_ = 0;
+        bool checksum_ = false;
+        bool fast_open_ = false;
+        std::chrono::microseconds spin_{0};
+        int busy_poll_usec_ = 0;
+        std::string send_buf_;
+        std::vector<IoSlice> slices_;
+    };
+
+    // Fan-out/fan-in over several TcpClients from one thread: send to all of them, then
+    // take replies in whatever order they arrive. Clients are not owned and must outlive
+    // their membership.
+    class TcpClientGroup {
+    public:
+        std::size_t add(TcpClient& client) {
+            const std::size_t index = members_.size();
+            members_.push_back(&client);
+            if (!selector_.add(client.socket(), index)) {
+                members_.back() = nullptr;
+            }
+            return index;
+        }
+
+        bool remove(std::size_t index) {
+            if (index >= members_.size() || !members_[index]) {
+                return false;
+            }
+            selector_.remove(members_[index]->socket());
+            members_[index] = nullptr;
+            return true;
+        }
+
+        std::size_t size() const noexcept { return selector_.size(); }
+        TcpClient* at(std::size_t index) const { return index < members_.size() ? members_[index] : nullptr; }
+
+        std::size_t sendFrameAll(const void* data, std::uint32_t len) {
+            std::size_t ok = 0;
+            for (auto* c : members_) if (c && c->sendFrame(data, len)) ++ok;
+            return ok;
+        }
+
+        std::size_t sendFrameAll(const std::string& s) { return sendFrameAll(s.data(), static_cast<std::uint32_t>(s.size())); }
+
+        // Waits for any member to become readable and reads one frame from it. Returns the
+        // member's index; nullopt on timeout. A member whose read fails (peer closed, bad
+        // frame) is removed from the group and reported through `failed` if given.
+        std::optional<std::size_t> recvAnyFrame(std::vector<std::uint8_t>& out, int timeout_ms,
+                                                std::vector<std::size_t>* failed = nullptr) {
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms < 0 ? 0 : timeout_ms);
+            while (selector_.size() > 0) {
+                if (ready_pos_ >= ready_.size()) {
+                    int wait_ms = timeout_ms;
+                    if (timeout_ms > 0) {
+                        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                        wait_ms = left > 0 ? static_cast<int>(left) : 0;
+                    }
+                    ready_pos_ = 0;
+                    if (selector_.wait(ready_, wait_ms) <= 0) {
+                        ready_.clear();
+                        return std::nullopt;
+                    }
+                }
+                const auto index = static_cast<std::size_t>(ready_[ready_pos_++].key);
+                TcpClient* c = at(index);
+                if (!c) continue;  // removed since the wait
+                if (c->recvFrame(out, 0)) {
+                    return index;
+                }
+                remove(index);
+                if (failed) failed->push_back(index);
+            }
+            return std::nullopt;
+        }
+
+        std::optional<std::size_t> recvAnyFrame(std::string& out, int timeout_ms, std::vector<std::size_t>* failed = nullptr) {
+            std::vector<std::uint8_t> buf;
+            auto index = recvAnyFrame(buf, timeout_ms, failed);
+            if (index) out.assign(reinterpret_cast<const char*>(buf.data()), buf.size());
+            return index;
+        }
+
+    private:
+        Selector selector_;
+        std::vector<TcpClient*> members_;
+        std::vector<Selector::Event> ready_;
+        std::size_t ready_pos_ = 0;
     };
 
     class TcpServer {
@@ -97,6 +318,9 @@ namespace cpplib {
         using OnConnect      = std::function<void(ClientId, std::shared_ptr<Socket>)>;
         using MessageHandler = std::function<void(ClientId, std::shared_ptr<Socket>, const char*, std::size_t)>;
         using OnDisconnect   = std::function<void(ClientId)>;
+        using OnReject       = std::function<void(std::shared_ptr<Socket>)>;
+        using InboundTap     = std::function<void(ClientId, const char*, std::size_t)>;
+        using AcceptHandler  = std::function<void(std::shared_ptr<Socket>)>;
 
         TcpServer() : running_(false) {}
         ~TcpServer() { stop(); }
@@ -106,10 +330,24 @@ namespace cpplib {
         }
 
         bool listen(int backlog = 16) {
+            backlog_ = backlog;
+            if (fast_open_queue_ > 0 && listener_.open()) {
+                listener_.set_fast_open(fast_open_queue_);  // best effort
+            }
             return listener_.listen(backlog);
         }
 
+        // Accepts TCP Fast Open on the listener(s): up to `queue` connections whose SYN
+        // carried data may be pending at once, and that data is delivered before the
+        // handshake completes. 0 turns it off. Clients without a cookie, and kernels with
+        // the server side disabled, simply do a normal handshake.
+        bool setFastOpen(int queue) {
+            fast_open_queue_ = queue;
+            return !listener_.valid() || listener_.set_fast_open(queue);
+        }
+
         std::uint16_t port() const {
+            if (listen_port_) return listen_port_;
             return listener_.localPort();
         }
 
@@ -128,17 +366,160 @@ namespace cpplib {
             accept_thread_ = std::thread([this] { acceptLoop(); });
         }
 
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+        // Thread-per-core mode: one pinned EventLoop per core, each with its own SO_REUSEPORT
+        // listener, client map, message arena and receive buffer, so cores share no mutable
+        // state and the kernel spreads new connections across them. Handlers run on the
+        // owning core and must not block. A ClientId carries its core in the top byte;
+        // sendTo()/broadcast()/closeClient() from other threads are forwarded to that core.
+        // Their writes never wait on the peer: what its socket cannot take now is queued and
+        // written as it drains (see setOutboundLimit), and closeClient() sends the queue
+        // first. Writes made directly on a handler's Socket still wait, so reply via sendTo().
+        bool startPerCore(std::size_t cores, MessageHandler on_message) {
+            return startPerCore(cores, OnConnect{}, std::move(on_message), OnDisconnect{});
+        }
+
+        bool startPerCore(std::size_t cores, OnConnect on_connect, MessageHandler on_message, OnDisconnect on_disconnect) {
+            if (running_.exchange(true)) {
+                return false;
+            }
+            const int port = listener_.localPort();
+            if (port == 0) {
+                running_ = false;
+                return false;
+            }
+            on_connect_    = std::move(on_connect);
+            on_message_    = std::move(on_message);
+            on_disconnect_ = std::move(on_disconnect);
+
+            // The port is re-bound by every core with SO_REUSEPORT, which the original
+            // listener did not set.
+            listener_.close();
+            group_ = std::make_unique<EventLoopGroup>(std::min<std::size_t>(cores, max_cores));
+            shards_.clear();
+            for (std::size_t i = 0; i < group_->size(); ++i) {
+                auto shard = std::make_unique<CoreShard>(i, group_->at(i), group_->size());
+                if (steer_ && group_->cpuOf(i) >= 0) {
+                    shard->listener.open();
+                    shard->listener.set_incoming_cpu(group_->cpuOf(i));  // best effort
+                }
+                if (fast_open_queue_ > 0) {
+                    shard->listener.open();
+                    shard->listener.set_fast_open(fast_open_queue_);  // best effort
+                }
+                if (!shard->listener.set_reuse_port(true) || !shard->listener.bind(port) ||
+                    !shard->listener.listen(backlog_) || !shard->listener.set_nonblocking(true)) {
+                    shards_.clear();
+                    group_.reset();
+                    running_ = false;
+                    return false;
+                }
+                shards_.push_back(std::move(shard));
+            }
+            for (auto& sp : shards_) {
+                CoreShard* sh = sp.get();
+                sh->cork.sink = [this, sh](ClientId id, const IoSlice* parts, std::size_t count) {
+                    return queueOnCore(*sh, id, parts, count);
+                };
+                sh->loop.add(sh->listener.native_handle(), EventLoop::READABLE, [this, sh](std::uint32_t) { acceptOnCore(*sh); });
+                sh->loop.add(sh->inbox_fd, EventLoop::READABLE, [this, sh](std::uint32_t) { drainInbox(*sh); });
+                sh->loop.post([this, sh] {
+                    currentCore() = {this, sh->index};
+                    // First touch on the core itself keeps these NUMA-local.
+                    sh->arena = std::make_unique<MonotonicArena>(arena_block_size_);
+                    sh->rx.allocate(std::max<std::size_t>(recv_buffer_size_, 64 * 1024));
+                });
+            }
+            listen_port_ = static_cast<std::uint16_t>(port);
+            group_->start();
+            return true;
+        }
+
+        // Runs fn on the given core. From another core of this server it travels through
+        // that pair's SPSC queue, in order: while the queue is full, tasks wait in a FIFO on
+        // the sending core and are moved over as space frees up. From any other thread it
+        // uses EventLoop::post().
+        bool postToCore(std::size_t core, std::function<void()> fn) {
+            if (!group_ || core >= shards_.size()) {
+                return false;
+            }
+            CoreShard& target = *shards_[core];
+            const auto self = currentCore();
+            if (self.server == this && self.index != core) {
+                CoreShard& src = *shards_[self.index];
+                auto& backlog = src.overflow[core];
+                if (backlog.empty() && target.inboxFrom(self.index).try_emplace(std::move(fn))) {
+                    target.signal();
+                } else {
+                    backlog.push_back(std::move(fn));
+                    drainOverflow(src);
+                }
+                return true;
+            } else if (self.server == this) {
+                fn();
+                return true;
+            }
+            target.loop.post(std::move(fn));
+            return true;
+        }
+
+        std::size_t numCores() const noexcept { return shards_.size(); }
+
+        // CPU steering for per-core mode: each listener asks the kernel for connections
+        // arriving on its own CPU, and every accepted socket's SO_INCOMING_CPU is checked;
+        // a connection whose packets land on another core's CPU is handed to that core. If
+        // no core is pinned to that CPU it goes to the least-loaded core. Set before
+        // startPerCore().
+        void setCpuSteering(bool enable) { steer_ = enable; }
+
+        struct SteeringStats {
+            std::uint64_t accepted = 0;
+            std::uint64_t local = 0;     // accepted on the core of its incoming CPU
+            std::uint64_t moved = 0;     // handed to the core of its incoming CPU
+            std::uint64_t fallback = 0;  // no core on that CPU (or unknown): least loaded
+            double hitRate() const noexcept {
+                return accepted ? static_cast<double>(local + moved) / static_cast<double>(accepted) : 0.0;
+            }
+        };
+
+        SteeringStats steeringStats() const noexcept {
+            SteeringStats s;
+            s.local = steer_local_.load(std::memory_order_relaxed);
+            s.moved = steer_moved_.load(std::memory_order_relaxed);
+            s.fallback = steer_fallback_.load(std::memory_order_relaxed);
+            s.accepted = s.local + s.moved + s.fallback;
+            return s;
+        }
+
+        static std::size_t coreOf(ClientId id) noexcept { return static_cast<std::size_t>(id >> core_shift); }
+#endif
+
         void stop() {
             if (!running_.exchange(false)) {
                 return;
             }
-            listener_.close();  // closing unblocks accept()
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+            if (group_) {
+                group_->stop();
+                for (auto& sh : shards_) {
+                    for (auto& kv : sh->clients) if (kv.second) { kv.second->shutdown(); kv.second->close(); }
+                    sh->clients.clear();
+                    sh->outboxes.clear();
+                }
+                shards_.clear();
+                group_.reset();
+                listen_port_ = 0;
+                return;
+            }
+#endif
+            listener_.shutdown();  // wakes a blocked accept(); close() alone does not on Linux
+            listener_.close();
             if (accept_thread_.joinable()) {
                 accept_thread_.join();
             }
             {
                 std::lock_guard<std::mutex> lk(clients_mtx_);
-                for (auto &kv : clients_) if (kv.second) kv.second->close();
+                for (auto &kv : clients_) if (kv.second) { kv.second->shutdown(); kv.second->close(); }
                 clients_.clear();
             }
             pool_.reset();
@@ -147,6 +528,22 @@ namespace cpplib {
         bool isRunning() const noexcept { return running_.load(); }
 
         bool sendTo(ClientId id, const void* data, std::size_t len) {
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+            if (group_) {
+                if (onCore(coreOf(id))) {
+                    // Already on the owning core: write (or cork) straight from the caller's buffer.
+                    CoreShard& sh = *shards_[coreOf(id)];
+                    if (auto* cork = activeCork()) {
+                        auto it = sh.clients.find(id);
+                        return it != sh.clients.end() && cork->add(id, it->second, data, len, cork_limit_);
+                    }
+                    return writeOnCore(sh, id, data, len);
+                }
+                return onOwningCore(id, [this, id, payload = std::string(static_cast<const char*>(data), len)](CoreShard& sh) {
+                    return writeOnCore(sh, id, payload.data(), payload.size());
+                });
+            }
+#endif
             std::shared_ptr<Socket> s;
             {
                 std::lock_guard<std::mutex> lk(clients_mtx_);
@@ -154,22 +551,73 @@ namespace cpplib {
                 if (it == clients_.end()) return false;
                 s = it->second;
             }
-            return s && (s->send_all(data, len) == static_cast<std::ptrdiff_t>(len));
+            if (!s) return false;
+            if (auto* cork = activeCork()) return cork->add(id, s, data, len, cork_limit_);
+            return s->send_all(data, len) == static_cast<std::ptrdiff_t>(len);
         }
 
         bool sendTextTo(ClientId id, const std::string& text) {
             return sendTo(id, text.data(), text.size());
         }
 
+        // Sends a shared buffer (e.g. a ResponseCache value) without copying it: per-core
+        // forwarding and write coalescing hold a reference instead.
+        bool sendTo(ClientId id, std::shared_ptr<const std::string> data) {
+            if (!data) return false;
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+            if (group_) {
+                if (auto* cork = activeCork(); cork && onCore(coreOf(id))) {
+                    auto& clients = shards_[coreOf(id)]->clients;
+                    auto it = clients.find(id);
+                    return it != clients.end() && cork->add(id, it->second, std::move(data), cork_limit_);
+                }
+                return onOwningCore(id, [this, id, data = std::move(data)](CoreShard& sh) {
+                    return writeOnCore(sh, id, data->data(), data->size());
+                });
+            }
+#endif
+            std::shared_ptr<Socket> s;
+            {
+                std::lock_guard<std::mutex> lk(clients_mtx_);
+                auto it = clients_.find(id);
+                if (it == clients_.end()) return false;
+                s = it->second;
+            }
+            if (!s) return false;
+            if (auto* cork = activeCork()) return cork->add(id, s, std::move(data), cork_limit_);
+            return s->send_all(data->data(), data->size()) == static_cast<std::ptrdiff_t>(data->size());
+        }
+
         std::size_t broadcast(const void* data, std::size_t len) {
-            std::vector<std::shared_ptr<Socket>> copy;
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+            if (group_) {
+                // Queued per core behind anything corked or queued for each client; the result
+                // counts clients connected at the time of the call.
+                auto payload = std::make_shared<const std::string>(static_cast<const char*>(data), len);
+                std::size_t n = 0;
+                for (auto& sh : shards_) {
+                    n += sh->num_clients.load(std::memory_order_relaxed);
+                    postToCore(sh->index, [this, sh = sh.get(), payload] {
+                        for (auto& kv : sh->clients) writeOnCore(*sh, kv.first, payload->data(), payload->size());
+                    });
+                }
+                return n;
+            }
+#endif
+            std::vector<std::pair<ClientId, std::shared_ptr<Socket>>> copy;
             {
                 std::lock_guard<std::mutex> lk(clients_mtx_);
                 copy.reserve(clients_.size());
-                for (auto &kv : clients_) copy.push_back(kv.second);
+                for (auto &kv : clients_) copy.emplace_back(kv.first, kv.second);
             }
+            // From a coalescing handler, what it already corked for a client goes out first.
+            auto* cork = activeCork();
             std::size_t ok = 0;
-            for (auto &s : copy) if (s && s->send_all(data, len) == static_cast<std::ptrdiff_t>(len)) ++ok;
+            for (auto &kv : copy) {
+                if (!kv.second) continue;
+                if (cork) cork->flush(kv.first);
+                if (kv.second->send_all(data, len) == static_cast<std::ptrdiff_t>(len)) ++ok;
+            }
             return ok;
         }
 
@@ -179,6 +627,17 @@ namespace cpplib {
 
         std::vector<ClientId> clientIds() const {
             std::vector<ClientId> ids;
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+            if (group_) {
+                // Each core mirrors its ids under a lock of its own, so this never waits on a
+                // core's loop and is safe from any thread, a core included.
+                for (auto& sh : shards_) {
+                    std::lock_guard<std::mutex> lk(sh->ids_mtx);
+                    ids.insert(ids.end(), sh->ids.begin(), sh->ids.end());
+                }
+                return ids;
+            }
+#endif
             std::lock_guard<std::mutex> lk(clients_mtx_);
             ids.reserve(clients_.size());
             for (auto &kv : clients_) ids.push_back(kv.first);
@@ -186,6 +645,12 @@ namespace cpplib {
         }
 
         bool closeClient(ClientId id) {
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+            if (group_) {
+                return onOwningCore(id, [this, id](CoreShard& sh) { return closeOnCore(sh, id); });
+            }
+#endif
+            if (auto* cork = activeCork()) cork->flush(id);
             std::shared_ptr<Socket> s;
             {
                 std::lock_guard<std::mutex> lk(clients_mtx_);
@@ -199,10 +664,98 @@ namespace cpplib {
         }
 
         std::size_t numClients() const {
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+            if (group_) {
+                std::size_t n = 0;
+                for (auto& sh : shards_) n += sh->num_clients.load(std::memory_order_relaxed);
+                return n;
+            }
+#endif
             std::lock_guard<std::mutex> lk(clients_mtx_);
             return clients_.size();
         }
 
+        // Scratch memory for the message currently being dispatched on this thread. Everything
+        // allocated from it is dropped when on_message returns, so do not let it escape.
+        static std::pmr::memory_resource* messageArena() noexcept {
+            auto* arena = currentArena();
+            return arena ? static_cast<std::pmr::memory_resource*>(arena) : std::pmr::get_default_resource();
+        }
+
+        void setMessageArenaBlockSize(std::size_t bytes) { arena_block_size_ = bytes; }
+
+        // Per-connection receive buffer; sizes of HugePageBuffer::huge_threshold and up are
+        // huge-page backed.
+        void setReceiveBufferSize(std::size_t bytes) { recv_buffer_size_ = bytes ? bytes : 4096; }
+
+        // Write coalescing: sendTo()/sendTextTo() calls made from a handler are gathered per
+        // connection and written with one gathered write once the handler returns, or up to
+        // `window` later if more input arrives meanwhile. A connection with `limit` bytes
+        // pending is written at once. Writes made directly on the handler's Socket bypass
+        // this, so flush() first if they must stay in order. Set before start().
+        void setWriteCoalescing(bool enable, std::chrono::microseconds window = std::chrono::microseconds(0),
+                                std::size_t limit = 64 * 1024) {
+            coalesce_ = enable;
+            cork_window_ = window;
+            cork_limit_ = limit;
+        }
+
+        // Per-core mode: bytes that may wait for a peer that is not reading. A connection that
+        // falls further behind is dropped. Set before startPerCore().
+        void setOutboundLimit(std::size_t bytes) { outbound_limit_ = bytes; }
+
+        // Framed mode: on_message receives one decoded frame (see frame.h) per call instead of
+        // raw chunks; a corrupt stream or a frame over max_frame bytes drops the connection.
+        // Set before start().
+        void setFramed(std::size_t max_frame = 64 * 1024 * 1024) { max_frame_ = max_frame; }
+
+        // Hands every accepted connection to `handler`, which owns it from then on: the
+        // server neither reads it nor tracks it, and on_connect/on_message/on_disconnect are
+        // not called for it. The handler runs where the connection would have been served:
+        // on a pool worker (after admission control), or on the accepting core in per-core
+        // mode, where the socket is already non-blocking. For proxies and protocols that
+        // drive the socket themselves. Set before start().
+        void setAcceptHandler(AcceptHandler handler) { accept_handler_ = std::move(handler); }
+
+        // Sees every inbound message (a decoded frame in framed mode, else a raw chunk)
+        // just before on_message, on the same thread; e.g. a CaptureWriter. Set before start().
+        void setInboundTap(InboundTap tap) { tap_ = std::move(tap); }
+
+        // Sends data as one frame (header plus body) through sendTo().
+        bool sendFrameTo(ClientId id, const void* data, std::size_t len) {
+            if (len > frame::length_mask) return false;
+            std::string wire;
+            wire.reserve(frame::header_size + len);
+            frame::append(wire, data, static_cast<std::uint32_t>(len));
+            return sendTo(id, wire.data(), wire.size());
+        }
+
+        bool sendFrameTo(ClientId id, const std::string& s) { return sendFrameTo(id, s.data(), s.size()); }
+
+        // Load shedding for the threaded mode, where an accepted connection waits in the pool
+        // queue until a worker frees up. The wait is fed to a CoDel controller; under a
+        // standing queue new connections are refused and queued ones are shed, each handed
+        // to on_reject (e.g. to write a "busy" reply) and closed, so overload turns into fast
+        // failures instead of timeouts. Set before start().
+        void setAdmissionControl(CoDel::Options options, OnReject on_reject = {}) {
+            admission_ = std::make_unique<CoDel>(options);
+            on_reject_ = std::move(on_reject);
+        }
+
+        // Zeroes when admission control is off.
+        CoDel::Stats admissionStats() const { return admission_ ? admission_->stats() : CoDel::Stats{}; }
+
+        // Writes out whatever is pending for the connection. Returns false if that fails.
+        bool flush(ClientId id) {
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+            if (group_) {
+                return onOwningCore(id, [id](CoreShard& sh) { return sh.cork.flush(id); });
+            }
+#endif
+            if (auto* cork = activeCork()) return cork->flush(id);
+            return true;
+        }
+
     private:
         std::atomic<ClientId> next_id_{1};
         mutable std::mutex clients_mtx_;
@@ -215,15 +768,178 @@ namespace cpplib {
         std::atomic<bool> running_;
         std::unique_ptr<ThreadPool> pool_;
         std::thread accept_thread_;
+        std::size_t arena_block_size_ = 64 * 1024;
+        std::size_t recv_buffer_size_ = 4096;
+        int backlog_ = 16;
+        int fast_open_queue_ = 0;
+        std::uint16_t listen_port_ = 0;
+        bool coalesce_ = false;
+        std::chrono::microseconds cork_window_{0};
+        std::size_t cork_limit_ = 64 * 1024;
+        std::size_t outbound_limit_ = 8 * 1024 * 1024;
+        bool steer_ = false;
+        std::atomic<std::uint64_t> steer_local_{0};
+        std::atomic<std::uint64_t> steer_moved_{0};
+        std::atomic<std::uint64_t> steer_fallback_{0};
+        std::unique_ptr<CoDel> admission_;
+        OnReject on_reject_;
+        std::size_t max_frame_ = 0;  // 0: raw chunks
+        InboundTap tap_;
+        AcceptHandler accept_handler_;
+
+        static MonotonicArena*& currentArena() noexcept {
+            thread_local MonotonicArena* arena = nullptr;
+            return arena;
+        }
+
+        struct ArenaScope {
+            explicit ArenaScope(MonotonicArena& a) : arena(a) { currentArena() = &arena; }
+            ~ArenaScope() { currentArena() = nullptr; arena.reset(); }
+            MonotonicArena& arena;
+        };
+
+        // Sends gathered for coalescing, one entry per destination connection. Entries are
+        // recycled so a steady request/response loop does not allocate.
+        struct WriteCork {
+            struct Pending {
+                ClientId id = 0;
+                std::shared_ptr<Socket> socket;
+                SegmentedBuffer data;
+            };
+
+            bool empty() const noexcept { return active == 0; }
+
+            bool add(ClientId id, const std::shared_ptr<Socket>& socket, const void* data, std::size_t len, std::size_t limit) {
+                const std::size_t i = slot(id, socket);
+                pending[i].data.append(data, len);
+                return pending[i].data.size() < limit || flushAt(i);
+            }
+
+            bool add(ClientId id, const std::shared_ptr<Socket>& socket, std::shared_ptr<const std::string> data, std::size_t limit) {
+                const std::size_t i = slot(id, socket);
+                pending[i].data.appendRef(std::move(data));
+                return pending[i].data.size() < limit || flushAt(i);
+            }
+
+            bool flush(ClientId id) {
+                const std::size_t i = find(id);
+                return i == active || flushAt(i);
+            }
+
+            void flush() {
+                for (std::size_t i = 0; i < active; ++i) {
+                    write(pending[i]);
+                    pending[i].socket.reset();
+                }
+                active = 0;
+            }
+
+            std::vector<Pending> pending;
+            std::size_t active = 0;
+            std::chrono::steady_clock::time_point since;
+            std::vector<IoSlice> slices;
+            // Takes the gathered bytes instead of a blocking send_all (per-core mode queues them).
+            std::function<bool(ClientId, const IoSlice*, std::size_t)> sink;
+
+        private:
+            std::size_t slot(ClientId id, const std::shared_ptr<Socket>& socket) {
+                if (active == 0) since = std::chrono::steady_clock::now();
+                const std::size_t i = find(id);
+                if (i == active) {
+                    if (active == pending.size()) pending.emplace_back();
+                    pending[i].id = id;
+                    pending[i].socket = socket;
+                    ++active;
+                }
+                return i;
+            }
+
+            std::size_t find(ClientId id) const noexcept {
+                std::size_t i = 0;
+                while (i < active && pending[i].id != id) ++i;
+                return i;
+            }
+
+            bool flushAt(std::size_t i) {
+                const bool ok = write(pending[i]);
+                pending[i].socket.reset();
+                std::swap(pending[i], pending[--active]);
+                return ok;
+            }
+
+            bool write(Pending& p) {
+                p.data.slices(slices);
+                const bool ok = sink ? sink(p.id, slices.data(), slices.size())
+                                     : p.socket->send_all(slices.data(), slices.size()) == static_cast<std::ptrdiff_t>(p.data.size());
+                p.data.clear();
+                return ok;
+            }
+        };
+
+        struct CorkRef {
+            const TcpServer* server = nullptr;
+            WriteCork* cork = nullptr;
+        };
+
+        static CorkRef& currentCork() noexcept {
+            thread_local CorkRef ref;
+            return ref;
+        }
+
+        // The cork of the handler running on this thread, if it belongs to this server.
+        WriteCork* activeCork() const noexcept {
+            const auto& ref = currentCork();
+            return ref.server == this ? ref.cork : nullptr;
+        }
+
+        struct CorkScope {
+            CorkScope(const TcpServer* server, WriteCork* cork) : prev(currentCork()) {
+                if (cork) currentCork() = {server, cork};
+            }
+            ~CorkScope() { currentCork() = prev; }
+            CorkRef prev;
+        };
+
+        // Hands received bytes to on_message, frame by frame when a decoder is given.
+        // Returns false on a corrupt frame stream.
+        bool deliver(ClientId id, const std::shared_ptr<Socket>& client, FrameDecoder* decoder, MonotonicArena& arena,
+                     const char* data, std::size_t len) {
+            if (!on_message_) {
+                return true;
+            }
+            if (!decoder) {
+                ArenaScope scope(arena);
+                if (tap_) tap_(id, data, len);
+                on_message_(id, client, data, len);
+                return true;
+            }
+            return decoder->feed(data, len, [&](const char* frame, std::size_t n) {
+                ArenaScope scope(arena);
+                if (tap_) tap_(id, frame, n);
+                on_message_(id, client, frame, n);
+            });
+        }
 
         void handleClient(ClientId id, std::shared_ptr<Socket> client) {
-            // Raw chunked reads; your on_message can parse frames if you use them.
-            char buf[4096];
+            // Raw chunked reads, or whole frames when setFramed() is on.
+            HugePageBuffer buf(recv_buffer_size_);
+            MonotonicArena arena(arena_block_size_);
+            std::unique_ptr<FrameDecoder> decoder;
+            if (max_frame_) decoder = std::make_unique<FrameDecoder>(max_frame_);
+            WriteCork cork;
+            CorkScope cork_scope(this, coalesce_ ? &cork : nullptr);
             for (;;) {
-                auto r = client->receive(buf, sizeof(buf));
+                if (!cork.empty()) {
+                    // Keep gathering while more input shows up inside the window.
+                    const auto left = cork_window_ - std::chrono::duration_cast<std::chrono::microseconds>(
+                                                         std::chrono::steady_clock::now() - cork.since);
+                    if (left.count() <= 0 || !client->wait_readable(left)) cork.flush();
+                }
+                auto r = client->receive(buf.data(), buf.size());
                 if (r <= 0) break; // disconnect or error
-                if (on_message_) on_message_(id, client, buf, static_cast<std::size_t>(r));
+                if (!deliver(id, client, decoder.get(), arena, buf.bytes(), static_cast<std::size_t>(r))) break;
             }
+            cork.flush();
             if (on_disconnect_) on_disconnect_(id);
             {
                 std::lock_guard<std::mutex> lk(clients_mtx_);
@@ -231,6 +947,435 @@ namespace cpplib {
             }
         }
 
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+        static constexpr unsigned core_shift = 56;
+        static constexpr std::size_t max_cores = 256;
+
+        // Bytes a peer has not taken yet, written out as its socket turns writable.
+        struct Outbox {
+            std::deque<std::string> chunks;
+            std::size_t offset = 0;  // of chunks.front(), already sent
+            std::size_t bytes = 0;
+            int fd = -1;
+            bool closing = false;    // drop once drained
+            bool failed = false;     // drop pending; refuse further writes
+        };
+
+        struct CoreShard {
+            using Task = std::function<void()>;
+
+            CoreShard(std::size_t i, EventLoop& l, std::size_t cores)
+                : index(i), loop(l), inbox(new std::atomic<SpscQueue<Task>*>[cores]), num_inboxes(cores) {
+                for (std::size_t c = 0; c < cores; ++c) inbox[c].store(nullptr, std::memory_order_relaxed);
+                inbox_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                overflow.resize(cores);
+            }
+
+            ~CoreShard() {
+                for (std::size_t c = 0; c < num_inboxes; ++c) delete inbox[c].load(std::memory_order_acquire);
+                if (inbox_fd >= 0) ::close(inbox_fd);
+            }
+
+            // Created lazily by the (single) producing core so idle pairs cost nothing.
+            SpscQueue<Task>& inboxFrom(std::size_t core) {
+                auto* q = inbox[core].load(std::memory_order_acquire);
+                if (!q) {
+                    q = new SpscQueue<Task>(256);
+                    inbox[core].store(q, std::memory_order_release);
+                }
+                return *q;
+            }
+
+            void signal() {
+                if (!signalled.exchange(true)) {
+                    const std::uint64_t one = 1;
+                    [[maybe_unused]] auto r = ::write(inbox_fd, &one, sizeof(one));
+                }
+            }
+
+            std::size_t index;
+            EventLoop& loop;
+            Socket listener;
+            std::unordered_map<ClientId, std::shared_ptr<Socket>> clients;
+            std::mutex ids_mtx;
+            std::unordered_set<ClientId> ids;  // keys of `clients`, for clientIds()
+            ClientId next_local = 1;
+            std::atomic<std::size_t> num_clients{0};
+            std::unique_ptr<MonotonicArena> arena;
+            HugePageBuffer rx;
+            std::unique_ptr<std::atomic<SpscQueue<Task>*>[]> inbox;
+            std::size_t num_inboxes;
+            int inbox_fd = -1;
+            std::atomic<bool> signalled{false};
+            std::vector<std::deque<Task>> overflow;  // by destination core; this core only
+            bool overflow_armed = false;
+            std::unordered_map<ClientId, Outbox> outboxes;  // only for peers that fell behind
+            std::vector<IoSlice> out_slices;
+            WriteCork cork;
+            bool cork_armed = false;
+            std::unordered_map<ClientId, FrameDecoder> decoders;
+        };
+
+        struct CoreRef {
+            const TcpServer* server = nullptr;
+            std::size_t index = 0;
+        };
+
+        std::unique_ptr<EventLoopGroup> group_;
+        std::vector<std::unique_ptr<CoreShard>> shards_;
+
+        static CoreRef& currentCore() noexcept {
+            thread_local CoreRef ref;
+            return ref;
+        }
+
+        bool onCore(std::size_t core) const noexcept {
+            const auto self = currentCore();
+            return self.server == this && self.index == core && core < shards_.size();
+        }
+
+        // Runs fn(shard) inline when called on the owning core (returning its result),
+        // otherwise forwards it and reports whether the id maps to a live core.
+        template <typename F>
+        bool onOwningCore(ClientId id, F fn) {
+            const std::size_t core = coreOf(id);
+            if (core >= shards_.size()) {
+                return false;
+            }
+            CoreShard* sh = shards_[core].get();
+            const auto self = currentCore();
+            if (self.server == this && self.index == core) {
+                return fn(*sh);
+            }
+            return postToCore(core, [sh, fn = std::move(fn)]() mutable { fn(*sh); });
+        }
+
+        // Moves tasks that found a full inbox over, oldest first, and retries shortly for
+        // whatever still does not fit. Runs on the sending core.
+        void drainOverflow(CoreShard& src) {
+            bool left = false;
+            for (std::size_t core = 0; core < src.overflow.size(); ++core) {
+                auto& backlog = src.overflow[core];
+                if (backlog.empty()) continue;
+                CoreShard& target = *shards_[core];
+                auto& inbox = target.inboxFrom(src.index);
+                bool moved = false;
+                while (!backlog.empty() && inbox.try_emplace(std::move(backlog.front()))) {
+                    backlog.pop_front();
+                    moved = true;
+                }
+                if (moved) target.signal();
+                left = left || !backlog.empty();
+            }
+            if (left && !src.overflow_armed) {
+                src.overflow_armed = true;
+                src.loop.runAfter(std::chrono::microseconds(50), [this, &src] {
+                    src.overflow_armed = false;
+                    drainOverflow(src);
+                });
+            }
+        }
+
+        void drainInbox(CoreShard& sh) {
+            std::uint64_t v;
+            while (::read(sh.inbox_fd, &v, sizeof(v)) > 0) {}
+            sh.signalled.store(false);
+            for (std::size_t c = 0; c < sh.num_inboxes; ++c) {
+                auto* q = sh.inbox[c].load(std::memory_order_acquire);
+                if (!q) continue;
+                while (auto task = q->try_pop()) (*task)();
+            }
+        }
+
+        void acceptOnCore(CoreShard& sh) {
+            for (;;) {
+                auto client = sh.listener.accept();
+                if (!client) {
+                    return;
+                }
+                client->set_nonblocking(true);
+                if (accept_handler_) {
+                    accept_handler_(std::move(client));
+                    continue;
+                }
+                const std::size_t target = steer_ ? steerTarget(sh, *client) : sh.index;
+                if (target == sh.index) {
+                    adoptOnCore(sh, std::move(client));
+                } else {
+                    CoreShard* dest = shards_[target].get();
+                    postToCore(target, [this, dest, client] { adoptOnCore(*dest, client); });
+                }
+            }
+        }
+
+        std::size_t steerTarget(const CoreShard& sh, const Socket& client) {
+            const int cpu = client.incoming_cpu();
+            if (cpu >= 0) {
+                if (group_->cpuOf(sh.index) == cpu) {
+                    steer_local_.fetch_add(1, std::memory_order_relaxed);
+                    return sh.index;
+                }
+                // Several cores may share a CPU when oversubscribed; take the least loaded.
+                std::size_t best = shards_.size();
+                for (std::size_t i = 0; i < shards_.size(); ++i) {
+                    if (group_->cpuOf(i) == cpu && (best == shards_.size() || coreLoad(i) < coreLoad(best))) best = i;
+                }
+                if (best != shards_.size()) {
+                    steer_moved_.fetch_add(1, std::memory_order_relaxed);
+                    return best;
+                }
+            }
+            steer_fallback_.fetch_add(1, std::memory_order_relaxed);
+            std::size_t best = sh.index;
+            for (std::size_t i = 0; i < shards_.size(); ++i) {
+                if (coreLoad(i) < coreLoad(best)) best = i;
+            }
+            return best;
+        }
+
+        std::size_t coreLoad(std::size_t core) const noexcept {
+            return shards_[core]->num_clients.load(std::memory_order_relaxed);
+        }
+
+        void adoptOnCore(CoreShard& sh, std::shared_ptr<Socket> client) {
+            const ClientId id = (static_cast<ClientId>(sh.index) << core_shift) | sh.next_local++;
+            const int fd = client->native_handle();
+            sh.clients.emplace(id, client);
+            {
+                std::lock_guard<std::mutex> lk(sh.ids_mtx);
+                sh.ids.insert(id);
+            }
+            sh.num_clients.fetch_add(1, std::memory_order_relaxed);
+            if (on_connect_) on_connect_(id, client);
+            sh.loop.add(fd, EventLoop::READABLE | EventLoop::HANGUP, [this, &sh, id, fd, client](std::uint32_t events) {
+                if (events & EventLoop::WRITABLE) flushOutbox(sh, id);
+                if (!(events & ~EventLoop::WRITABLE)) return;
+                auto ob = sh.outboxes.find(id);
+                if (ob != sh.outboxes.end() && ob->second.closing) {
+                    dropOnCore(sh, id, fd);  // hung up before taking the rest
+                } else if (sh.clients.count(id)) {
+                    readOnCore(sh, id, fd, client);
+                }
+            });
+        }
+
+        void readOnCore(CoreShard& sh, ClientId id, int fd, const std::shared_ptr<Socket>& client) {
+            bool open;
+            {
+                CorkScope cork_scope(this, coalesce_ ? &sh.cork : nullptr);
+                open = readBatchOnCore(sh, id, client);
+            }
+            if (!sh.cork.empty()) {
+                if (cork_window_.count() <= 0) {
+                    sh.cork.flush();
+                } else if (!sh.cork_armed) {
+                    // Everything corked on this core goes out together when the window closes.
+                    sh.cork_armed = true;
+                    sh.loop.runAfter(cork_window_, [&sh] {
+                        sh.cork_armed = false;
+                        sh.cork.flush();
+                    });
+                }
+            }
+            if (!open) dropOnCore(sh, id, fd);
+        }
+
+        // Returns false once the connection should be dropped.
+        bool readBatchOnCore(CoreShard& sh, ClientId id, const std::shared_ptr<Socket>& client) {
+            // Bounded so one busy connection cannot starve the rest of the core; the fd is
+            // level-triggered and will be reported again.
+            for (int i = 0; i < 16; ++i) {
+                auto r = client->receive(sh.rx.data(), sh.rx.size());
+                if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    return true;
+                }
+                if (r == 0) {
+                    closeOnCore(sh, id);  // what is queued for the peer still goes out
+                    return true;
+                }
+                if (r < 0) {
+                    return false;
+                }
+                FrameDecoder* decoder = nullptr;
+                if (max_frame_) decoder = &sh.decoders.try_emplace(id, max_frame_).first->second;
+                if (!deliver(id, client, decoder, *sh.arena, sh.rx.bytes(), static_cast<std::size_t>(r))) {
+                    return false;  // corrupt frame stream
+                }
+                if (!client->valid() || !sh.clients.count(id)) {
+                    return false;  // closed by the handler
+                }
+                if (closingOnCore(sh, id)) {
+                    return true;  // closeClient() from the handler; draining
+                }
+            }
+            return true;  // read budget spent; still readable, so we will be called again
+        }
+
+        bool writeOnCore(CoreShard& sh, ClientId id, const void* data, std::size_t len) {
+            // Whatever is corked for the connection was sent first.
+            if (!sh.cork.empty() && !sh.cork.flush(id)) return false;
+            const IoSlice part{data, len};
+            return queueOnCore(sh, id, &part, 1);
+        }
+
+        // Writes what the socket takes now and queues the rest behind anything already
+        // queued; the fd then also waits for EPOLLOUT. Never blocks.
+        bool queueOnCore(CoreShard& sh, ClientId id, const IoSlice* parts, std::size_t count) {
+            auto it = sh.clients.find(id);
+            if (it == sh.clients.end()) return false;
+            std::size_t total = 0;
+            for (std::size_t i = 0; i < count; ++i) total += parts[i].size;
+            auto ob = sh.outboxes.find(id);
+            std::size_t sent = 0;
+            if (ob == sh.outboxes.end()) {
+                if (total == 0) return true;
+                const auto r = it->second->send_some(parts, count);
+                if (r == static_cast<std::ptrdiff_t>(total)) return true;
+                if (r < 0 && r != Socket::would_block) {
+                    failOnCore(sh, id, it->second);
+                    return false;
+                }
+                sent = r > 0 ? static_cast<std::size_t>(r) : 0;
+                ob = sh.outboxes.emplace(id, Outbox{}).first;
+                ob->second.fd = it->second->native_handle();
+                sh.loop.modify(ob->second.fd, EventLoop::READABLE | EventLoop::HANGUP | EventLoop::WRITABLE);
+            }
+            Outbox& o = ob->second;
+            if (o.failed || o.closing) return false;
+            if (o.bytes + (total - sent) > outbound_limit_) {
+                failOnCore(sh, id, it->second);
+                return false;
+            }
+            std::string chunk;
+            chunk.reserve(total - sent);
+            for (std::size_t i = 0; i < count; ++i) {
+                const std::size_t skip = std::min(sent, parts[i].size);
+                sent -= skip;
+                chunk.append(static_cast<const char*>(parts[i].data) + skip, parts[i].size - skip);
+            }
+            o.bytes += chunk.size();
+            if (!chunk.empty()) o.chunks.push_back(std::move(chunk));
+            return true;
+        }
+
+        // EPOLLOUT: writes queued bytes until the socket is full again. Once empty the fd
+        // goes back to read interest, or the connection is dropped if it was closing.
+        void flushOutbox(CoreShard& sh, ClientId id) {
+            auto ob = sh.outboxes.find(id);
+            auto it = sh.clients.find(id);
+            if (ob == sh.outboxes.end() || it == sh.clients.end() || ob->second.failed) return;
+            Outbox& o = ob->second;
+            while (!o.chunks.empty()) {
+                sh.out_slices.clear();
+                for (std::size_t i = 0; i < o.chunks.size() && i < 64; ++i) {
+                    const std::size_t skip = i == 0 ? o.offset : 0;
+                    sh.out_slices.push_back(IoSlice{o.chunks[i].data() + skip, o.chunks[i].size() - skip});
+                }
+                const auto r = it->second->send_some(sh.out_slices.data(), sh.out_slices.size());
+                if (r == Socket::would_block || r == 0) return;
+                if (r < 0) {
+                    failOnCore(sh, id, it->second);
+                    return;
+                }
+                auto left = static_cast<std::size_t>(r);
+                o.bytes -= left;
+                while (left > 0) {
+                    const std::size_t rest = o.chunks.front().size() - o.offset;
+                    if (left < rest) {
+                        o.offset += left;
+                        break;
+                    }
+                    left -= rest;
+                    o.chunks.pop_front();
+                    o.offset = 0;
+                }
+            }
+            const bool closing = o.closing;
+            const int fd = o.fd;
+            sh.outboxes.erase(ob);
+            if (closing) {
+                dropOnCore(sh, id, fd);
+            } else {
+                sh.loop.modify(fd, EventLoop::READABLE | EventLoop::HANGUP);
+            }
+        }
+
+        // A write failed or the peer fell past the outbound limit. The drop is posted rather
+        // than done here: this can run inside a cork flush or a handler still using the client.
+        void failOnCore(CoreShard& sh, ClientId id, const std::shared_ptr<Socket>& client) {
+            Outbox& o = sh.outboxes[id];
+            if (o.failed) return;
+            o.failed = true;
+            o.chunks.clear();
+            o.bytes = 0;
+            client->shutdown();
+            sh.loop.post([this, &sh, id] { dropOnCore(sh, id); });
+        }
+
+        bool closingOnCore(const CoreShard& sh, ClientId id) const {
+            auto ob = sh.outboxes.find(id);
+            return ob != sh.outboxes.end() && ob->second.closing;
+        }
+
+        // Graceful close: corked and queued bytes go out first, reads stop meanwhile.
+        bool closeOnCore(CoreShard& sh, ClientId id) {
+            if (!sh.clients.count(id)) return false;
+            sh.cork.flush(id);
+            auto ob = sh.outboxes.find(id);
+            if (ob == sh.outboxes.end() || ob->second.failed) return dropOnCore(sh, id);
+            ob->second.closing = true;
+            sh.loop.modify(ob->second.fd, EventLoop::WRITABLE);
+            return true;
+        }
+
+        bool dropOnCore(CoreShard& sh, ClientId id, int fd = -1) {
+            auto it = sh.clients.find(id);
+            if (it == sh.clients.end()) {
+                if (fd >= 0) sh.loop.remove(fd);
+                return false;
+            }
+            sh.cork.flush(id);  // best effort; the outbox goes with the connection
+            sh.outboxes.erase(id);
+            sh.decoders.erase(id);
+            auto client = std::move(it->second);
+            sh.clients.erase(it);
+            {
+                std::lock_guard<std::mutex> lk(sh.ids_mtx);
+                sh.ids.erase(id);
+            }
+            sh.num_clients.fetch_sub(1, std::memory_order_relaxed);
+            // A handler that closed the socket itself leaves native_handle() invalid, so the
+            // read path passes the fd it registered.
+            sh.loop.remove(fd >= 0 ? fd : client->native_handle());
+            client->shutdown();
+            client->close();
+            if (on_disconnect_) on_disconnect_(id);
+            return true;
+        }
+#endif
+
+        void reject(const std::shared_ptr<Socket>& client) {
+            if (on_reject_) on_reject_(client);
+            client->shutdown();
+            client->close();
+        }
+
+        void handOver(std::shared_ptr<Socket> client) {
+            if (!pool_) {
+                accept_handler_(std::move(client));
+            } else if (admission_) {
+                pool_->enqueue([this, client, queued = CoDel::clock::now()] {
+                    if (admission_->onDequeue(CoDel::clock::now() - queued)) {
+                        accept_handler_(client);
+                    } else {
+                        reject(client);
+                    }
+                });
+            } else {
+                pool_->enqueue([this, client] { accept_handler_(client); });
+            }
+        }
+
         void acceptLoop() {
             while (running_.load()) {
                 auto client = listener_.accept();
@@ -238,6 +1383,14 @@ namespace cpplib {
                     std::this_thread::sleep_for(std::chrono::milliseconds(2));
                     continue;
                 }
+                if (admission_ && pool_ && !admission_->admit()) {
+                    reject(client);
+                    continue;
+                }
+                if (accept_handler_) {
+                    handOver(std::move(client));
+                    continue;
+                }
 
                 // Assign ID and store
                 ClientId id = next_id_.fetch_add(1, std::memory_order_relaxed);
@@ -248,7 +1401,20 @@ namespace cpplib {
 
                 if (on_connect_) on_connect_(id, client);
 
-                if (pool_) {
+                if (pool_ && admission_) {
+                    pool_->enqueue([this, id, client, queued = CoDel::clock::now()] {
+                        if (admission_->onDequeue(CoDel::clock::now() - queued)) {
+                            handleClient(id, client);
+                            return;
+                        }
+                        {
+                            std::lock_guard<std::mutex> lk(clients_mtx_);
+                            clients_.erase(id);
+                        }
+                        reject(client);
+                        if (on_disconnect_) on_disconnect_(id);
+                    });
+                } else if (pool_) {
                     pool_->enqueue([this, id, client]{ handleClient(id, client); });
                 } else {
                     // Fallback: handle inline (not recommended for production)
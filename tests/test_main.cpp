@@ -1,4 +1,24 @@
+#include "../arena.h"
+#include "../async_socket.h"
+#include "../bytebuffer.h"
+#include "../cache.h"
+#include "../capture.h"
+#include "../codel.h"
+#include "../crc32c.h"
+#include "../duplex_client.h"
+#include "../event_loop.h"
+#include "../hedged_client.h"
+#include "../http.h"
+#include "../hugepage.h"
+#include "../lz.h"
+#include "../parallel.h"
+#include "../prewarm.h"
+#include "../proxy.h"
+#include "../schema.h"
+#include "../singleflight.h"
+#include "../logger.h"
 #include "../timer.h"
+#include "../websocket.h"
 #include "../config.h"
 #include "../ini.h"
 #include "../tcp.h"
@@ -7,9 +27,14 @@
 #include <filesystem>
 #include <fstream>
 #include <future>
+#include <map>
 #include <iostream>
 #include <memory>
+#include <memory_resource>
+#include <numeric>
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace {
     int failures = 0;
@@ -69,6 +94,123 @@ namespace {
         expect(config.get<bool>("feature", "enabled").value_or(false), "JSON bool retrieval");
     }
 
+    void test_monotonic_arena() {
+        cpplib::MonotonicArena arena(1024);
+        {
+            std::pmr::vector<int> values(&arena);
+            for (int i = 0; i < 100; ++i) values.push_back(i);
+            expect(values[99] == 99, "Arena-backed vector holds values");
+        }
+        expect(arena.bytesAllocated() > 0, "Arena tracks bumped bytes");
+        void* big = arena.allocate(8192, 64);
+        expect(reinterpret_cast<std::uintptr_t>(big) % 64 == 0, "Arena honours alignment for oversized blocks");
+        arena.reset();
+        expect(arena.bytesAllocated() == 0, "Arena reset rewinds");
+        void* a = arena.allocate(16, 8);
+        void* b = arena.allocate(16, 8);
+        expect(static_cast<char*>(b) - static_cast<char*>(a) == 16, "Arena allocations are a pointer bump");
+    }
+
+    void test_message_arena_in_handler() {
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Arena server listens");
+        std::promise<bool> scoped;
+        std::atomic<bool> once{false};
+        server.start(1, [&](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket> client, const char* data, std::size_t len) {
+            const std::pmr::string payload(data, len, cpplib::TcpServer::messageArena());
+            client->send_all(payload.data(), payload.size());
+            if (!once.exchange(true)) scoped.set_value(cpplib::TcpServer::messageArena() != std::pmr::get_default_resource());
+        });
+        cpplib::TcpClient client;
+        expect(client.connect("127.0.0.1", server.port()) && client.send("arena"), "Arena client sends");
+        expect(client.receive(5) == "arena", "Arena-backed payload echoes");
+        auto f = scoped.get_future();
+        expect(f.wait_for(std::chrono::seconds(1)) == std::future_status::ready && f.get(), "Handlers run inside a message arena");
+        expect(cpplib::TcpServer::messageArena() == std::pmr::get_default_resource(), "Outside a handler the default resource is used");
+        server.stop();
+    }
+
+    void test_hugepage_buffer_and_buffered_logger() {
+        cpplib::HugePageBuffer small(1024);
+        expect(small.backing() == cpplib::HugePageBuffer::Backing::HEAP, "Small buffers stay on the heap");
+        cpplib::HugePageBuffer ring(3 * 1024 * 1024);
+        expect(ring.backing() == cpplib::HugePageBuffer::Backing::HUGE_PAGES ||
+               ring.backing() == cpplib::HugePageBuffer::Backing::PAGES, "Large buffers are page mapped");
+        ring.bytes()[ring.size() - 1] = 'x';
+        expect(ring.bytes()[ring.size() - 1] == 'x', "Large buffer is writable to the end");
+
+        const auto log_path = std::filesystem::temp_directory_path() / "cpplib_buffered.log";
+        std::filesystem::remove(log_path);
+        {
+            cpplib::Logger logger(cpplib::LogLevel::INFO, cpplib::OutputTarget::FILE, log_path.string());
+            expect(logger.setFileBuffer(4 * 1024 * 1024), "Logger switches to buffered file output");
+            logger.info("buffered line");
+        }
+        std::ifstream in(log_path);
+        std::string line;
+        std::getline(in, line);
+        expect(line.find("buffered line") != std::string::npos, "Buffered logger flushes on destruction");
+    }
+
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+    void test_event_loop() {
+        cpplib::EventLoopGroup group(1, false);
+        auto& loop = group.at(0);
+        int fds[2];
+        expect(::pipe(fds) == 0, "Pipe for loop readiness");
+        std::promise<std::string> io_seen;
+        expect(loop.add(fds[0], cpplib::EventLoop::READABLE, [&](std::uint32_t) {
+            char c[8];
+            auto n = ::read(fds[0], c, sizeof(c));
+            loop.remove(fds[0]);
+            io_seen.set_value(std::string(c, n > 0 ? static_cast<std::size_t>(n) : 0));
+        }), "Loop registers fd");
+        group.start();
+
+        std::promise<bool> posted;
+        std::thread([&] { loop.post([&] { posted.set_value(loop.inLoopThread()); }); }).join();
+        expect(posted.get_future().get(), "post() runs on the loop thread");
+
+        std::promise<void> fired;
+        cpplib::Stopwatch watch;
+        loop.runAfter(std::chrono::milliseconds(5), [&] { fired.set_value(); });
+        auto cancelled = loop.runAfter(std::chrono::milliseconds(1), [] { std::abort(); });
+        loop.cancel(cancelled);
+        fired.get_future().wait();
+        expect(watch.elapsed<std::chrono::microseconds>().count() >= 5000, "Timer fires after its delay");
+
+        expect(::write(fds[1], "hi", 2) == 2, "Write to pipe");
+        expect(io_seen.get_future().get() == "hi", "Readiness dispatches on the loop");
+        group.stop();
+        ::close(fds[0]);
+        ::close(fds[1]);
+
+        // Two readable fds in one batch; whichever runs first closes the other and reuses
+        // its number for a fresh, idle pipe. The stale event must not reach the new handler.
+        cpplib::EventLoop reuse;
+        int a[2], b[2], fresh[2] = {-1, -1};
+        expect(::pipe(a) == 0 && ::pipe(b) == 0, "Pipes for fd reuse");
+        bool swapped = false, stale = false;
+        auto on_ready = [&](int self, int other) {
+            return [&, self, other](std::uint32_t) {
+                char c;
+                if (::read(self, &c, 1) != 1 || swapped) return;
+                swapped = true;
+                reuse.remove(other);
+                ::close(other);
+                expect(::pipe(fresh) == 0 && fresh[0] == other, "Closed fd number is reused");
+                reuse.add(fresh[0], cpplib::EventLoop::READABLE, [&](std::uint32_t) { stale = true; });
+            };
+        };
+        reuse.add(a[0], cpplib::EventLoop::READABLE, on_ready(a[0], b[0]));
+        reuse.add(b[0], cpplib::EventLoop::READABLE, on_ready(b[0], a[0]));
+        expect(::write(a[1], "x", 1) == 1 && ::write(b[1], "y", 1) == 1, "Both pipes readable");
+        reuse.runOnce(100);
+        expect(swapped && !stale, "A stale event is not delivered to a reused fd's new handler");
+        for (int fd : {a[0], a[1], b[0], b[1], fresh[1]}) ::close(fd);
+    }
+#endif
+
     void test_tcp_server_client_roundtrip() {
         cpplib::TcpServer server;
         expect(server.bind(0), "Server binds to ephemeral port");
@@ -114,12 +256,1330 @@ namespace {
         server.stop();
         expect(!server.isRunning(), "Server stops cleanly");
     }
+
+    void test_lz_and_compressed_frames() {
+        std::string payload;
+        for (int i = 0; i < 200; ++i) payload += "{\"id\":" + std::to_string(i) + ",\"status\":\"ok\",\"region\":\"eu-west\"}\n";
+        const auto packed = cpplib::lz::compress(payload.data(), payload.size());
+        expect(packed.size() < payload.size() / 2, "lz compresses repetitive payloads");
+        std::string unpacked(payload.size(), '\0');
+        expect(cpplib::lz::decompress(packed.data(), packed.size(), unpacked.data(), unpacked.size()) ==
+               static_cast<std::ptrdiff_t>(payload.size()) && unpacked == payload, "lz round trip");
+        expect(cpplib::lz::decompress(packed.data(), packed.size() / 2, unpacked.data(), unpacked.size()) < 0,
+               "lz rejects truncated input");
+
+        std::string wire;
+        cpplib::frame::append(wire, payload.data(), static_cast<std::uint32_t>(payload.size()), 256);
+        cpplib::frame::append(wire, "tiny", 4, 256);
+        expect(wire.size() < payload.size(), "Large frame is sent compressed");
+        cpplib::FrameDecoder decoder;
+        std::vector<std::string> frames;
+        for (std::size_t i = 0; i < wire.size(); i += 7) {
+            decoder.feed(wire.data() + i, std::min<std::size_t>(7, wire.size() - i),
+                         [&](const char* data, std::size_t len) { frames.emplace_back(data, len); });
+        }
+        expect(frames.size() == 2 && frames[0] == payload && frames[1] == "tiny", "FrameDecoder reassembles split frames");
+
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Compression test server listens");
+        server.start(1, [](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket> client, const char* data, std::size_t len) {
+            client->send_all(data, len);
+        });
+        cpplib::TcpClient client;
+        client.setCompression(256);
+        std::string echoed;
+        expect(client.connect("127.0.0.1", server.port()) && client.sendFrame(payload) &&
+               client.recvFrame(echoed, 1000) && echoed == payload, "Compressed frame round trip over TCP");
+        server.stop();
+
+        const auto log_path = std::filesystem::temp_directory_path() / "cpplib_rotating.log";
+        const std::string rotated = log_path.string() + ".1.lz";
+        std::filesystem::remove(log_path);
+        std::filesystem::remove(rotated);
+        {
+            cpplib::Logger logger(cpplib::LogLevel::INFO, cpplib::OutputTarget::FILE, log_path.string());
+            logger.setRotation(4096, 2, true);
+            for (int i = 0; i < 100; ++i) logger.info("request served in 12ms status=200 path=/api/items");
+        }
+        std::ifstream in(rotated, std::ios::binary);
+        std::string encoded((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::string decoded;
+        cpplib::lz::StreamDecompressor stream;
+        expect(!encoded.empty() && stream.feed(encoded.data(), encoded.size(), decoded) &&
+               decoded.find("status=200") != std::string::npos, "Rotated log is stored compressed");
+
+        // A directory in the way of <file>.1.lz makes every compression fail; the rotated
+        // file stays plain and the live one still starts over.
+        const std::string plain = log_path.string() + ".1";
+        std::filesystem::remove(log_path);
+        std::filesystem::remove(plain);
+        std::filesystem::remove(rotated);
+        std::filesystem::create_directories(rotated + "/blocker");
+        {
+            cpplib::Logger logger(cpplib::LogLevel::INFO, cpplib::OutputTarget::FILE, log_path.string());
+            logger.setRotation(4096, 1, true);
+            for (int i = 0; i < 200; ++i) logger.info("request served in 12ms status=200 path=/api/items");
+        }
+        expect(std::filesystem::file_size(log_path) < 4096 && std::filesystem::file_size(plain) >= 4096,
+               "Failed compression falls back to a plain rotated file");
+        std::filesystem::remove_all(rotated);
+        std::filesystem::remove(plain);
+    }
+
+    void test_crc32c_frames() {
+        expect(cpplib::crc32c("123456789", 9) == 0xE3069283u, "CRC-32C check value");
+        std::string payload(100000, '\0');
+        for (std::size_t i = 0; i < payload.size(); ++i) payload[i] = static_cast<char>((i * 131) ^ (i >> 7));
+        expect(cpplib::crc32c(payload.data() + 3000, payload.size() - 3000, cpplib::crc32c(payload.data(), 3000)) ==
+               cpplib::crc32c(payload.data(), payload.size()), "CRC-32C extends across calls");
+        std::string copy(payload.size(), '\0');
+        expect(cpplib::crc32cCopy(&copy[0], payload.data(), payload.size()) == cpplib::crc32c(payload.data(), payload.size()) &&
+               copy == payload, "Fused copy and CRC-32C");
+
+        std::string wire;
+        cpplib::frame::append(wire, payload.data(), static_cast<std::uint32_t>(payload.size()), 256, true);
+        cpplib::frame::append(wire, "tiny", 4, 0, true);
+        std::vector<std::string> frames;
+        cpplib::FrameDecoder decoder;
+        const auto collect = [&](const char* data, std::size_t len) { frames.emplace_back(data, len); };
+        expect(decoder.feed(wire.data(), wire.size(), collect) && frames.size() == 2 && frames[0] == payload &&
+               frames[1] == "tiny", "FrameDecoder verifies checksummed frames");
+        wire[wire.size() - 1] ^= 0x20;
+        decoder.reset();
+        expect(!decoder.feed(wire.data(), wire.size(), collect), "FrameDecoder rejects a corrupted frame");
+
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Checksum test server listens");
+        server.start(1, [](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket> client, const char* data, std::size_t len) {
+            client->send_all(data, len);
+        });
+        cpplib::TcpClient client;
+        client.setChecksum(true);
+        std::string echoed;
+        expect(client.connect("127.0.0.1", server.port()) && client.sendFrame(payload) &&
+               client.recvFrame(echoed, 1000) && echoed == payload, "Checksummed frame round trip over TCP");
+        expect(client.send(wire.substr(wire.size() - 12)) && !client.recvFrame(echoed, 1000),
+               "recvFrame rejects a corrupted frame");
+        server.stop();
+    }
+
+    void test_bytebuffer_and_segmented_frames() {
+        cpplib::ByteBuffer buf(16);
+        const auto length = buf.skip<std::uint32_t>();
+        buf.putBe<std::uint16_t>(0xBEEF);
+        buf.putLe<std::uint32_t>(0x01020304u);
+        buf.putVarint(300);
+        buf.putVarintSigned(-2);
+        buf.write(std::string(100, 'x'));
+        buf.backfillBe<std::uint32_t>(length, static_cast<std::uint32_t>(buf.size() - 4));
+        expect(static_cast<unsigned char>(buf.data()[6]) == 0x04 && static_cast<unsigned char>(buf.data()[10]) == 0xAC,
+               "ByteBuffer encodes byte order and varints");
+        bool decoded = buf.getBe<std::uint32_t>() == buf.size() && buf.getBe<std::uint16_t>() == 0xBEEF &&
+                       buf.getLe<std::uint32_t>() == 0x01020304u && buf.getVarint() == 300 &&
+                       buf.getVarintSigned() == -2 && buf.readString(100) == std::string(100, 'x') && buf.empty();
+        expect(decoded, "ByteBuffer reads back what it wrote");
+        bool threw = false;
+        try {
+            buf.getBe<std::uint32_t>();
+        } catch (const std::out_of_range&) {
+            threw = true;
+        }
+        expect(threw, "ByteBuffer throws on underflow");
+
+        auto big = std::make_shared<const std::string>(200000, 'z');
+        cpplib::SegmentedBuffer msg;
+        msg.putBe<std::uint32_t>(7);
+        msg.append("head:", 5);
+        msg.appendRef(big);
+        msg.append(":tail", 5);
+        std::string flat;
+        msg.copyTo(flat);
+        expect(msg.segmentCount() == 3 && flat.size() == msg.size() && flat.compare(9, 5, "zzzzz") == 0,
+               "SegmentedBuffer references large pieces in place");
+
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Segmented frame server listens");
+        server.start(1, [](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket> client, const char* data, std::size_t len) {
+            client->send_all(data, len);
+        });
+        cpplib::TcpClient client;
+        client.setChecksum(true);
+        std::string echoed;
+        expect(client.connect("127.0.0.1", server.port()) && client.sendFrame(msg) && client.recvFrame(echoed, 1000) &&
+               echoed == flat, "Segmented frame is sent with one gathered write");
+        server.stop();
+    }
+
+    void test_codel_admission() {
+        using ms = std::chrono::milliseconds;
+        cpplib::CoDel::Options options;
+        options.target = std::chrono::microseconds(5000);
+        options.interval = std::chrono::microseconds(100000);
+        cpplib::CoDel codel(options);
+        const auto t0 = cpplib::CoDel::clock::now();
+        expect(codel.admit(t0) && codel.admit(t0) && codel.admit(t0), "CoDel admits while idle");
+        expect(codel.onDequeue(ms(10), t0 + ms(10)), "One slow sojourn is tolerated");
+        expect(!codel.onDequeue(ms(10), t0 + ms(150)) && codel.overloaded(), "A standing queue sheds work");
+        expect(!codel.admit(t0 + ms(150)), "Overload refuses new work");
+        expect(codel.onDequeue(ms(1), t0 + ms(160)) && !codel.overloaded() && codel.admit(t0 + ms(170)),
+               "A short sojourn ends the episode");
+
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(64), "Admission test server listens");
+        cpplib::CoDel::Options tight;
+        tight.target = std::chrono::microseconds(2000);
+        tight.interval = std::chrono::microseconds(20000);
+        server.setAdmissionControl(tight, [](std::shared_ptr<cpplib::Socket> s) { s->send_all("busy", 4); });
+        server.start(1, [](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket> client, const char* data, std::size_t len) {
+            client->send_all(data, len);
+        });
+        cpplib::TcpClient busy_worker;
+        expect(busy_worker.connect("127.0.0.1", server.port()) && busy_worker.send("a") && busy_worker.receive(1) == "a",
+               "First connection occupies the only worker");
+        std::vector<std::unique_ptr<cpplib::TcpClient>> waiting;
+        for (int i = 0; i < 8; ++i) {
+            waiting.push_back(std::make_unique<cpplib::TcpClient>());
+            waiting.back()->connect("127.0.0.1", server.port(), 1000);
+            std::this_thread::sleep_for(ms(10));
+        }
+        expect(waiting.back()->receive(4) == "busy" && server.admissionStats().rejected > 0,
+               "Stalled queue fails new connections fast");
+        busy_worker.close();
+        for (auto& c : waiting) c->close();
+        std::this_thread::sleep_for(ms(50));
+        cpplib::TcpClient later;
+        expect(later.connect("127.0.0.1", server.port()) && later.send("ok") && later.receive(2) == "ok",
+               "Admission recovers once the queue drains");
+        server.stop();
+    }
+
+    void test_singleflight_framed_server() {
+        cpplib::SingleFlight flight;
+        std::atomic<int> executions{0};
+        std::promise<void> release;
+        auto gate = release.get_future().share();
+        auto slow = [&] {
+            ++executions;
+            gate.wait();
+            return std::string("result");
+        };
+        std::vector<std::future<cpplib::SingleFlight::Result>> waiters;
+        for (int i = 0; i < 4; ++i) {
+            waiters.push_back(std::async(std::launch::async, [&] { return flight.run("key", slow); }));
+        }
+        while (flight.stats().calls < 4) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        release.set_value();
+        std::vector<cpplib::SingleFlight::Result> results;
+        for (auto& w : waiters) results.push_back(w.get());
+        bool same = true;
+        for (auto& r : results) same = same && r == results[0] && *r == "result";
+        expect(executions == 1 && same && flight.stats().coalesced == 3, "Concurrent callers share one execution");
+        expect(*flight.run("key", [] { return std::string("fresh"); }) == "fresh", "Finished calls are not cached");
+
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Framed server listens");
+        server.setFramed();
+        server.start(2, [&](cpplib::TcpServer::ClientId id, std::shared_ptr<cpplib::Socket>, const char* data, std::size_t len) {
+            const std::string key(data, len);
+            flight.run(key, [key] { return "re:" + key; },
+                       [&server, id](cpplib::SingleFlight::Result r) { if (r) server.sendFrameTo(id, *r); });
+        });
+        cpplib::TcpClient client;
+        std::string first, second;
+        expect(client.connect("127.0.0.1", server.port()) && client.sendFrame("one") && client.sendFrame("two") &&
+               client.recvFrame(first, 1000) && client.recvFrame(second, 1000) && first == "re:one" && second == "re:two",
+               "Framed server delivers whole frames and replies with frames");
+        server.stop();
+    }
+
+    void test_tcp_fast_open() {
+        cpplib::TcpServer server;
+        expect(server.setFastOpen(16), "Fast Open queue is accepted before listening");
+        expect(server.bind(0) && server.listen(), "Fast Open server listens");
+        server.setFramed();
+        server.start(1, [&](cpplib::TcpServer::ClientId id, std::shared_ptr<cpplib::Socket>, const char* data, std::size_t len) {
+            server.sendFrameTo(id, "ack:" + std::string(data, len));
+        });
+        // The first connection fetches a cookie (if the kernel allows TFO at all); the
+        // second may then carry its frame in the SYN. Both must behave like plain TCP.
+        for (int i = 0; i < 2; ++i) {
+            cpplib::TcpClient client;
+            client.setFastOpen(true);
+            std::string reply;
+            expect(client.connect("127.0.0.1", server.port()) && client.sendFrame("hello") &&
+                   client.recvFrame(reply, 1000) && reply == "ack:hello",
+                   "Fast Open client round-trips its first frame");
+        }
+        const auto port = server.port();
+        server.stop();
+
+        cpplib::TcpClient refused;
+        refused.setFastOpen(true);
+        std::string reply;
+        expect(!(refused.connect("127.0.0.1", port) && refused.sendFrame("x") && refused.recvFrame(reply, 200)),
+               "Fast Open client reports a refused connection");
+    }
+
+    void test_busy_poll_client() {
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Busy-poll echo server listens");
+        server.setFramed();
+        server.start(1, [&](cpplib::TcpServer::ClientId id, std::shared_ptr<cpplib::Socket>, const char* data, std::size_t len) {
+            server.sendFrameTo(id, data, len);
+        });
+        cpplib::TcpClient client;
+        client.setBusyPoll(std::chrono::microseconds(200), 50);
+        expect(client.connect("127.0.0.1", server.port()), "Busy-poll client connects");
+        char byte;
+        expect(client.socket().receive_nowait(&byte, 1) == cpplib::Socket::would_block, "Non-blocking receive reports an empty socket");
+        bool echoed = true;
+        for (int i = 0; i < 50 && echoed; ++i) {
+            std::string reply;
+            const std::string msg = "msg" + std::to_string(i);
+            echoed = client.sendFrame(msg) && client.recvFrame(reply, 1000) && reply == msg;
+        }
+        expect(echoed, "Busy-poll client receives every reply");
+        std::string none;
+        expect(!client.recvFrame(none, 20), "Busy-poll receive still times out when nothing arrives");
+        server.stop();
+    }
+
+    void test_duplex_client() {
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Duplex echo server listens");
+        server.setFramed();
+        server.start(1, [&](cpplib::TcpServer::ClientId id, std::shared_ptr<cpplib::Socket>, const char* data, std::size_t len) {
+            server.sendFrameTo(id, data, len);
+        });
+        cpplib::DuplexClient client;
+        client.setChecksum(true);
+        expect(client.connect("127.0.0.1", server.port()), "Duplex client connects");
+
+        constexpr int writers = 4, per_writer = 500;
+        std::vector<int> next(writers, 0);
+        bool in_order = true;
+        std::thread reader([&] {
+            std::string frame;
+            for (int i = 0; i < writers * per_writer; ++i) {
+                if (!client.recvFrame(frame, 2000)) { in_order = false; return; }
+                const int w = frame[0] - '0';
+                const int seq = std::stoi(frame.substr(2, frame.find('|') - 2));
+                const bool intact = frame.size() == frame.find('|') + 1 + static_cast<std::size_t>(seq % 97);
+                in_order = in_order && w >= 0 && w < writers && seq == next[w]++ && intact;
+            }
+        });
+        std::vector<std::thread> threads;
+        for (int w = 0; w < writers; ++w) {
+            threads.emplace_back([&, w] {
+                for (int i = 0; i < per_writer; ++i) {
+                    client.sendFrame(std::to_string(w) + ":" + std::to_string(i) + "|" + std::string(i % 97, 'x'));
+                }
+            });
+        }
+        for (auto& t : threads) t.join();
+        reader.join();
+        const auto stats = client.stats();
+        expect(in_order && !client.failed(), "Concurrent writers' frames arrive whole and in per-thread order");
+        expect(stats.frames == writers * per_writer && stats.writes <= stats.frames, "Duplex client counts frames and writes");
+        client.close();
+        expect(!client.sendFrame("late"), "Sending after close fails");
+        server.stop();
+
+        // The writer of the first frame must not stay on to write a frame pushed meanwhile:
+        // the peer takes the first frame, then stops reading, and the first sendFrame()
+        // has to return during that pause.
+        cpplib::Socket listener;
+        expect(listener.bind(0) && listener.listen(), "Raw peer listens");
+        cpplib::DuplexClient busy;
+        expect(busy.connect("127.0.0.1", listener.localPort()), "Busy client connects");
+        auto peer = listener.accept();
+        const std::string first(16 << 20, 'a'), second(32 << 20, 'b');
+        std::chrono::steady_clock::time_point first_returned, paused;
+        std::thread first_writer([&] {
+            busy.sendFrame(first);
+            first_returned = std::chrono::steady_clock::now();
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));  // holds the role, blocked on the peer
+        std::thread second_writer([&] { busy.sendFrame(second); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::string got(cpplib::frame::header_size + first.size(), '\0');
+        const bool took_first = peer && peer->recv_exact(&got[0], got.size()) == static_cast<std::ptrdiff_t>(got.size());
+        paused = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        got.assign(cpplib::frame::header_size + second.size(), '\0');
+        const bool took_second = took_first && peer->recv_exact(&got[0], got.size()) == static_cast<std::ptrdiff_t>(got.size());
+        first_writer.join();
+        second_writer.join();
+        expect(took_second && got.compare(cpplib::frame::header_size, std::string::npos, second) == 0 &&
+               first_returned < paused + std::chrono::milliseconds(250),
+               "A writer sends one batch and hands the role back");
+        busy.close();
+    }
+
+    void test_http_parser() {
+        std::vector<std::string> seen;
+        cpplib::http::RequestParser parser;
+        auto collect = [&](const cpplib::http::Request& r) {
+            seen.push_back(std::string(r.method) + " " + std::string(r.path) + "?" + std::string(r.query) + " " +
+                           std::string(r.header("host")) + " " + std::string(r.body) + (r.keep_alive ? " ka" : " close"));
+        };
+        const std::string pipelined =
+            "GET /a?x=1 HTTP/1.1\r\nHost: h\r\n\r\n"
+            "POST /b HTTP/1.1\r\nHOST: h\r\nContent-Length: 5\r\n\r\nhello"
+            "POST /c HTTP/1.1\r\nHost: h\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n"
+            "3;ext=1\r\nabc\r\n2\r\nde\r\n0\r\nTrailer: t\r\n\r\n"
+            "GET /d HTTP/1.0\r\n\r\n";
+        expect(parser.feed(pipelined.data(), pipelined.size(), collect) && seen.size() == 4, "Parser splits pipelined requests");
+        expect(seen[0] == "GET /a?x=1 h  ka" && seen[1] == "POST /b? h hello ka" && seen[2] == "POST /c? h abcde close" &&
+               seen[3] == "GET /d?   close", "Parser extracts target, headers, bodies and keep-alive");
+
+        seen.clear();
+        bool ok = true;
+        for (char c : pipelined) ok = ok && parser.feed(&c, 1, collect);
+        expect(ok && seen.size() == 4 && seen[2] == "POST /c? h abcde close" && parser.buffered() == 0,
+               "Parser reassembles requests fed one byte at a time");
+
+        auto rejects = [](const std::string& text, cpplib::http::Error why) {
+            cpplib::http::RequestParser p(1024, 16);
+            return !p.feed(text.data(), text.size(), [](const cpplib::http::Request&) {}) && p.error() == why;
+        };
+        using cpplib::http::Error;
+        expect(rejects("GET / HTTP/2.0\r\n\r\n", Error::bad_request), "Parser rejects unknown versions");
+        expect(rejects("POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n", Error::bad_request),
+               "Parser rejects Content-Length together with chunked");
+        expect(rejects("POST / HTTP/1.1\r\nContent-Length: 17\r\n\r\n", Error::body_too_large), "Parser enforces the body limit");
+        expect(rejects("GET / HTTP/1.1\r\nX: " + std::string(2000, 'y'), Error::header_too_large), "Parser enforces the head limit");
+        expect(rejects("POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n", Error::not_implemented),
+               "Parser refuses unsupported transfer codings");
+    }
+
+    void test_http_server() {
+        cpplib::HttpServer server;
+        expect(server.bind(0) && server.listen(), "HTTP server listens");
+        server.start(2, [](const cpplib::http::Request& req, cpplib::http::Response& res) {
+            if (req.path == "/stream") {
+                res.header("Content-Type", "text/plain");
+                for (int i = 0; i < 3; ++i) res.write("part" + std::to_string(i) + ";");
+                return;
+            }
+            if (req.path == "/missing") {
+                res.status(404).send("nope");
+                return;
+            }
+            res.header("Content-Type", "text/plain").send("echo:" + std::string(req.target) + ":" + std::string(req.body));
+        });
+
+        auto read_until = [](cpplib::TcpClient& c, const std::string& marker, std::size_t count) {
+            std::string got;
+            char buf[4096];
+            auto occurrences = [&] {
+                std::size_t n = 0;
+                for (auto at = got.find(marker); at != std::string::npos; at = got.find(marker, at + 1)) ++n;
+                return n;
+            };
+            while (occurrences() < count) {
+                const auto r = c.receive(buf, sizeof(buf));
+                if (r <= 0) break;
+                got.append(buf, static_cast<std::size_t>(r));
+            }
+            return got;
+        };
+
+        cpplib::TcpClient client;
+        expect(client.connect("127.0.0.1", server.port()), "HTTP client connects");
+        expect(client.send("GET /one HTTP/1.1\r\nHost: x\r\n\r\nPOST /two HTTP/1.1\r\nHost: x\r\nContent-Length: 3\r\n\r\nabc"),
+               "Client pipelines two requests");
+        auto reply = read_until(client, "HTTP/1.1 200 OK", 2);
+        const auto first = reply.find("echo:/one:"), second = reply.find("echo:/two:abc");
+        expect(first != std::string::npos && second != std::string::npos && first < second &&
+               reply.find("Content-Length: 10\r\n") != std::string::npos && reply.find("Date: ") != std::string::npos,
+               "Pipelined responses arrive in order with lengths");
+
+        expect(client.send("GET /stream HTTP/1.1\r\n\r\n"), "Client asks for a chunked response");
+        reply = read_until(client, "0\r\n\r\n", 1);
+        expect(reply.find("Transfer-Encoding: chunked\r\n") != std::string::npos &&
+               reply.find("6\r\npart0;\r\n6\r\npart1;\r\n6\r\npart2;\r\n0\r\n\r\n") != std::string::npos,
+               "Streamed body is chunk-encoded");
+
+        expect(client.send("GET /missing HTTP/1.1\r\nConnection: close\r\n\r\n"), "Client sends a closing request");
+        reply = read_until(client, "\r\n\r\nnope", 1);
+        char tail;
+        expect(reply.find("HTTP/1.1 404 Not Found\r\n") == 0 && reply.find("Connection: close\r\n") != std::string::npos &&
+               client.receive(&tail, 1) == 0, "Connection: close is honoured after the response");
+
+        cpplib::TcpClient bad;
+        expect(bad.connect("127.0.0.1", server.port()) && bad.send("BROKEN\r\n\r\n"), "Client sends garbage");
+        reply = read_until(bad, "Bad Request", 2);
+        expect(reply.find("HTTP/1.1 400 Bad Request\r\n") == 0 && bad.receive(&tail, 1) == 0, "Malformed request gets 400 and a close");
+        server.stop();
+    }
+
+    void test_websocket() {
+        expect(cpplib::ws::acceptKey("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=", "Accept key matches RFC 6455");
+        const std::uint8_t mask[4] = {0x12, 0x34, 0x56, 0x78};
+        bool unmasked = true;
+        for (std::size_t len : {0u, 3u, 16u, 37u, 100u}) {
+            std::string plain(len, '\0');
+            for (std::size_t i = 0; i < len; ++i) plain[i] = static_cast<char>(i * 7);
+            std::string wire(len, '\0');
+            cpplib::ws::unmask(&wire[0], plain.data(), len, mask);
+            for (std::size_t i = 0; i < len; ++i) unmasked = unmasked && wire[i] == static_cast<char>(plain[i] ^ mask[i & 3]);
+            // Unmasking in two pieces continues the mask phase.
+            const std::size_t cut = len / 3;
+            cpplib::ws::unmask(&wire[0], wire.data(), cut, mask);
+            cpplib::ws::unmask(&wire[0] + cut, wire.data() + cut, len - cut, mask, cut);
+            unmasked = unmasked && wire == plain;
+        }
+        expect(unmasked, "Vectorized unmask matches the scalar definition at any phase");
+
+        cpplib::WebSocketServer server;
+        expect(server.bind(0) && server.listen(), "WebSocket server listens");
+        std::atomic<int> opened{0}, closed{0};
+        cpplib::WebSocketServer::Handlers handlers;
+        handlers.on_open = [&](cpplib::WebSocketServer::ConnectionId, const cpplib::http::Request&) { ++opened; };
+        handlers.on_message = [&](cpplib::WebSocketServer::ConnectionId id, cpplib::ws::Opcode op, const char* data, std::size_t len) {
+            server.send(id, "echo:" + std::string(data, len), op);
+        };
+        handlers.on_close = [&](cpplib::WebSocketServer::ConnectionId) { ++closed; };
+        server.start(2, handlers);
+
+        auto handshake = [&](cpplib::TcpClient& c, std::uint16_t port) {
+            if (!c.connect("127.0.0.1", port)) return false;
+            c.send("GET /chat HTTP/1.1\r\nHost: x\r\nUpgrade: websocket\r\nConnection: keep-alive, Upgrade\r\n"
+                   "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+            std::string reply;
+            char buf[512];
+            while (reply.find("\r\n\r\n") == std::string::npos) {
+                const auto r = c.receive(buf, sizeof(buf));
+                if (r <= 0) return false;
+                reply.append(buf, static_cast<std::size_t>(r));
+            }
+            return reply.find("HTTP/1.1 101") == 0 && reply.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") != std::string::npos;
+        };
+        // Reads server frames until `count` have arrived.
+        auto read_frames = [](cpplib::TcpClient& c, std::size_t count) {
+            std::vector<std::pair<cpplib::ws::Opcode, std::string>> frames;
+            cpplib::ws::FrameParser parser(1 << 20, false);
+            char buf[4096];
+            while (frames.size() < count) {
+                const auto r = c.receive(buf, sizeof(buf));
+                if (r <= 0 || !parser.feed(buf, static_cast<std::size_t>(r), [&](cpplib::ws::Opcode op, const char* p, std::size_t n) {
+                        frames.emplace_back(op, std::string(p, n));
+                    })) break;
+            }
+            return frames;
+        };
+
+        cpplib::TcpClient a, b;
+        expect(handshake(a, server.port()) && handshake(b, server.port()), "Clients complete the upgrade handshake");
+        std::string wire;
+        cpplib::ws::appendFrame(wire, cpplib::ws::Opcode::text, "hel", 3, false, mask);
+        cpplib::ws::appendFrame(wire, cpplib::ws::Opcode::ping, "p", 1, true, mask);
+        cpplib::ws::appendFrame(wire, cpplib::ws::Opcode::continuation, "lo", 2, true, mask);
+        const std::string big(70000, 'z');
+        cpplib::ws::appendFrame(wire, cpplib::ws::Opcode::binary, big.data(), big.size(), true, mask);
+        expect(a.send(wire), "Client sends fragmented, control and large frames");
+        auto frames = read_frames(a, 3);
+        expect(frames.size() == 3 && frames[0].first == cpplib::ws::Opcode::pong && frames[0].second == "p" &&
+               frames[1].first == cpplib::ws::Opcode::text && frames[1].second == "echo:hello" &&
+               frames[2].first == cpplib::ws::Opcode::binary && frames[2].second == "echo:" + big,
+               "Server answers pings mid-message and reassembles fragments");
+
+        while (server.numOpen() < 2) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        expect(server.broadcast("news") == 2, "Broadcast reaches every open connection");
+        auto got_a = read_frames(a, 1), got_b = read_frames(b, 1);
+        expect(got_a.size() == 1 && got_a[0].second == "news" && got_b.size() == 1 && got_b[0].second == "news",
+               "Every subscriber receives the broadcast frame");
+
+        wire.clear();
+        const char code[2] = {0x03, static_cast<char>(0xE8)};
+        cpplib::ws::appendFrame(wire, cpplib::ws::Opcode::close, code, 2, true, mask);
+        b.send(wire);
+        auto bye = read_frames(b, 1);
+        char tail;
+        expect(bye.size() == 1 && bye[0].first == cpplib::ws::Opcode::close && bye[0].second == std::string(code, 2) &&
+               b.receive(&tail, 1) == 0, "Close frame is echoed and the connection closed");
+
+        expect(a.send(std::string("\x81\x02hi", 4)), "Client sends an unmasked frame");
+        auto refused = read_frames(a, 1);
+        expect(refused.size() == 1 && refused[0].first == cpplib::ws::Opcode::close && refused[0].second == "\x03\xea",
+               "Unmasked client frames are a protocol error (1002)");
+
+        cpplib::TcpClient plain;
+        std::string reply;
+        char buf[256];
+        expect(plain.connect("127.0.0.1", server.port()) && plain.send("GET / HTTP/1.1\r\nHost: x\r\n\r\n"), "Plain HTTP client connects");
+        for (auto r = plain.receive(buf, sizeof(buf)); r > 0; r = plain.receive(buf, sizeof(buf))) reply.append(buf, static_cast<std::size_t>(r));
+        expect(reply.find("HTTP/1.1 400") == 0, "Non-upgrade requests are refused");
+        server.stop();
+        expect(opened == 2 && closed == 2, "Open and close callbacks fire once per connection");
+
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+        // Per-core handlers run on the connection's own core: close() from inside one must
+        // not free the connection while its parser is still on the stack.
+        cpplib::WebSocketServer kicker;
+        expect(kicker.bind(0) && kicker.listen(), "Per-core WebSocket server listens");
+        std::atomic<int> messages{0}, kicked_closed{0};
+        cpplib::WebSocketServer::Handlers kick;
+        kick.on_open = [&](cpplib::WebSocketServer::ConnectionId id, const cpplib::http::Request& req) {
+            if (req.path == "/kick") kicker.close(id, cpplib::ws::close_code::going_away);
+        };
+        kick.on_message = [&](cpplib::WebSocketServer::ConnectionId id, cpplib::ws::Opcode, const char*, std::size_t) {
+            ++messages;
+            kicker.close(id);
+        };
+        kick.on_close = [&](cpplib::WebSocketServer::ConnectionId) { ++kicked_closed; };
+        expect(kicker.startPerCore(1, kick), "Per-core WebSocket server starts");
+
+        cpplib::TcpClient leaving;
+        expect(handshake(leaving, kicker.port()), "Per-core client completes the handshake");
+        wire.clear();
+        cpplib::ws::appendFrame(wire, cpplib::ws::Opcode::text, "bye", 3, true, mask);
+        cpplib::ws::appendFrame(wire, cpplib::ws::Opcode::text, "late", 4, true, mask);
+        leaving.send(wire);
+        auto closing = read_frames(leaving, 1);
+        expect(closing.size() == 1 && closing[0].first == cpplib::ws::Opcode::close && closing[0].second == "\x03\xe8" &&
+               leaving.receive(&tail, 1) == 0 && messages == 1,
+               "close() from on_message sends the close frame and ends the connection");
+
+        cpplib::TcpClient kicked;
+        reply.clear();
+        expect(kicked.connect("127.0.0.1", kicker.port()) &&
+               kicked.send("GET /kick HTTP/1.1\r\nHost: x\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n"),
+               "Kicked client connects");
+        for (auto r = kicked.receive(buf, sizeof(buf)); r > 0; r = kicked.receive(buf, sizeof(buf))) reply.append(buf, static_cast<std::size_t>(r));
+        const auto body = reply.find("\r\n\r\n");
+        expect(reply.find("HTTP/1.1 101") == 0 && body != std::string::npos &&
+               reply.compare(body + 4, std::string::npos, std::string("\x88\x02\x03\xe9", 4)) == 0,
+               "close() from on_open sends the close frame after the 101");
+        kicker.stop();
+        expect(kicked_closed == 2, "Per-core close callbacks fire once per connection");
+#endif
+    }
+
+    void test_client_prewarm() {
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Prewarm upstream listens");
+        server.setFramed();
+        std::atomic<int> frames{0};
+        server.start(8, [&](cpplib::TcpServer::ClientId id, std::shared_ptr<cpplib::Socket>, const char* data, std::size_t len) {
+            ++frames;
+            server.sendFrameTo(id, data, len);
+        });
+
+        cpplib::Prewarmer warmer;
+        cpplib::ClientPool::Options opts;
+        opts.port = server.port();
+        opts.warmup_frame = "warm";
+        opts.warmup_rounds = 3;
+        auto& pool = warmer.add(opts);
+        cpplib::ClientPool::Options plain;
+        plain.port = server.port();
+        plain.size = 2;
+        warmer.add(plain);
+        int ready_calls = 0;
+        warmer.onReady([&] { ++ready_calls; });
+        expect(!warmer.ready() && warmer.run() && warmer.ready() && ready_calls == 1, "Prewarmer turns ready once every pool is warm");
+        const auto& r = warmer.reports()[0];
+        expect(r.connected == 4 && r.warm == 4 && r.failed == 0 && frames.load() == 12 && r.last_rtt.count() > 0 &&
+               warmer.reports()[1].warm == 2, "Every connection is opened and sends its warm-up rounds");
+
+        {
+            auto a = pool.acquire(0), b = pool.acquire(0);
+            std::vector<std::uint8_t> reply;
+            expect(a && b && &*a != &*b && a->sendFrame("req") && a->recvFrame(reply, 1000) &&
+                   std::string(reply.begin(), reply.end()) == "req", "Leases are distinct warm connections");
+            b.discard();
+        }
+        expect(pool.idle() == 4, "Leases return their connections");
+        std::vector<cpplib::ClientPool::Lease> all;
+        for (int i = 0; i < 4; ++i) all.push_back(pool.acquire(0));
+        std::vector<std::uint8_t> reply;
+        const bool all_work = std::all_of(all.begin(), all.end(), [&](auto& l) { return l && l->sendFrame("x") && l->recvFrame(reply, 1000); });
+        expect(all_work && !pool.acquire(10) && pool.stats().reconnects == 1, "Discarded connection reopens; an exhausted pool times out");
+        all.clear();
+
+        // A retry rewarms only the idle cold slot; the leased one stays with its holder.
+        cpplib::Prewarmer retried;
+        cpplib::ClientPool::Options flaky;
+        flaky.port = server.port();
+        flaky.size = 2;
+        std::atomic<int> warmups{0};
+        flaky.warmup = [&](cpplib::TcpClient& c) {
+            std::vector<std::uint8_t> echo;
+            return ++warmups != 1 && c.sendFrame("w") && c.recvFrame(echo, 1000);
+        };
+        auto& flaky_pool = retried.add(flaky);
+        expect(!retried.run() && flaky_pool.report().warm == 1, "One warm-up fails the first run");
+        {
+            auto held = flaky_pool.acquire(0);
+            expect(held && retried.run() && warmups == 3 && flaky_pool.idle() == 1 && flaky_pool.report().connected == 2,
+                   "Retry warms the cold slot and leaves the leased one alone");
+            expect(held->sendFrame("still") && held->recvFrame(reply, 1000), "Leased connection survives the retry");
+            expect(retried.run() && warmups == 3, "Ready pools are skipped on retry");
+        }
+        expect(flaky_pool.idle() == 2, "No slot is idle twice");
+
+        cpplib::Prewarmer cold;
+        cpplib::ClientPool::Options gone;
+        gone.port = server.port();
+        gone.size = 2;
+        gone.connect_attempts = 2;
+        gone.retry_backoff = std::chrono::milliseconds(1);
+        auto& dead = cold.add(gone);
+        server.stop();
+        expect(!cold.run() && !cold.ready() && dead.report().failed == 2 && !dead.acquire(0), "Unreachable pool never reports ready");
+    }
+
+    void test_response_cache() {
+        cpplib::ResponseCache cache(4096, 1);
+        auto a = cache.put("a", std::string(1000, 'a'));
+        cache.put("b", std::string(1000, 'b'));
+        expect(cache.get("a") == a && cache.stats().hits == 1, "Cache hit returns the stored buffer");
+        cache.put("c", std::string(1000, 'c'));
+        cache.put("d", std::string(1000, 'd'));
+        const auto st = cache.stats();
+        expect(cache.get("a") && !cache.get("b") && st.evictions > 0 && st.bytes <= 4096,
+               "Cache evicts least recently used entries by bytes");
+        expect(!cache.put("huge", std::string(8192, 'x')) || !cache.get("huge"), "Oversized values are not cached");
+
+        cpplib::ResponseCache ttl_cache(1 << 20, 4, std::chrono::milliseconds(5));
+        ttl_cache.put("k", std::string("v"));
+        const bool fresh = ttl_cache.get("k") != nullptr;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        expect(fresh && !ttl_cache.get("k"), "Cache entries expire after their TTL");
+
+        cpplib::ResponseCache replies(1 << 20);
+        std::atomic<int> computed{0};
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Cache test server listens");
+        server.setFramed();
+        server.start(1, [&](cpplib::TcpServer::ClientId id, std::shared_ptr<cpplib::Socket>, const char* data, std::size_t len) {
+            auto wire = replies.getOrCompute(std::string(data, len), [&] {
+                ++computed;
+                std::string out;
+                cpplib::frame::append(out, data, static_cast<std::uint32_t>(len));
+                return out;
+            });
+            server.sendTo(id, wire);
+        });
+        cpplib::TcpClient client;
+        std::string r1, r2;
+        expect(client.connect("127.0.0.1", server.port()) && client.sendFrame("get /x") && client.recvFrame(r1, 1000) &&
+               client.sendFrame("get /x") && client.recvFrame(r2, 1000) && r1 == "get /x" && r2 == r1 && computed == 1,
+               "Cached reply frames are sent from the shared buffer");
+        server.stop();
+    }
+
+    using QuoteV1 = cpplib::schema::Layout<std::uint64_t, double, cpplib::schema::Bytes>;
+    using QuoteV2 = cpplib::schema::Layout<std::uint64_t, double, cpplib::schema::Bytes, bool,
+                                           cpplib::schema::Array<std::int32_t>>;
+    enum QuoteField { quote_id, quote_price, quote_symbol, quote_live, quote_levels };
+
+    void test_flat_schema() {
+        static_assert(QuoteV2::fixed_size == 8 + 8 + 8 + 1 + 8, "Layout is computed at compile time");
+        cpplib::ByteBuffer out;
+        const std::int32_t levels[] = {100, -5, 7};
+        cpplib::schema::Builder<QuoteV2> b(out, true);
+        b.set<quote_id>(42).set<quote_price>(101.25).setBytes<quote_symbol>("EURUSD").set<quote_live>(true);
+        b.setArray<quote_levels>(levels, 3);
+        const std::size_t size = b.finish();
+        expect(size + cpplib::frame::header_size == out.size(), "Builder writes a complete frame");
+
+        cpplib::FrameDecoder decoder;
+        bool checked = false;
+        decoder.feed(out.data(), out.size(), [&](const char* data, std::size_t len) {
+            cpplib::schema::View<QuoteV2> v(data, len);
+            const auto lv = v.get<quote_levels>();
+            checked = v.valid() && v.get<quote_id>() == 42 && v.get<quote_price>() == 101.25 &&
+                      v.get<quote_symbol>() == "EURUSD" && v.get<quote_live>() && lv.size() == 3 && lv[1] == -5 &&
+                      v.get<quote_symbol>().data() >= data && v.get<quote_symbol>().data() < data + len;
+        });
+        expect(checked, "View reads fields in place");
+
+        cpplib::ByteBuffer old;
+        cpplib::schema::Builder<QuoteV1>(old).set<quote_id>(7).setBytes<quote_symbol>("GBP").finish();
+        cpplib::schema::View<QuoteV2> newer(old.data(), old.size());
+        expect(newer.valid() && newer.get<quote_id>() == 7 && newer.get<quote_symbol>() == "GBP" &&
+               !newer.get<quote_live>() && newer.get<quote_levels>().empty(), "Newer layout reads older messages");
+        expect(!cpplib::schema::View<QuoteV2>(old.data(), old.size() - 1).valid(), "Truncated message is rejected");
+    }
+
+    void test_parallel_algorithms() {
+        cpplib::ThreadPool pool(3);
+        std::uint64_t state = 88172645463325252ull;
+        auto rnd = [&] { state ^= state << 13; state ^= state >> 7; state ^= state << 17; return state; };
+
+        std::vector<std::uint32_t> v(300000);
+        for (auto& x : v) x = static_cast<std::uint32_t>(rnd() % 100000);
+        auto expected = v;
+        std::sort(expected.begin(), expected.end());
+        cpplib::parallel::sort(pool, v.begin(), v.end());
+        expect(v == expected, "parallel::sort matches std::sort");
+
+        std::vector<std::pair<int, int>> pairs(200000);
+        for (std::size_t i = 0; i < pairs.size(); ++i) pairs[i] = {static_cast<int>(rnd() % 50), static_cast<int>(i)};
+        auto stable = pairs;
+        auto by_key = [](const auto& a, const auto& b) { return a.first < b.first; };
+        std::stable_sort(stable.begin(), stable.end(), by_key);
+        cpplib::parallel::stable_sort(pool, pairs.begin(), pairs.end(), by_key);
+        expect(pairs == stable, "parallel::stable_sort keeps equal keys in order");
+
+        std::vector<std::string> words(60000);
+        for (auto& w : words) w = "w" + std::to_string(rnd() % 1000000) + std::string(rnd() % 24, 'x');
+        auto sorted_words = words;
+        std::sort(sorted_words.begin(), sorted_words.end());
+        cpplib::parallel::sort(pool, words.begin(), words.end(), std::less<std::string>{});
+        std::vector<int> tiny{3, 1, 2};
+        cpplib::parallel::sort(pool, tiny.begin(), tiny.end());
+        expect(words == sorted_words && tiny == std::vector<int>({1, 2, 3}), "Non-trivial and tiny ranges sort");
+
+        // Past the small-string buffer every move empties its source, so a merge piece that
+        // reads elements a neighbouring piece already moved out would show up here.
+        bool long_words_sorted = true;
+        for (std::size_t workers : {1u, 2u, 5u}) {
+            cpplib::ThreadPool merge_pool(workers);
+            std::vector<std::string> long_words(300000);
+            for (auto& w : long_words) w = std::to_string(rnd() % 1000000) + std::string(22, 'y') + std::to_string(rnd() % 1000);
+            auto expected_words = long_words;
+            std::sort(expected_words.begin(), expected_words.end());
+            cpplib::parallel::sort(merge_pool, long_words.begin(), long_words.end(), std::less<std::string>{});
+            long_words_sorted = long_words_sorted && long_words == expected_words;
+        }
+        expect(long_words_sorted, "Heap-allocated strings sort correctly on several pool sizes");
+
+        std::vector<std::uint64_t> in(250000), inc(in.size()), exc(in.size());
+        for (auto& x : in) x = rnd() % 1000;
+        std::inclusive_scan(in.begin(), in.end(), inc.begin());
+        std::exclusive_scan(in.begin(), in.end(), exc.begin(), std::uint64_t{7});
+        std::vector<std::uint64_t> out(in.size());
+        cpplib::parallel::exclusive_scan(pool, in.begin(), in.end(), out.begin(), std::uint64_t{7});
+        const bool exc_ok = out == exc;
+        auto in_place = in;
+        const auto end = cpplib::parallel::inclusive_scan(pool, in_place.begin(), in_place.end(), in_place.begin());
+        expect(exc_ok && in_place == inc && end == in_place.end(), "Inclusive (in place) and exclusive scans match std");
+
+        const auto sum_sq = cpplib::parallel::transform_reduce(pool, in.begin(), in.end(), std::uint64_t{1}, std::plus<>{},
+                                                               [](std::uint64_t x) { return x * x; });
+        expect(sum_sq == std::transform_reduce(in.begin(), in.end(), std::uint64_t{1}, std::plus<>{}, [](std::uint64_t x) { return x * x; }),
+               "transform_reduce matches std");
+
+        std::vector<int> hay(400000, 0);
+        hay[123457] = 1;
+        hay[300001] = 1;
+        auto is_one = [](int x) { return x == 1; };
+        expect(cpplib::parallel::find_first(pool, hay.begin(), hay.end(), is_one) == hay.begin() + 123457 &&
+               cpplib::parallel::find_first(pool, hay.begin(), hay.end(), [](int x) { return x == 2; }) == hay.end(),
+               "find_first returns the earliest match");
+
+        auto part = in;
+        auto part_ref = in;
+        auto odd = [](std::uint64_t x) { return x % 2 == 1; };
+        const auto mid = cpplib::parallel::partition(pool, part.begin(), part.end(), odd);
+        const auto mid_ref = std::stable_partition(part_ref.begin(), part_ref.end(), odd);
+        expect(part == part_ref && mid - part.begin() == mid_ref - part_ref.begin(), "partition is stable and splits where std does");
+
+        // Called from the pool's only worker: the caller does the work itself.
+        cpplib::ThreadPool one(1);
+        auto nested = v;
+        std::reverse(nested.begin(), nested.end());
+        auto done = one.enqueue([&] { cpplib::parallel::sort(one, nested.begin(), nested.end()); });
+        expect(done.wait_for(std::chrono::seconds(10)) == std::future_status::ready && nested == expected,
+               "A pool task can call into the same pool without deadlock");
+    }
+
+    void test_tcp_client_group() {
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Group test server listens");
+        server.start(2, [](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket> client, const char* data, std::size_t len) {
+            client->send_all(data, len);  // echoing raw bytes echoes whole frames
+        });
+
+        cpplib::TcpClient a, b;
+        expect(a.connect("127.0.0.1", server.port()) && b.connect("127.0.0.1", server.port()), "Group members connect");
+        cpplib::TcpClientGroup group;
+        const auto ia = group.add(a);
+        const auto ib = group.add(b);
+        expect(group.size() == 2, "Group holds both clients");
+
+        std::string frame;
+        expect(!group.recvAnyFrame(frame, 20), "Idle group times out");
+        expect(b.sendFrame("from-b"), "Second member sends");
+        auto who = group.recvAnyFrame(frame, 1000);
+        expect(who && *who == ib && frame == "from-b", "Group reads whichever member has data");
+
+        expect(group.sendFrameAll("all") == 2, "Group fans out to every member");
+        std::size_t seen = 0;
+        while (auto idx = group.recvAnyFrame(frame, 1000)) {
+            if (frame == "all" && (*idx == ia || *idx == ib)) ++seen;
+            if (seen == 2) break;
+        }
+        expect(seen == 2, "Group fans in every reply");
+        server.stop();
+    }
+
+    void test_hedged_client() {
+        cpplib::TcpServer silent, fast;
+        expect(silent.bind(0) && silent.listen() && fast.bind(0) && fast.listen(), "Hedge test servers listen");
+        silent.start(1, [](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket>, const char*, std::size_t) {});
+        fast.start(1, [](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket> client, const char* data, std::size_t len) {
+            client->send_all(data, len);
+        });
+
+        cpplib::HedgedClient::Options options;
+        options.initial_delay = std::chrono::milliseconds(20);
+        cpplib::HedgedClient client({{"127.0.0.1", silent.port()}, {"127.0.0.1", fast.port()}}, options);
+        std::string reply;
+        expect(client.request("hedge", reply, 1000) && reply == "hedge", "Hedged request answered by the second endpoint");
+        expect(client.stats().hedges == 1 && client.stats().hedge_wins == 1, "Hedge sent after the delay and won");
+        expect(client.request("direct", reply, 1000) && reply == "direct", "Request to the healthy endpoint");
+        expect(client.stats().hedges == 1, "No hedge when the primary answers in time");
+        expect(!client.request("again", reply, 100) && client.stats().budget_denied == 1,
+               "Hedge budget caps duplicate load");
+        silent.stop();
+        fast.stop();
+    }
+
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+    void test_tcp_server_per_core() {
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Per-core server binds and listens");
+        std::atomic<int> connects{0};
+        expect(server.startPerCore(2,
+            [&](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket>) { ++connects; },
+            [](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket> client, const char* data, std::size_t len) {
+                client->send_all(data, len);
+            },
+            {}), "Per-core server starts");
+
+        cpplib::TcpClient client;
+        expect(client.connect("127.0.0.1", server.port()), "Client connects to per-core server");
+        expect(client.send("echo"), "Client sends to per-core server");
+        expect(client.receive(4) == "echo", "Per-core server echoes");
+
+        auto ids = server.clientIds();
+        expect(ids.size() == 1 && connects == 1, "Per-core server tracks its client");
+        expect(!ids.empty() && server.sendTextTo(ids[0], "push"), "sendTo from a foreign thread is forwarded");
+        expect(client.receive(4) == "push", "Client receives forwarded send");
+
+        std::promise<std::size_t> ran;
+        server.postToCore(1, [&] { ran.set_value(1); });
+        expect(ran.get_future().get() == 1, "postToCore runs on the target core");
+
+        // Core 0 holds core 1 up, overfills its inbox (300 tasks for 256 slots), and sends
+        // one more once core 1 has freed some slots but not yet reached the overflow. That
+        // last task must still run after the 44 that overflowed before it.
+        std::promise<void> go, at_100, sent_last;
+        auto go_f = go.get_future().share();
+        auto at_100_f = at_100.get_future().share();
+        auto sent_last_f = sent_last.get_future().share();
+        std::vector<int> order;
+        std::promise<void> all_ran;
+        server.postToCore(0, [&] {
+            server.postToCore(1, [go_f] { go_f.wait(); });
+            for (int i = 0; i <= 300; ++i) {
+                if (i == 300) {
+                    go.set_value();
+                    at_100_f.wait();
+                }
+                server.postToCore(1, [&, i] {
+                    order.push_back(i);
+                    if (i == 100) {
+                        at_100.set_value();
+                        sent_last_f.wait();
+                    }
+                    if (order.size() == 301) all_ran.set_value();
+                });
+            }
+            sent_last.set_value();
+        });
+        auto ran_all = all_ran.get_future();
+        bool in_order = ran_all.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+        for (int i = 0; in_order && i <= 300; ++i) in_order = order[static_cast<std::size_t>(i)] == i;
+        expect(in_order, "Cross-core tasks keep their order when the inbox overflows");
+
+        // Both cores asking at once used to wait on each other's loop.
+        std::promise<std::size_t> from0, from1;
+        server.postToCore(0, [&] { from0.set_value(server.clientIds().size()); });
+        server.postToCore(1, [&] { from1.set_value(server.clientIds().size()); });
+        auto f0 = from0.get_future(), f1 = from1.get_future();
+        expect(f0.wait_for(std::chrono::seconds(2)) == std::future_status::ready &&
+               f1.wait_for(std::chrono::seconds(2)) == std::future_status::ready && f0.get() == 1 && f1.get() == 1,
+               "clientIds() from two cores at once");
+
+        client.close();
+        server.stop();
+        expect(server.clientIds().empty(), "clientIds() after stop()");
+        expect(!server.isRunning(), "Per-core server stops");
+
+        cpplib::TcpServer steered;
+        expect(steered.bind(0) && steered.listen(), "Steered server listens");
+        steered.setCpuSteering(true);
+        steered.startPerCore(2, [](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket> c, const char* data, std::size_t len) {
+            c->send_all(data, len);
+        });
+        bool echoed = true;
+        std::vector<std::unique_ptr<cpplib::TcpClient>> clients;
+        for (int i = 0; i < 4; ++i) {
+            clients.push_back(std::make_unique<cpplib::TcpClient>());
+            echoed = echoed && clients.back()->connect("127.0.0.1", steered.port()) && clients.back()->send("ping") &&
+                     clients.back()->receive(4) == "ping";
+        }
+        const auto st = steered.steeringStats();
+        expect(echoed && st.accepted == 4 && steered.numClients() == 4, "Steered connections are served and counted");
+        steered.stop();
+    }
+
+    void test_tcp_server_slow_peer() {
+        // Far more than loopback socket buffers hold, so most of it has to wait for the reader.
+        std::string big(32 << 20, '\0');
+        for (std::size_t i = 0; i < big.size(); ++i) big[i] = static_cast<char>(i * 31 + (i >> 12));
+        for (const bool over_limit : {false, true}) {
+            cpplib::TcpServer server;
+            expect(server.bind(0) && server.listen(), "Slow-peer server listens");
+            server.setOutboundLimit(over_limit ? (1 << 20) : (64 << 20));
+            std::promise<void> dropped;
+            server.startPerCore(1, {},
+                [&](cpplib::TcpServer::ClientId id, std::shared_ptr<cpplib::Socket>, const char* data, std::size_t len) {
+                    if (std::string(data, len) == "flood") {
+                        server.sendTo(id, big.data(), big.size());
+                    } else {
+                        server.sendTo(id, data, len);
+                    }
+                },
+                [&](cpplib::TcpServer::ClientId) { if (over_limit) dropped.set_value(); });
+
+            cpplib::TcpClient slow, other;
+            expect(slow.connect("127.0.0.1", server.port()) && slow.send("flood"), "Slow peer asks for a flood");
+            expect(other.connect("127.0.0.1", server.port()), "Second peer connects");
+            other.socket().set_timeouts(2000, 2000);
+            expect(other.send("ping") && other.receive(4) == "ping", "A peer that is not reading does not stall the core");
+
+            if (!over_limit) {
+                slow.socket().set_timeouts(5000, 5000);
+                const std::string got = slow.receive(big.size());
+                expect(got == big, "Queued bytes reach the slow peer intact and in order");
+                expect(slow.send("tail") && slow.receive(4) == "tail", "Writes after the backlog keep their order");
+            } else {
+                auto f = dropped.get_future();
+                expect(f.wait_for(std::chrono::seconds(2)) == std::future_status::ready && server.numClients() == 1,
+                       "A peer past the outbound limit is dropped");
+            }
+            server.stop();
+        }
+    }
+#endif
+
+#if defined(CPPLIB_HAS_CAPTURE)
+    void test_capture_replay() {
+        const auto path = (std::filesystem::temp_directory_path() / "cpplib_capture_test.cap").string();
+        cpplib::CaptureWriter writer(path, 1 << 20);
+        expect(writer.isOpen(), "Capture file opens");
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Captured server listens");
+        server.setFramed();
+        server.setInboundTap(writer.tap());
+        server.start(2, [&](cpplib::TcpServer::ClientId id, std::shared_ptr<cpplib::Socket>, const char* data, std::size_t len) {
+            server.sendFrameTo(id, data, len);
+        });
+        for (int c = 0; c < 2; ++c) {
+            cpplib::TcpClient client;
+            std::string reply;
+            expect(client.connect("127.0.0.1", server.port()), "Capture client connects");
+            for (int i = 0; i < 10; ++i) {
+                client.sendFrame("c" + std::to_string(c) + "-" + std::to_string(i));
+                client.recvFrame(reply, 1000);
+            }
+        }
+        server.stop();
+        expect(writer.stats().records == 20 && writer.stats().dropped == 0, "Every inbound frame is captured");
+        expect(writer.close(), "Capture file is finalized");
+
+        cpplib::CaptureReader reader(path);
+        cpplib::CaptureReader::Record rec;
+        std::map<std::uint64_t, std::vector<std::string>> seen;
+        std::uint64_t last_ns = 0;
+        bool ordered = true;
+        while (reader.next(rec)) {
+            ordered = ordered && rec.time_ns >= last_ns;
+            last_ns = rec.time_ns;
+            seen[rec.conn].emplace_back(rec.data);
+        }
+        expect(reader.valid() && reader.size() == 20 && seen.size() == 2 && ordered, "Reader sees both connections in time order");
+        expect(seen.begin()->second.front() == "c0-0" && seen.rbegin()->second.back() == "c1-9", "Captured payloads are intact");
+
+        cpplib::TcpServer target;
+        expect(target.bind(0) && target.listen(), "Replay target listens");
+        target.setFramed();
+        std::atomic<int> received{0};
+        target.start(2, [&](cpplib::TcpServer::ClientId id, std::shared_ptr<cpplib::Socket>, const char* data, std::size_t len) {
+            ++received;
+            target.sendFrameTo(id, data, len);
+        });
+        cpplib::ReplayDriver::Options fast;
+        fast.speed = 0;
+        auto report = cpplib::ReplayDriver("127.0.0.1", target.port(), fast).run(reader);
+        expect(report.sent == 20 && report.replies == 20 && report.errors == 0 && report.connections == 2 && received == 20,
+               "Replay as fast as possible re-sends every frame");
+        cpplib::ReplayDriver::Options paced;
+        paced.speed = 4.0;
+        report = cpplib::ReplayDriver("127.0.0.1", target.port(), paced).run(reader);
+        expect(report.sent == 20 && report.replies == 20 && report.throughput() > 0 && report.max >= report.p50,
+               "Paced replay reports throughput and latency");
+        target.stop();
+
+        cpplib::CaptureWriter small(path, 100);
+        for (int i = 0; i < 5; ++i) small.record(1, "0123456789012345678901234567890", 31);
+        expect(small.stats().records == 1 && small.stats().dropped == 4 && small.close(), "A full capture drops instead of overflowing");
+        cpplib::CaptureReader partial(path);
+        int n = 0;
+        while (partial.next(rec)) ++n;
+        expect(n == 1, "Only complete records are read back");
+        std::filesystem::remove(path);
+    }
+#endif
+
+#if defined(CPPLIB_HAS_SPLICE_PROXY)
+    void test_splice_proxy() {
+        cpplib::TcpServer upstream;
+        expect(upstream.bind(0) && upstream.listen(), "Proxy upstream listens");
+        upstream.start(4, [](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket> s, const char* data, std::size_t len) {
+            s->send_all(data, len);
+        });
+
+        std::string payload(1 << 20, '\0');
+        for (std::size_t i = 0; i < payload.size(); ++i) payload[i] = static_cast<char>(i * 131 + (i >> 9));
+
+        for (bool epoll : {false, true}) {
+            cpplib::SpliceProxy::Options opts;
+            opts.upstream_port = upstream.port();
+            cpplib::SpliceProxy proxy(opts);
+            std::atomic<int> closed{0};
+            std::atomic<std::uint64_t> closed_bytes{0};
+            proxy.setOnClose([&](const cpplib::SpliceProxy::TunnelStats& s) {
+                closed_bytes += s.to_upstream + s.to_client;
+                ++closed;
+            });
+            expect(proxy.bind(0) && proxy.listen(), "Proxy listens");
+            if (epoll) proxy.startEpoll(1, 2); else proxy.start(4);
+
+            cpplib::TcpClient a, b;
+            expect(a.connect("127.0.0.1", proxy.port()) && b.connect("127.0.0.1", proxy.port()), "Clients connect through the proxy");
+            std::thread writer([&] { a.socket().send_all(payload.data(), payload.size()); });
+            std::string got;
+            char buf[64 * 1024];
+            while (got.size() < payload.size()) {
+                const auto r = a.receive(buf, sizeof(buf));
+                if (r <= 0) break;
+                got.append(buf, static_cast<std::size_t>(r));
+            }
+            writer.join();
+            expect(got == payload, epoll ? "Epoll tunnel echoes 1 MiB intact" : "Threaded tunnel echoes 1 MiB intact");
+
+            expect(b.send("ping") && b.receive(buf, sizeof(buf)) == 4 && std::string(buf, 4) == "ping", "Second tunnel is independent");
+            // A counter is bumped just after its splice, so the client may see the bytes first.
+            std::vector<cpplib::SpliceProxy::TunnelStats> live;
+            std::uint64_t up = 0, down = 0;
+            for (int i = 0; i < 200 && down != payload.size() + 4; ++i) {
+                if (i) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                live = proxy.tunnels();
+                up = down = 0;
+                for (const auto& t : live) { up += t.to_upstream; down += t.to_client; }
+            }
+            expect(live.size() == 2 && up == payload.size() + 4 && down == payload.size() + 4, "Per-tunnel counters track both directions");
+
+            a.close();
+            b.close();
+            for (int i = 0; i < 200 && closed.load() < 2; ++i) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            const auto totals = proxy.totals();
+            expect(closed.load() == 2 && totals.active == 0 && totals.opened == 2 &&
+                   closed_bytes.load() == 2 * (payload.size() + 4) && totals.to_client == payload.size() + 4,
+                   "Tunnels close with the client and keep their totals");
+            proxy.stop();
+        }
+
+        // Client half-closes and reads slowly; upstream answers 4 MiB and closes. The
+        // upstream hangup arrives while the tunnel only waits on the client and must not
+        // cut off what is still in flight.
+        cpplib::TcpServer bulk;
+        expect(bulk.bind(0) && bulk.listen(), "Bulk upstream listens");
+        const std::string response(4 << 20, 'r');
+        bulk.start(2, [&](cpplib::TcpServer::ClientId, std::shared_ptr<cpplib::Socket> s, const char*, std::size_t) {
+            s->send_all(response.data(), response.size());
+            s->shutdown();
+        });
+        for (bool epoll : {false, true}) {
+            cpplib::SpliceProxy::Options opts;
+            opts.upstream_port = bulk.port();
+            cpplib::SpliceProxy proxy(opts);
+            expect(proxy.bind(0) && proxy.listen(), "Half-close proxy listens");
+            if (epoll) proxy.startEpoll(1, 2); else proxy.start(2);
+            cpplib::TcpClient c;
+            expect(c.connect("127.0.0.1", proxy.port()) && c.send("req"), "Half-close client sends its request");
+            ::shutdown(c.socket().native_handle(), SHUT_WR);
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            std::size_t got = 0;
+            char buf[64 * 1024];
+            for (auto r = c.receive(buf, sizeof(buf)); r > 0; r = c.receive(buf, sizeof(buf))) got += static_cast<std::size_t>(r);
+            expect(got == response.size(), epoll ? "Epoll tunnel delivers everything after an upstream hangup"
+                                                  : "Threaded tunnel delivers everything after an upstream hangup");
+            proxy.stop();
+        }
+        bulk.stop();
+
+        cpplib::SpliceProxy::Options dead;
+        dead.upstream_port = upstream.port();
+        upstream.stop();
+        cpplib::SpliceProxy proxy(dead);
+        expect(proxy.bind(0) && proxy.listen(), "Proxy with no upstream listens");
+        proxy.start(1);
+        cpplib::TcpClient c;
+        char buf[16];
+        expect(c.connect("127.0.0.1", proxy.port()) && c.receive(buf, sizeof(buf)) <= 0 && proxy.totals().connect_failures == 1,
+               "Client is dropped when the upstream is unreachable");
+        proxy.stop();
+    }
+#endif
+
+    void test_tcp_server_write_coalescing() {
+        cpplib::TcpServer server;
+        expect(server.bind(0) && server.listen(), "Coalescing server listens");
+        server.setWriteCoalescing(true);
+        server.start(1, [&server](cpplib::TcpServer::ClientId id, std::shared_ptr<cpplib::Socket>, const char* data, std::size_t len) {
+            for (std::size_t i = 0; i < len; ++i) server.sendTo(id, data + i, 1);
+        });
+        cpplib::TcpClient client;
+        char buf[16] = {};
+        expect(client.connect("127.0.0.1", server.port()) && client.send("abcdef") &&
+               client.receive(buf, sizeof(buf)) == 6 && std::string(buf, 6) == "abcdef",
+               "Sends from one handler arrive as one write");
+        server.stop();
+
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+        cpplib::TcpServer per_core;
+        expect(per_core.bind(0) && per_core.listen(), "Per-core coalescing server listens");
+        per_core.setWriteCoalescing(true, std::chrono::microseconds(500));
+        per_core.startPerCore(1, [&per_core](cpplib::TcpServer::ClientId id, std::shared_ptr<cpplib::Socket>, const char* data, std::size_t len) {
+            per_core.sendTo(id, data, len);
+            per_core.sendTextTo(id, "!");
+        });
+        cpplib::TcpClient c2;
+        expect(c2.connect("127.0.0.1", per_core.port()) && c2.send("hey") && c2.receive(4) == "hey!",
+               "Corked sends are flushed when the window closes");
+        per_core.stop();
+#endif
+
+        // A broadcast from the handler must not overtake what the handler already corked.
+        auto ordered_handler = [](cpplib::TcpServer& srv) {
+            return [&srv](cpplib::TcpServer::ClientId id, std::shared_ptr<cpplib::Socket>, const char*, std::size_t) {
+                srv.sendTextTo(id, "a");
+                srv.broadcastText("b");
+            };
+        };
+        auto receives_in_order = [](cpplib::TcpServer& srv) {
+            cpplib::TcpClient c;
+            return c.connect("127.0.0.1", srv.port()) && c.send("x") && c.receive(2) == "ab";
+        };
+        cpplib::TcpServer ordered;
+        expect(ordered.bind(0) && ordered.listen(), "Ordering server listens");
+        ordered.setWriteCoalescing(true, std::chrono::microseconds(500));
+        ordered.start(1, ordered_handler(ordered));
+        expect(receives_in_order(ordered), "Broadcast keeps order behind corked sends");
+        ordered.stop();
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+        cpplib::TcpServer ordered_per_core;
+        expect(ordered_per_core.bind(0) && ordered_per_core.listen(), "Per-core ordering server listens");
+        ordered_per_core.setWriteCoalescing(true, std::chrono::microseconds(500));
+        ordered_per_core.startPerCore(1, ordered_handler(ordered_per_core));
+        expect(receives_in_order(ordered_per_core), "Per-core broadcast keeps order behind corked sends");
+        ordered_per_core.stop();
+#endif
+    }
+
+#if defined(CPPLIB_HAS_ASYNC_SOCKET)
+    cpplib::Task<void> async_echo_once(cpplib::AsyncSocket& listener) {
+        auto conn = co_await listener.async_accept();
+        if (!conn) co_return;
+        char buf[4];
+        if (co_await conn->async_read_exact(buf, sizeof(buf)) == 4) {
+            co_await conn->async_write(buf, sizeof(buf));
+        }
+    }
+
+    cpplib::Task<void> async_ping(cpplib::EventLoop& loop, std::uint16_t port, std::string& reply) {
+        cpplib::AsyncSocket client(loop);
+        if (co_await client.async_connect("127.0.0.1", port)) {
+            co_await client.async_write(std::string("ping"));
+            reply.assign(4, '\0');
+            if (co_await client.async_read_exact(reply) != 4) reply.clear();
+        }
+        loop.stop();
+    }
+
+    void test_async_socket() {
+        cpplib::EventLoop loop;
+        cpplib::AsyncSocket listener(loop);
+        expect(listener.bind(0) && listener.listen(), "Async listener binds");
+        std::string reply;
+        loop.post([&] {
+            cpplib::spawn(async_echo_once(listener));
+            cpplib::spawn(async_ping(loop, listener.localPort(), reply));
+        });
+        loop.run();
+        expect(reply == "ping", "Coroutine accept/connect/read/write round trip");
+
+        // A leftover EAGAIN must not park the accept on a listener that is gone.
+        listener.close();
+        errno = EAGAIN;
+        auto refused = listener.async_accept();
+        expect(refused.await_ready() && refused.await_resume() == nullptr,
+               "Accept on a closed listener completes with no connection");
+    }
+#endif
 }
 
 int main() {
     test_stopwatch_and_scoped_timer();
     test_ini_and_config_sources();
+    test_monotonic_arena();
+    test_hugepage_buffer_and_buffered_logger();
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+    test_event_loop();
+#endif
     test_tcp_server_client_roundtrip();
+    test_message_arena_in_handler();
+    test_lz_and_compressed_frames();
+    test_crc32c_frames();
+    test_bytebuffer_and_segmented_frames();
+    test_tcp_client_group();
+    test_hedged_client();
+    test_codel_admission();
+    test_singleflight_framed_server();
+    test_tcp_fast_open();
+    test_busy_poll_client();
+    test_duplex_client();
+    test_http_parser();
+    test_http_server();
+    test_websocket();
+    test_client_prewarm();
+    test_response_cache();
+    test_flat_schema();
+    test_parallel_algorithms();
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+    test_tcp_server_per_core();
+    test_tcp_server_slow_peer();
+#endif
+    test_tcp_server_write_coalescing();
+#if defined(CPPLIB_HAS_CAPTURE)
+    test_capture_replay();
+#endif
+#if defined(CPPLIB_HAS_SPLICE_PROXY)
+    test_splice_proxy();
+#endif
+#if defined(CPPLIB_HAS_ASYNC_SOCKET)
+    test_async_socket();
+#endif
 
     if (failures) {
         std::cerr << failures << " test(s) failed" << std::endl;
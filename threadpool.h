@@ -64,6 +64,7 @@ namespace cpplib {
                 stop = true;
             }
             condition.notify_all();
+            workers.clear();  // join here: the queue and its mutex are destroyed before `workers`
         }
 
     private:
@@ -0,0 +1,497 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define CPPLIB_WS_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define CPPLIB_WS_NEON 1
+#endif
+
+#include "http.h"
+#include "tcp.h"
+
+namespace cpplib {
+    // WebSocket (RFC 6455) framing and a server that upgrades HTTP connections on a
+    // TcpServer. No extensions (permessage-deflate) or subprotocols are negotiated.
+    namespace ws {
+        enum class Opcode : std::uint8_t {
+            continuation = 0x0,
+            text = 0x1,
+            binary = 0x2,
+            close = 0x8,
+            ping = 0x9,
+            pong = 0xA,
+        };
+
+        namespace close_code {
+            constexpr std::uint16_t normal = 1000;
+            constexpr std::uint16_t going_away = 1001;
+            constexpr std::uint16_t protocol_error = 1002;
+            constexpr std::uint16_t too_big = 1009;
+        }
+
+        namespace detail {
+            inline std::uint32_t rol(std::uint32_t v, int s) noexcept { return (v << s) | (v >> (32 - s)); }
+
+            inline std::array<std::uint8_t, 20> sha1(const void* data, std::size_t len) {
+                std::uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+                std::string msg(static_cast<const char*>(data), len);
+                msg.push_back(static_cast<char>(0x80));
+                while (msg.size() % 64 != 56) msg.push_back('\0');
+                const std::uint64_t bits = static_cast<std::uint64_t>(len) * 8;
+                for (int i = 7; i >= 0; --i) msg.push_back(static_cast<char>(bits >> (i * 8)));
+                for (std::size_t off = 0; off < msg.size(); off += 64) {
+                    std::uint32_t w[80];
+                    for (int i = 0; i < 16; ++i) {
+                        const auto* b = reinterpret_cast<const unsigned char*>(msg.data() + off + i * 4);
+                        w[i] = (std::uint32_t(b[0]) << 24) | (std::uint32_t(b[1]) << 16) | (std::uint32_t(b[2]) << 8) | b[3];
+                    }
+                    for (int i = 16; i < 80; ++i) w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+                    std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+                    for (int i = 0; i < 80; ++i) {
+                        std::uint32_t f, k;
+                        if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+                        else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+                        else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+                        else             { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+                        const std::uint32_t t = rol(a, 5) + f + e + k + w[i];
+                        e = d; d = c; c = rol(b, 30); b = a; a = t;
+                    }
+                    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+                }
+                std::array<std::uint8_t, 20> out;
+                for (int i = 0; i < 20; ++i) out[i] = static_cast<std::uint8_t>(h[i / 4] >> (24 - 8 * (i % 4)));
+                return out;
+            }
+
+            inline std::string base64(const std::uint8_t* data, std::size_t len) {
+                static constexpr char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+                std::string out;
+                out.reserve((len + 2) / 3 * 4);
+                for (std::size_t i = 0; i < len; i += 3) {
+                    const std::uint32_t v = (std::uint32_t(data[i]) << 16) | (i + 1 < len ? std::uint32_t(data[i + 1]) << 8 : 0) |
+                                            (i + 2 < len ? data[i + 2] : 0);
+                    out.push_back(table[(v >> 18) & 63]);
+                    out.push_back(table[(v >> 12) & 63]);
+                    out.push_back(i + 1 < len ? table[(v >> 6) & 63] : '=');
+                    out.push_back(i + 2 < len ? table[v & 63] : '=');
+                }
+                return out;
+            }
+        }
+
+        // Sec-WebSocket-Accept for a client's Sec-WebSocket-Key.
+        inline std::string acceptKey(std::string_view key) {
+            std::string s(key);
+            s += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+            const auto digest = detail::sha1(s.data(), s.size());
+            return detail::base64(digest.data(), digest.size());
+        }
+
+        // XORs len bytes of src with the 4-byte mask into dst (which may equal src).
+        // `phase` is how many payload bytes precede src, so a payload can be unmasked in
+        // pieces. 16 bytes per step with SSE2/NEON.
+        inline void unmask(char* dst, const char* src, std::size_t len, const std::uint8_t mask[4], std::size_t phase = 0) noexcept {
+            std::uint8_t k[4];
+            for (std::size_t i = 0; i < 4; ++i) k[i] = mask[(phase + i) & 3];
+            std::size_t i = 0;
+#if defined(CPPLIB_WS_SSE2)
+            std::uint32_t k32;
+            std::memcpy(&k32, k, 4);
+            const __m128i m = _mm_set1_epi32(static_cast<int>(k32));
+            for (; i + 16 <= len; i += 16) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(v, m));
+            }
+#elif defined(CPPLIB_WS_NEON)
+            std::uint32_t k32;
+            std::memcpy(&k32, k, 4);
+            const uint8x16_t m = vreinterpretq_u8_u32(vdupq_n_u32(k32));
+            for (; i + 16 <= len; i += 16) {
+                vst1q_u8(reinterpret_cast<std::uint8_t*>(dst + i), veorq_u8(vld1q_u8(reinterpret_cast<const std::uint8_t*>(src + i)), m));
+            }
+#endif
+            for (; i < len; ++i) dst[i] = static_cast<char>(src[i] ^ k[i & 3]);
+        }
+
+        // Appends one frame. Servers send unmasked frames; clients pass a mask.
+        inline void appendFrame(std::string& out, Opcode op, const void* data, std::size_t len, bool fin = true,
+                                const std::uint8_t* mask = nullptr) {
+            out.push_back(static_cast<char>((fin ? 0x80 : 0x00) | static_cast<std::uint8_t>(op)));
+            const char mask_bit = mask ? static_cast<char>(0x80) : 0;
+            if (len < 126) {
+                out.push_back(static_cast<char>(mask_bit | static_cast<char>(len)));
+            } else if (len <= 0xFFFF) {
+                out.push_back(static_cast<char>(mask_bit | 126));
+                out.push_back(static_cast<char>(len >> 8));
+                out.push_back(static_cast<char>(len));
+            } else {
+                out.push_back(static_cast<char>(mask_bit | 127));
+                for (int i = 7; i >= 0; --i) out.push_back(static_cast<char>(static_cast<std::uint64_t>(len) >> (i * 8)));
+            }
+            if (!mask) {
+                out.append(static_cast<const char*>(data), len);
+                return;
+            }
+            out.append(reinterpret_cast<const char*>(mask), 4);
+            const std::size_t at = out.size();
+            out.resize(at + len);
+            unmask(&out[at], static_cast<const char*>(data), len, mask);
+        }
+
+        inline std::string encodeFrame(Opcode op, std::string_view data) {
+            std::string out;
+            out.reserve(data.size() + 10);
+            appendFrame(out, op, data.data(), data.size());
+            return out;
+        }
+
+        // Incremental frame parser for one direction of a connection. Data frames are
+        // reassembled into whole messages (unmasking while copying); control frames may
+        // arrive between fragments and are reported on their own.
+        class FrameParser {
+        public:
+            explicit FrameParser(std::size_t max_message = 16 * 1024 * 1024, bool expect_masked = true)
+                : max_message_(max_message), expect_masked_(expect_masked) {}
+
+            // Calls on_message(Opcode, const char*, std::size_t) for each message and control
+            // frame. Returns false on a protocol violation; closeCode() then says which.
+            template <typename Fn>
+            bool feed(const char* data, std::size_t len, Fn&& on_message) {
+                if (close_code_) {
+                    return false;
+                }
+                if (buffer_.empty()) {
+                    while (len > 0) {
+                        const auto r = parse(data, len, on_message);
+                        if (r < 0) return false;
+                        if (r == 0) break;
+                        data += r;
+                        len -= static_cast<std::size_t>(r);
+                    }
+                    if (len == 0) return true;
+                }
+                buffer_.append(data, len);
+                std::size_t pos = 0;
+                while (pos < buffer_.size()) {
+                    const auto r = parse(buffer_.data() + pos, buffer_.size() - pos, on_message);
+                    if (r < 0) {
+                        buffer_.clear();
+                        return false;
+                    }
+                    if (r == 0) break;
+                    pos += static_cast<std::size_t>(r);
+                }
+                buffer_.erase(0, pos);
+                return true;
+            }
+
+            std::uint16_t closeCode() const noexcept { return close_code_; }
+
+        private:
+            // One frame at the start of [p, p + n): its length, 0 if incomplete, -1 on error.
+            template <typename Fn>
+            std::ptrdiff_t parse(const char* p, std::size_t n, Fn& on_message) {
+                if (n < 2) return 0;
+                const auto b0 = static_cast<std::uint8_t>(p[0]);
+                const auto b1 = static_cast<std::uint8_t>(p[1]);
+                const bool fin = b0 & 0x80;
+                const auto op = static_cast<Opcode>(b0 & 0x0F);
+                const bool masked = b1 & 0x80;
+                if ((b0 & 0x70) || masked != expect_masked_) return fail(close_code::protocol_error);
+                std::size_t head = 2;
+                std::uint64_t len = b1 & 0x7F;
+                if (len == 126) {
+                    if (n < 4) return 0;
+                    len = (std::uint64_t(static_cast<std::uint8_t>(p[2])) << 8) | static_cast<std::uint8_t>(p[3]);
+                    head = 4;
+                } else if (len == 127) {
+                    if (n < 10) return 0;
+                    len = 0;
+                    for (int i = 0; i < 8; ++i) len = (len << 8) | static_cast<std::uint8_t>(p[2 + i]);
+                    head = 10;
+                    if (len >> 63) return fail(close_code::protocol_error);
+                }
+                const bool control = static_cast<std::uint8_t>(op) & 0x8;
+                if (control && (!fin || len > 125)) return fail(close_code::protocol_error);
+                if (len > max_message_ || (!control && message_.size() + len > max_message_)) return fail(close_code::too_big);
+                const std::size_t mask_at = head;
+                if (masked) head += 4;
+                if (n < head + len) return 0;
+                const char* payload = p + head;
+                const auto* mask = reinterpret_cast<const std::uint8_t*>(p + mask_at);
+                const auto size = static_cast<std::size_t>(len);
+
+                if (control) {
+                    if (op != Opcode::close && op != Opcode::ping && op != Opcode::pong) return fail(close_code::protocol_error);
+                    char ctl[125];
+                    if (masked) unmask(ctl, payload, size, mask); else std::memcpy(ctl, payload, size);
+                    on_message(op, static_cast<const char*>(ctl), size);
+                    return static_cast<std::ptrdiff_t>(head + size);
+                }
+                if (op == Opcode::continuation) {
+                    if (!fragmented_) return fail(close_code::protocol_error);
+                } else if (op == Opcode::text || op == Opcode::binary) {
+                    if (fragmented_) return fail(close_code::protocol_error);
+                    message_op_ = op;
+                    message_.clear();
+                } else {
+                    return fail(close_code::protocol_error);
+                }
+                const std::size_t at = message_.size();
+                message_.resize(at + size);
+                if (masked) unmask(&message_[at], payload, size, mask); else std::memcpy(&message_[at], payload, size);
+                fragmented_ = !fin;
+                if (fin) on_message(message_op_, static_cast<const char*>(message_.data()), message_.size());
+                return static_cast<std::ptrdiff_t>(head + size);
+            }
+
+            std::ptrdiff_t fail(std::uint16_t code) {
+                close_code_ = code;
+                return -1;
+            }
+
+            std::size_t max_message_;
+            bool expect_masked_;
+            std::string buffer_;
+            std::string message_;
+            Opcode message_op_ = Opcode::binary;
+            bool fragmented_ = false;
+            std::uint16_t close_code_ = 0;
+        };
+    }
+
+    // WebSocket server on a TcpServer (pool or per-core mode). A connection starts as
+    // HTTP; a valid upgrade request is answered with 101 and from then on carries frames.
+    // Anything else gets 426/400 and is closed. Pings are answered automatically and a
+    // close frame is echoed before the connection goes. Sends go through TcpServer::sendTo,
+    // so they are coalesced and forwarded between cores like raw TCP writes; broadcast()
+    // encodes the frame once and shares that buffer with every connection.
+    class WebSocketServer {
+    public:
+        using ConnectionId = TcpServer::ClientId;
+        using OnOpen    = std::function<void(ConnectionId, const http::Request&)>;
+        using OnMessage = std::function<void(ConnectionId, ws::Opcode, const char*, std::size_t)>;
+        using OnClose   = std::function<void(ConnectionId)>;
+
+        struct Handlers {
+            OnOpen on_open;
+            OnMessage on_message;  // whole text/binary messages
+            OnClose on_close;
+        };
+
+        explicit WebSocketServer(std::size_t max_message = 16 * 1024 * 1024) : max_message_(max_message) {}
+        ~WebSocketServer() { stop(); }
+
+        bool bind(int port) { return tcp_.bind(port); }
+        bool listen(int backlog = 128) { return tcp_.listen(backlog); }
+        std::uint16_t port() const { return tcp_.port(); }
+
+        void start(std::size_t workers, Handlers handlers) {
+            handlers_ = std::move(handlers);
+            tcp_.start(workers, TcpServer::OnConnect{}, onData(), onDisconnect());
+        }
+
+#if defined(CPPLIB_HAS_EVENT_LOOP)
+        bool startPerCore(std::size_t cores, Handlers handlers) {
+            handlers_ = std::move(handlers);
+            return tcp_.startPerCore(cores, TcpServer::OnConnect{}, onData(), onDisconnect());
+        }
+#endif
+
+        void stop() { tcp_.stop(); }
+        bool isRunning() const noexcept { return tcp_.isRunning(); }
+        TcpServer& tcp() noexcept { return tcp_; }
+
+        bool send(ConnectionId id, std::string_view data, ws::Opcode op = ws::Opcode::text) {
+            return tcp_.sendTo(id, std::make_shared<const std::string>(ws::encodeFrame(op, data)));
+        }
+
+        bool sendText(ConnectionId id, std::string_view text) { return send(id, text, ws::Opcode::text); }
+        bool sendBinary(ConnectionId id, std::string_view data) { return send(id, data, ws::Opcode::binary); }
+        bool ping(ConnectionId id, std::string_view payload = {}) { return send(id, payload.substr(0, 125), ws::Opcode::ping); }
+
+        // Sends a close frame and closes the connection. From inside that connection's own
+        // on_open/on_message the close happens once the handler returns, since closing can
+        // free the connection's parsers while they are still running.
+        bool close(ConnectionId id, std::uint16_t code = ws::close_code::normal) {
+            const char body[2] = {static_cast<char>(code >> 8), static_cast<char>(code)};
+            send(id, std::string_view(body, 2), ws::Opcode::close);
+            const auto& d = currentDispatch();
+            if (d.server == this && d.id == id) {
+                d.conn->closing = true;
+                return true;
+            }
+            return tcp_.closeClient(id);
+        }
+
+        // Encodes once; returns the number of open connections it was queued to.
+        std::size_t broadcast(std::string_view data, ws::Opcode op = ws::Opcode::text) {
+            auto frame = std::make_shared<const std::string>(ws::encodeFrame(op, data));
+            std::vector<ConnectionId> ids;
+            for (auto& st : stripes_) {
+                std::lock_guard<std::mutex> lk(st.mutex);
+                for (auto& kv : st.conns) if (kv.second->open) ids.push_back(kv.first);
+            }
+            std::size_t n = 0;
+            for (auto id : ids) n += tcp_.sendTo(id, frame) ? 1 : 0;
+            return n;
+        }
+
+        std::size_t numOpen() const {
+            std::size_t n = 0;
+            for (auto& st : stripes_) {
+                std::lock_guard<std::mutex> lk(st.mutex);
+                for (auto& kv : st.conns) n += kv.second->open ? 1 : 0;
+            }
+            return n;
+        }
+
+    private:
+        struct Conn {
+            explicit Conn(std::size_t max_message) : frames(max_message) {}
+            http::RequestParser handshake{8 * 1024, 0};
+            ws::FrameParser frames;
+            std::atomic<bool> open{false};  // read by broadcast() from other threads
+            bool closing = false;
+        };
+
+        struct alignas(64) Stripe {
+            mutable std::mutex mutex;
+            std::unordered_map<ConnectionId, std::unique_ptr<Conn>> conns;
+        };
+
+        static constexpr std::size_t stripes = 64;
+
+        // The connection whose data this thread is parsing, if any.
+        struct Dispatch {
+            const WebSocketServer* server = nullptr;
+            ConnectionId id = 0;
+            Conn* conn = nullptr;
+        };
+
+        static Dispatch& currentDispatch() noexcept {
+            thread_local Dispatch d;
+            return d;
+        }
+
+        struct DispatchScope {
+            DispatchScope(const WebSocketServer* server, ConnectionId id, Conn* conn) : prev(currentDispatch()) {
+                currentDispatch() = {server, id, conn};
+            }
+            ~DispatchScope() { currentDispatch() = prev; }
+            Dispatch prev;
+        };
+
+        Stripe& stripeOf(ConnectionId id) noexcept { return stripes_[(id ^ (id >> 56)) % stripes]; }
+
+        Conn& conn(ConnectionId id) {
+            Stripe& st = stripeOf(id);
+            std::lock_guard<std::mutex> lk(st.mutex);
+            auto& c = st.conns[id];
+            if (!c) c = std::make_unique<Conn>(max_message_);
+            return *c;
+        }
+
+        TcpServer::MessageHandler onData() {
+            return [this](ConnectionId id, std::shared_ptr<Socket>, const char* data, std::size_t len) {
+                Conn& c = conn(id);
+                if (c.closing) return;
+                {
+                    DispatchScope scope(this, id, &c);
+                    if (!c.open) {
+                        upgrade(id, c, data, len);
+                    } else if (!c.frames.feed(data, len, [&](ws::Opcode op, const char* p, std::size_t n) { onFrame(id, c, op, p, n); })) {
+                        close(id, c.frames.closeCode());
+                    }
+                }
+                // Last: in per-core mode this may drop c through onDisconnect.
+                if (c.closing) tcp_.closeClient(id);
+            };
+        }
+
+        void upgrade(ConnectionId id, Conn& c, const char* data, std::size_t len) {
+            // Clients may not send frames before the 101 arrives, so the handshake request
+            // is the last thing in its chunk.
+            const bool ok = c.handshake.feed(data, len, [&](const http::Request& req) {
+                if (c.open || c.closing) return;
+                std::string reply;
+                const auto key = req.header("sec-websocket-key");
+                const bool is_upgrade = req.method == "GET" && req.minor_version == 1 &&
+                                        http::detail::hasToken(req.header("upgrade"), "websocket") &&
+                                        http::detail::hasToken(req.header("connection"), "upgrade") && key.size() == 24;
+                if (is_upgrade && req.header("sec-websocket-version") == "13") {
+                    reply = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ";
+                    reply += ws::acceptKey(key);
+                    reply += "\r\n\r\n";
+                    tcp_.sendTo(id, reply.data(), reply.size());
+                    c.open = true;
+                    if (handlers_.on_open) handlers_.on_open(id, req);
+                    return;
+                }
+                reply = is_upgrade ? "HTTP/1.1 426 Upgrade Required\r\nSec-WebSocket-Version: 13\r\n"
+                                   : "HTTP/1.1 400 Bad Request\r\n";
+                reply += "Content-Length: 0\r\nConnection: close\r\n\r\n";
+                tcp_.sendTo(id, reply.data(), reply.size());
+                c.closing = true;
+            });
+            if (!ok && !c.closing) {
+                static const std::string bad = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+                tcp_.sendTo(id, bad.data(), bad.size());
+                c.closing = true;
+            }
+        }
+
+        void onFrame(ConnectionId id, Conn& c, ws::Opcode op, const char* p, std::size_t n) {
+            switch (op) {
+                case ws::Opcode::ping:
+                    send(id, std::string_view(p, n), ws::Opcode::pong);
+                    break;
+                case ws::Opcode::pong:
+                    break;
+                case ws::Opcode::close:
+                    // Echo the status code (if any) and finish.
+                    send(id, std::string_view(p, n < 2 ? n : 2), ws::Opcode::close);
+                    c.closing = true;
+                    break;
+                default:
+                    if (!c.closing && handlers_.on_message) handlers_.on_message(id, op, p, n);
+                    break;
+            }
+        }
+
+        TcpServer::OnDisconnect onDisconnect() {
+            return [this](ConnectionId id) {
+                Stripe& st = stripeOf(id);
+                std::unique_ptr<Conn> gone;
+                {
+                    std::lock_guard<std::mutex> lk(st.mutex);
+                    auto it = st.conns.find(id);
+                    if (it == st.conns.end()) return;
+                    gone = std::move(it->second);
+                    st.conns.erase(it);
+                }
+                if (gone->open && handlers_.on_close) handlers_.on_close(id);
+            };
+        }
+
+        std::size_t max_message_;
+        Handlers handlers_;
+        std::array<Stripe, stripes> stripes_;
+        TcpServer tcp_;
+    };
+}